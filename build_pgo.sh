@@ -0,0 +1,45 @@
+#!/bin/sh
+# Profile-guided optimized Release build for Linux, trained on the golden replays.
+#
+#   ./build_pgo.sh [extra cmake arguments, e.g. -DRAYLIB_PATH=...]
+#
+# 1. Builds instrumented binaries in build-pgo (HOVERCAT_PGO=GENERATE)
+# 2. Trains on tests/golden headless: simulation plus draw recording, no window
+# 3. Rebuilds build-pgo with the profile and LTO (HOVERCAT_PGO=USE)
+# 4. Builds a plain Release replaygate in build-release and compares ns/tick
+set -e
+
+SOURCE_DIR=$(cd "$(dirname "$0")" && pwd)
+PGO_DIR="$SOURCE_DIR/build-pgo"
+REFERENCE_DIR="$SOURCE_DIR/build-release"
+PROFILE_DIR="$PGO_DIR/pgo-profile"
+JOBS=$(nproc)
+
+rm -rf "$PROFILE_DIR"
+cmake -S "$SOURCE_DIR" -B "$PGO_DIR" -DCMAKE_BUILD_TYPE=Release -DHOVERCAT_BUILD_TOOLS=ON \
+  -DHOVERCAT_PGO=GENERATE -DHOVERCAT_PGO_DIR="$PROFILE_DIR" "$@"
+cmake --build "$PGO_DIR" -j"$JOBS"
+cmake --build "$PGO_DIR" --target pgo_train
+
+# Clang writes raw profiles that have to be merged first
+if ls "$PROFILE_DIR"/*.profraw >/dev/null 2>&1; then
+  llvm-profdata merge -output="$PROFILE_DIR/default.profdata" "$PROFILE_DIR"/*.profraw
+fi
+
+cmake -S "$SOURCE_DIR" -B "$PGO_DIR" -DHOVERCAT_PGO=USE
+cmake --build "$PGO_DIR" -j"$JOBS"
+
+cmake -S "$SOURCE_DIR" -B "$REFERENCE_DIR" -DCMAKE_BUILD_TYPE=Release -DHOVERCAT_BUILD_TOOLS=ON "$@"
+cmake --build "$REFERENCE_DIR" -j"$JOBS" --target replaygate
+
+# Mean ns/tick over the corpus, the gate's third column
+mean_ns_per_tick() {
+  "$1/replaygate" --tolerance 1000000 --repeat 5 --data "$SOURCE_DIR/Data" "$SOURCE_DIR/tests/golden" |
+    awk '$3 + 0 > 0 { sum += $3; count++ } END { printf "%.1f", sum / count }'
+}
+REFERENCE=$(mean_ns_per_tick "$REFERENCE_DIR")
+OPTIMIZED=$(mean_ns_per_tick "$PGO_DIR")
+echo "Release:     $REFERENCE ns/tick"
+echo "PGO + LTO:   $OPTIMIZED ns/tick"
+awk -v a="$REFERENCE" -v b="$OPTIMIZED" 'BEGIN { printf "Speedup:     %.2fx\n", a / b }'
+echo "Optimized game: $PGO_DIR"
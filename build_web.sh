@@ -2,6 +2,7 @@
 mkdir -p web-build
 emcc src/*.cpp -o web-build/index.html \
   -IC:/raylib/raylib/src \
+  -IC:/raylib/raylib/src/external \
   libraylib.web.a \
   -DPLATFORM_WEB \
   -DEMSCRIPTEN_BUILD \
@@ -0,0 +1,137 @@
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#include "alloctrack.h"
+
+namespace
+{
+    // Every block carries its size and subsystem in front of it, so delete can credit
+    // the right counter. 16 bytes keeps the payload at malloc's alignment.
+    struct alignas(16) BlockHeader {
+        uint64_t size;
+        uint8_t subsystem;
+    };
+
+    const char* subsystemNames[MEM_SUBSYSTEM_COUNT] = { "other", "gameplay", "scenery", "ui", "diagnostics" };
+}
+
+static std::atomic<uint64_t> allocationCount(0);
+static std::atomic<uint64_t> deallocationCount(0);
+static std::atomic<uint64_t> heapBytes[MEM_SUBSYSTEM_COUNT];
+static std::atomic<uint64_t> heapBytesTotal(0);
+static std::atomic<uint64_t> peakHeapBytes(0);
+static thread_local uint8_t currentSubsystem = MEM_OTHER;
+
+uint64_t GetAllocationCount()
+{
+    return allocationCount.load(std::memory_order_relaxed);
+}
+
+uint64_t GetDeallocationCount()
+{
+    return deallocationCount.load(std::memory_order_relaxed);
+}
+
+const char* MemorySubsystemName(MemorySubsystem subsystem)
+{
+    return subsystemNames[subsystem];
+}
+
+uint64_t GetHeapBytes(MemorySubsystem subsystem)
+{
+    return heapBytes[subsystem].load(std::memory_order_relaxed);
+}
+
+uint64_t GetHeapBytesTotal()
+{
+    return heapBytesTotal.load(std::memory_order_relaxed);
+}
+
+uint64_t GetPeakHeapBytes()
+{
+    return peakHeapBytes.load(std::memory_order_relaxed);
+}
+
+HeapScope::HeapScope(MemorySubsystem subsystem)
+    : previous((MemorySubsystem)currentSubsystem)
+{
+    currentSubsystem = subsystem;
+}
+
+HeapScope::~HeapScope()
+{
+    currentSubsystem = previous;
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    BlockHeader* header = static_cast<BlockHeader*>(std::malloc(sizeof(BlockHeader) + size));
+    if (!header) {
+        return nullptr;
+    }
+    header->size = size;
+    header->subsystem = currentSubsystem;
+    heapBytes[header->subsystem].fetch_add(size, std::memory_order_relaxed);
+    uint64_t total = heapBytesTotal.fetch_add(size, std::memory_order_relaxed) + size;
+    uint64_t peak = peakHeapBytes.load(std::memory_order_relaxed);
+    while (total > peak && !peakHeapBytes.compare_exchange_weak(peak, total, std::memory_order_relaxed)) {
+    }
+    return header + 1;
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t& tag) noexcept
+{
+    return operator new(size, tag);
+}
+
+void* operator new(std::size_t size)
+{
+    void* ptr = operator new(size, std::nothrow);
+    if (!ptr) {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+void* operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void* ptr) noexcept
+{
+    if (ptr) {
+        deallocationCount.fetch_add(1, std::memory_order_relaxed);
+        BlockHeader* header = static_cast<BlockHeader*>(ptr) - 1;
+        heapBytes[header->subsystem].fetch_sub(header->size, std::memory_order_relaxed);
+        heapBytesTotal.fetch_sub(header->size, std::memory_order_relaxed);
+        std::free(header);
+    }
+}
+
+void operator delete[](void* ptr) noexcept
+{
+    operator delete(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept
+{
+    operator delete(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t) noexcept
+{
+    operator delete(ptr);
+}
+
+void operator delete(void* ptr, const std::nothrow_t&) noexcept
+{
+    operator delete(ptr);
+}
+
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept
+{
+    operator delete(ptr);
+}
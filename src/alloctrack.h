@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstdint>
+
+// Process-wide heap allocation counters, fed by the global operator new/delete
+// replacements in alloctrack.cpp. Reads are relaxed and safe from any thread.
+uint64_t GetAllocationCount();
+uint64_t GetDeallocationCount();
+
+// Live operator new bytes are also charged to the subsystem that was current on the
+// allocating thread (see HeapScope) and credited back to it on delete. raylib's own
+// mallocs (decoded images, audio) don't go through operator new and aren't counted.
+enum MemorySubsystem : uint8_t {
+    MEM_OTHER = 0,
+    MEM_GAMEPLAY,       // Simulation, replay, step history, draw lists
+    MEM_SCENERY,        // Scenery staging buffers and the worker's queues
+    MEM_UI,             // HUD and menus, text cache
+    MEM_DIAGNOSTICS,    // Telemetry, metrics, profiling
+    MEM_SUBSYSTEM_COUNT
+};
+
+const char* MemorySubsystemName(MemorySubsystem subsystem);
+uint64_t GetHeapBytes(MemorySubsystem subsystem);
+uint64_t GetHeapBytesTotal();
+uint64_t GetPeakHeapBytes();    // Highest GetHeapBytesTotal since startup
+
+// Charges this thread's allocations to a subsystem until the scope ends
+class HeapScope
+{
+public:
+    explicit HeapScope(MemorySubsystem subsystem);
+    ~HeapScope();
+    HeapScope(const HeapScope&) = delete;
+    HeapScope& operator=(const HeapScope&) = delete;
+
+private:
+    MemorySubsystem previous;
+};
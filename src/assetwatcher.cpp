@@ -0,0 +1,190 @@
+#include "assetwatcher.h"
+
+#ifdef HOVERCAT_HOT_RELOAD
+
+#include <chrono>
+
+#if defined(__linux__)
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+AssetWatcher::AssetWatcher()
+    : inotifyFd(-1), running(false)
+{
+}
+
+AssetWatcher::~AssetWatcher()
+{
+    Stop();
+}
+
+void AssetWatcher::Track(const std::string& path, ReloadKind kind)
+{
+    tracked[path] = kind;
+}
+
+bool AssetWatcher::TakeReady(std::vector<ReloadedAsset>& out)
+{
+    std::unique_lock<std::mutex> lock(readyMutex, std::try_to_lock);
+    if (!lock.owns_lock() || ready.empty()) {
+        return false;
+    }
+    out.insert(out.end(), ready.begin(), ready.end());
+    ready.clear();
+    return true;
+}
+
+void AssetWatcher::Release(ReloadedAsset& asset)
+{
+    if (asset.image.data != nullptr) {
+        UnloadImage(asset.image);
+        asset.image = {};
+    }
+    if (asset.wave.data != nullptr) {
+        UnloadWave(asset.wave);
+        asset.wave = {};
+    }
+    if (asset.data != nullptr) {
+        UnloadFileData(asset.data);
+        asset.data = nullptr;
+    }
+}
+
+void AssetWatcher::Decode(const std::string& path, ReloadKind kind)
+{
+    // raylib's CPU-side loaders don't touch GL or the audio device, so they are safe here
+    ReloadedAsset asset = {};
+    asset.path = path;
+    asset.kind = kind;
+    bool ok = false;
+    switch (kind) {
+        case RELOAD_IMAGE:
+            asset.image = LoadImage(path.c_str());
+            ok = asset.image.data != nullptr;
+            if (ok) {
+                ImageFormat(&asset.image, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8);
+            }
+            break;
+        case RELOAD_WAVE:
+            asset.wave = LoadWave(path.c_str());
+            ok = asset.wave.data != nullptr && asset.wave.frameCount > 0;
+            break;
+        case RELOAD_FILE:
+            asset.data = LoadFileData(path.c_str(), &asset.dataSize);
+            ok = asset.data != nullptr && asset.dataSize > 0;
+            break;
+    }
+    if (!ok) {
+        // Still being written or broken; the old asset stays until a good save
+        TraceLog(LOG_WARNING, "HOTRELOAD: Can't decode %s, keeping the loaded one", path.c_str());
+        Release(asset);
+        return;
+    }
+    std::lock_guard<std::mutex> lock(readyMutex);
+    ready.push_back(asset);
+}
+
+#if defined(__linux__)
+
+bool AssetWatcher::Start(const std::vector<std::string>& directories)
+{
+    if (running.load()) {
+        return true;
+    }
+    inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotifyFd < 0) {
+        return false;
+    }
+    for (const std::string& directory : directories) {
+        // Close-after-write covers in-place saves, moved-to covers editors that save
+        // to a temporary file and rename it over the original
+        int watch = inotify_add_watch(inotifyFd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+        if (watch >= 0) {
+            watchedDirectories[watch] = directory;
+        }
+    }
+    if (watchedDirectories.empty()) {
+        close(inotifyFd);
+        inotifyFd = -1;
+        return false;
+    }
+    running.store(true);
+    worker = std::thread(&AssetWatcher::WatchLoop, this);
+    return true;
+}
+
+void AssetWatcher::Stop()
+{
+    if (running.exchange(false)) {
+        worker.join();
+    }
+    if (inotifyFd >= 0) {
+        close(inotifyFd);
+        inotifyFd = -1;
+    }
+    watchedDirectories.clear();
+    std::lock_guard<std::mutex> lock(readyMutex);
+    for (ReloadedAsset& asset : ready) {
+        Release(asset);
+    }
+    ready.clear();
+}
+
+void AssetWatcher::WatchLoop()
+{
+    typedef std::chrono::steady_clock Clock;
+    std::unordered_map<std::string, Clock::time_point> settling;   // Path -> last write
+    alignas(struct inotify_event) char buffer[4096];
+
+    while (running.load()) {
+        pollfd descriptor = { inotifyFd, POLLIN, 0 };
+        poll(&descriptor, 1, settleMs / 3);
+
+        ssize_t length;
+        while ((length = read(inotifyFd, buffer, sizeof(buffer))) > 0) {
+            for (char* at = buffer; at < buffer + length;) {
+                const inotify_event* event = reinterpret_cast<const inotify_event*>(at);
+                at += sizeof(inotify_event) + event->len;
+                auto directory = watchedDirectories.find(event->wd);
+                if (directory == watchedDirectories.end() || event->len == 0) {
+                    continue;
+                }
+                std::string path = directory->second + "/" + event->name;
+                if (tracked.count(path) > 0) {
+                    settling[path] = Clock::now();
+                }
+            }
+        }
+
+        Clock::time_point settled = Clock::now() - std::chrono::milliseconds(settleMs);
+        for (auto it = settling.begin(); it != settling.end();) {
+            if (it->second <= settled) {
+                Decode(it->first, tracked.at(it->first));
+                it = settling.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+}
+
+#else
+
+bool AssetWatcher::Start(const std::vector<std::string>&)
+{
+    return false;
+}
+
+void AssetWatcher::Stop()
+{
+}
+
+void AssetWatcher::WatchLoop()
+{
+}
+
+#endif
+
+#endif
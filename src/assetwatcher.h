@@ -0,0 +1,69 @@
+#pragma once
+
+// Debug-build hot reload of Data/ and Font/. Only compiled with HOVERCAT_HOT_RELOAD,
+// which CMake defines for Debug builds; release builds contain none of it.
+#ifdef HOVERCAT_HOT_RELOAD
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "raylib.h"
+
+// How a watched file is decoded before it is handed to the game
+enum ReloadKind {
+    RELOAD_IMAGE,       // Image, RGBA8
+    RELOAD_WAVE,        // Wave, for a mixer clip
+    RELOAD_FILE,        // Raw bytes, for fonts and music streams
+};
+
+struct ReloadedAsset {
+    std::string path;
+    ReloadKind kind;
+    Image image;
+    Wave wave;
+    unsigned char* data;
+    int dataSize;
+};
+
+// Watches directories with inotify. A worker thread waits for writes to settle,
+// decodes the changed file on the CPU and queues it; the game takes finished assets
+// between frames and does the GPU or audio upload itself, so nothing half-loaded is
+// ever in use and the frame never waits on the disk. Linux only, elsewhere Start
+// returns false.
+class AssetWatcher
+{
+public:
+    AssetWatcher();
+    ~AssetWatcher();
+
+    // Files to decode on change, before Start
+    void Track(const std::string& path, ReloadKind kind);
+    bool Start(const std::vector<std::string>& directories);
+    void Stop();
+
+    // Moves decoded assets into out; returns false without waiting when there are
+    // none or the worker holds the queue. Give each one back to Release.
+    bool TakeReady(std::vector<ReloadedAsset>& out);
+    static void Release(ReloadedAsset& asset);
+
+private:
+    void WatchLoop();
+    void Decode(const std::string& path, ReloadKind kind);
+
+    std::unordered_map<std::string, ReloadKind> tracked;
+    std::unordered_map<int, std::string> watchedDirectories;    // inotify watch -> directory
+    int inotifyFd;
+    std::atomic<bool> running;
+    std::thread worker;
+
+    std::mutex readyMutex;
+    std::vector<ReloadedAsset> ready;
+
+    const int settleMs = 150;   // Editors often write a file in several steps
+};
+
+#endif
@@ -0,0 +1,295 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+
+#include "audiomixer.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define AUDIO_MIXER_SSE2
+#endif
+
+void MixMonoToStereoScalar(float* out, const float* in, uint32_t frames, float gainLeft, float gainRight)
+{
+    for (uint32_t i = 0; i < frames; i++) {
+        out[2 * i] += in[i] * gainLeft;
+        out[2 * i + 1] += in[i] * gainRight;
+    }
+}
+
+void ScaleStereoScalar(float* buffer, uint32_t frames, float from, float to)
+{
+    float step = frames > 0 ? (to - from) / (float)frames : 0.0f;
+    for (uint32_t i = 0; i < frames; i++) {
+        float gain = from + step * (float)(i + 1);
+        buffer[2 * i] *= gain;
+        buffer[2 * i + 1] *= gain;
+    }
+}
+
+void MixMonoToStereo(float* out, const float* in, uint32_t frames, float gainLeft, float gainRight)
+{
+    uint32_t i = 0;
+#ifdef AUDIO_MIXER_SSE2
+    // Four mono samples become two stereo pairs of two frames each
+    __m128 gains = _mm_setr_ps(gainLeft, gainRight, gainLeft, gainRight);
+    for (; i + 4 <= frames; i += 4) {
+        __m128 samples = _mm_loadu_ps(in + i);
+        __m128 low = _mm_unpacklo_ps(samples, samples);
+        __m128 high = _mm_unpackhi_ps(samples, samples);
+        float* target = out + 2 * i;
+        _mm_storeu_ps(target, _mm_add_ps(_mm_loadu_ps(target), _mm_mul_ps(low, gains)));
+        _mm_storeu_ps(target + 4, _mm_add_ps(_mm_loadu_ps(target + 4), _mm_mul_ps(high, gains)));
+    }
+#endif
+    MixMonoToStereoScalar(out + 2 * i, in + i, frames - i, gainLeft, gainRight);
+}
+
+void ScaleStereo(float* buffer, uint32_t frames, float from, float to)
+{
+    if (from == 1.0f && to == 1.0f) {
+        return;
+    }
+    float step = frames > 0 ? (to - from) / (float)frames : 0.0f;
+    uint32_t i = 0;
+#ifdef AUDIO_MIXER_SSE2
+    // Frame numbers i + 1 and i + 2, each for both channels
+    __m128 index = _mm_setr_ps(1.0f, 1.0f, 2.0f, 2.0f);
+    const __m128 two = _mm_set1_ps(2.0f);
+    const __m128 base = _mm_set1_ps(from);
+    const __m128 steps = _mm_set1_ps(step);
+    for (; i + 2 <= frames; i += 2) {
+        __m128 gain = _mm_add_ps(base, _mm_mul_ps(steps, index));
+        _mm_storeu_ps(buffer + 2 * i, _mm_mul_ps(_mm_loadu_ps(buffer + 2 * i), gain));
+        index = _mm_add_ps(index, two);
+    }
+#endif
+    for (; i < frames; i++) {
+        float gain = from + step * (float)(i + 1);
+        buffer[2 * i] *= gain;
+        buffer[2 * i + 1] *= gain;
+    }
+}
+
+AudioClip::AudioClip(uint32_t frames)
+    : samples(static_cast<float*>(calloc(frames > 0 ? frames : 1, sizeof(float)))), frames(samples != nullptr ? frames : 0)
+{
+}
+
+AudioClip::~AudioClip()
+{
+    free(samples);
+}
+
+AudioMixer::AudioMixer(uint32_t sampleRate)
+    : sampleRate(sampleRate), clipBytes(0), voicesStarted(0), musicGain(1.0f), duckGain(1.0f),
+      releasePerFrame(1.0f), lowPassCoefficient(1.0f), lowPassTarget(1.0f), lowPassLeft(0.0f), lowPassRight(0.0f),
+      buffersMixed(0), peakMixNs(0), droppedMessages(0)
+{
+    for (uint32_t slot = 0; slot < clipSlots; slot++) {
+        clips[slot] = nullptr;
+        slotBytes[slot] = 0;
+    }
+    for (Voice& voice : voices) {
+        voice = Voice{ nullptr, 0, 0.0f, 0.0f, 0 };
+    }
+}
+
+AudioMixer::~AudioMixer()
+{
+    // Clips still in flight are owned by their messages
+    Message message;
+    while (messages.Pop(message)) {
+        if (message.type == MIXER_SET_CLIP) {
+            delete message.clip;
+        }
+    }
+    ReleaseRetired();
+    for (AudioClip* clip : clips) {
+        delete clip;
+    }
+}
+
+void AudioMixer::Post(const Message& message)
+{
+    if (!messages.Push(message)) {
+        droppedMessages.fetch_add(1, std::memory_order_relaxed);
+        if (message.type == MIXER_SET_CLIP) {
+            delete message.clip;
+        }
+    }
+}
+
+void AudioMixer::SetClip(uint32_t slot, AudioClip* clip)
+{
+    if (slot >= clipSlots) {
+        delete clip;
+        return;
+    }
+    uint64_t bytes = clip != nullptr ? (uint64_t)clip->frames * sizeof(float) : 0;
+    clipBytes += bytes - slotBytes[slot];
+    slotBytes[slot] = bytes;
+    Post(Message{ MIXER_SET_CLIP, slot, 0.0f, 0.0f, clip });
+}
+
+void AudioMixer::Play(uint32_t slot, float gain, float pan)
+{
+    Post(Message{ MIXER_PLAY, slot, gain, std::max(-1.0f, std::min(pan, 1.0f)), nullptr });
+}
+
+void AudioMixer::StopVoices()
+{
+    Post(Message{ MIXER_STOP_VOICES, 0, 0.0f, 0.0f, nullptr });
+}
+
+void AudioMixer::Duck(float gain)
+{
+    Post(Message{ MIXER_DUCK, 0, gain, 0.0f, nullptr });
+}
+
+void AudioMixer::Unduck(float releaseSeconds)
+{
+    Post(Message{ MIXER_UNDUCK, 0, releaseSeconds, 0.0f, nullptr });
+}
+
+void AudioMixer::SetMuffled(bool muffled)
+{
+    Post(Message{ MIXER_MUFFLE, 0, muffled ? 1.0f : 0.0f, 0.0f, nullptr });
+}
+
+void AudioMixer::ReleaseRetired()
+{
+    AudioClip* clip;
+    while (retired.Pop(clip)) {
+        delete clip;
+    }
+}
+
+void AudioMixer::Apply(const Message& message)
+{
+    switch (message.type) {
+    case MIXER_SET_CLIP: {
+        AudioClip* old = clips[message.slot];
+        clips[message.slot] = message.clip;
+        for (Voice& voice : voices) {
+            if (voice.clip == old) {
+                voice.clip = nullptr;
+            }
+        }
+        // A full ring leaks the clip rather than freeing it on this thread
+        if (old != nullptr && !retired.Push(old)) {
+            droppedMessages.fetch_add(1, std::memory_order_relaxed);
+        }
+        break;
+    }
+    case MIXER_PLAY: {
+        const AudioClip* clip = message.slot < clipSlots ? clips[message.slot] : nullptr;
+        if (clip == nullptr || clip->frames == 0) {
+            break;
+        }
+        Voice* target = &voices[0];
+        for (Voice& voice : voices) {
+            if (voice.clip == nullptr) {
+                target = &voice;
+                break;
+            }
+            if (voice.started < target->started) {
+                target = &voice;
+            }
+        }
+        // Equal power, scaled so the center keeps the clip's level on both sides
+        float angle = (message.b + 1.0f) * 0.25f * 3.14159265f;
+        float gain = message.a * 1.41421356f;
+        *target = Voice{ clip, 0, std::cos(angle) * gain, std::sin(angle) * gain, ++voicesStarted };
+        break;
+    }
+    case MIXER_STOP_VOICES:
+        for (Voice& voice : voices) {
+            voice.clip = nullptr;
+        }
+        break;
+    case MIXER_DUCK:
+        duckGain = message.a;
+        releasePerFrame = 0.0f;
+        break;
+    case MIXER_UNDUCK:
+        duckGain = 1.0f;
+        releasePerFrame = message.a > 0.0f ? 1.0f / (message.a * sampleRate) : 1.0f;
+        break;
+    case MIXER_MUFFLE:
+        lowPassTarget = message.a > 0.0f ? 1.0f - std::exp(-2.0f * 3.14159265f * muffleCutoffHz / sampleRate) : 1.0f;
+        break;
+    }
+}
+
+void AudioMixer::LowPass(float* buffer, uint32_t frames)
+{
+    // The coefficient glides a buffer at a time, so muffling fades rather than clicks
+    float glide = (float)frames / (muffleGlideSeconds * sampleRate);
+    float from = lowPassCoefficient;
+    if (lowPassCoefficient < lowPassTarget) {
+        lowPassCoefficient = std::min(lowPassTarget, lowPassCoefficient + glide);
+    } else {
+        lowPassCoefficient = std::max(lowPassTarget, lowPassCoefficient - glide);
+    }
+    if (from == 1.0f && lowPassCoefficient == 1.0f) {
+        // Fully open: keep the state on the signal so closing again starts smoothly
+        if (frames > 0) {
+            lowPassLeft = buffer[2 * frames - 2];
+            lowPassRight = buffer[2 * frames - 1];
+        }
+        return;
+    }
+    float step = frames > 0 ? (lowPassCoefficient - from) / (float)frames : 0.0f;
+    float left = lowPassLeft;
+    float right = lowPassRight;
+    for (uint32_t i = 0; i < frames; i++) {
+        float coefficient = from + step * (float)(i + 1);
+        left += coefficient * (buffer[2 * i] - left);
+        right += coefficient * (buffer[2 * i + 1] - right);
+        buffer[2 * i] = left;
+        buffer[2 * i + 1] = right;
+    }
+    lowPassLeft = left;
+    lowPassRight = right;
+}
+
+void AudioMixer::Mix(float* buffer, uint32_t frames)
+{
+    auto start = std::chrono::steady_clock::now();
+    Message message;
+    while (messages.Pop(message)) {
+        Apply(message);
+    }
+
+    // The buffer holds raylib's mix, which is only the music
+    float gain = musicGain;
+    if (duckGain < musicGain) {
+        gain = duckGain;
+    } else if (musicGain < 1.0f) {
+        gain = std::min(1.0f, musicGain + releasePerFrame * frames);
+    }
+    ScaleStereo(buffer, frames, musicGain, gain);
+    musicGain = gain;
+
+    for (Voice& voice : voices) {
+        if (voice.clip == nullptr) {
+            continue;
+        }
+        uint32_t count = std::min(frames, voice.clip->frames - voice.position);
+        MixMonoToStereo(buffer, voice.clip->samples + voice.position, count, voice.gainLeft, voice.gainRight);
+        voice.position += count;
+        if (voice.position >= voice.clip->frames) {
+            voice.clip = nullptr;
+        }
+    }
+
+    LowPass(buffer, frames);
+
+    uint32_t ns = (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    if (ns > peakMixNs.load(std::memory_order_relaxed)) {
+        peakMixNs.store(ns, std::memory_order_relaxed);
+    }
+    buffersMixed.fetch_add(1, std::memory_order_relaxed);
+}
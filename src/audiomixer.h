@@ -0,0 +1,159 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+// Sound effect mixer and master DSP, run on the audio thread after raylib has mixed
+// the music stream into the device buffer (interleaved stereo float). Per buffer it
+// ducks the music, adds the effect voices (SSE2 where available) and low-passes the
+// whole mix while the game is muffled. The game thread only talks to it through a
+// lock-free message ring; clips it replaces come back through a second ring so they
+// are freed on the game thread, and the audio thread never allocates or locks.
+
+// A mono effect at the mixer's sample rate. The samples are malloc'd like raylib's
+// audio data, so they count toward the audio budget instead of the heap.
+class AudioClip
+{
+public:
+    explicit AudioClip(uint32_t frames);
+    ~AudioClip();
+    AudioClip(const AudioClip&) = delete;
+    AudioClip& operator=(const AudioClip&) = delete;
+
+    float* samples;
+    uint32_t frames;
+};
+
+// out[2i] += in[i] * gainLeft and out[2i + 1] += in[i] * gainRight
+void MixMonoToStereo(float* out, const float* in, uint32_t frames, float gainLeft, float gainRight);
+// Scales interleaved stereo by a gain ramping linearly from from (exclusive) to to
+void ScaleStereo(float* buffer, uint32_t frames, float from, float to);
+// Plain loops computing the same results, for mixbench to check and compare against
+void MixMonoToStereoScalar(float* out, const float* in, uint32_t frames, float gainLeft, float gainRight);
+void ScaleStereoScalar(float* buffer, uint32_t frames, float from, float to);
+
+class AudioMixer
+{
+public:
+    static const uint32_t clipSlots = 8;
+    static const uint32_t maxVoices = 16;
+
+    explicit AudioMixer(uint32_t sampleRate = 48000);
+    ~AudioMixer();      // Must not be attached to the device any more
+
+    AudioMixer(const AudioMixer&) = delete;
+    AudioMixer& operator=(const AudioMixer&) = delete;
+
+    // Game thread. Only before the mixer is attached.
+    void SetSampleRate(uint32_t sampleRate) { this->sampleRate = sampleRate; }
+    uint32_t SampleRate() const { return sampleRate; }
+
+    // Game thread. Messages that don't fit the ring are dropped and counted.
+    // Takes ownership of clip; voices playing the old one stop
+    void SetClip(uint32_t slot, AudioClip* clip);
+    // pan from -1 (left) to 1 (right), equal power; a free voice or the oldest one
+    void Play(uint32_t slot, float gain, float pan);
+    void StopVoices();
+    // Music drops to gain within a buffer and stays there until Unduck
+    void Duck(float gain);
+    void Unduck(float releaseSeconds);
+    // Low-passes the whole mix (pause, lost focus), gliding in and out
+    void SetMuffled(bool muffled);
+    // Frees the clips SetClip replaced once the audio thread let go of them
+    void ReleaseRetired();
+    uint64_t ClipBytes() const { return clipBytes; }
+
+    // Audio thread
+    void Mix(float* buffer, uint32_t frames);
+
+    // Any thread
+    uint64_t BuffersMixed() const { return buffersMixed.load(std::memory_order_relaxed); }
+    uint32_t PeakMixNs() const { return peakMixNs.load(std::memory_order_relaxed); }
+    uint64_t DroppedMessages() const { return droppedMessages.load(std::memory_order_relaxed); }
+
+private:
+    enum MessageType : uint32_t {
+        MIXER_SET_CLIP,
+        MIXER_PLAY,
+        MIXER_STOP_VOICES,
+        MIXER_DUCK,
+        MIXER_UNDUCK,
+        MIXER_MUFFLE
+    };
+
+    struct Message {
+        MessageType type;
+        uint32_t slot;
+        float a;
+        float b;
+        AudioClip* clip;
+    };
+
+    // Single-producer single-consumer ring, like the telemetry rings
+    template <typename T, uint64_t capacity>
+    struct Ring {
+        T items[capacity];
+        std::atomic<uint64_t> head{0};   // Next slot the producer writes
+        char padding[64];                // Keeps producer and consumer indices on separate cache lines
+        std::atomic<uint64_t> tail{0};   // Next slot the consumer reads
+
+        bool Push(const T& item)
+        {
+            uint64_t position = head.load(std::memory_order_relaxed);
+            if (position - tail.load(std::memory_order_acquire) >= capacity) {
+                return false;
+            }
+            items[position % capacity] = item;
+            head.store(position + 1, std::memory_order_release);
+            return true;
+        }
+
+        bool Pop(T& item)
+        {
+            uint64_t position = tail.load(std::memory_order_relaxed);
+            if (position == head.load(std::memory_order_acquire)) {
+                return false;
+            }
+            item = items[position % capacity];
+            tail.store(position + 1, std::memory_order_release);
+            return true;
+        }
+    };
+
+    struct Voice {
+        const AudioClip* clip;      // nullptr when free
+        uint32_t position;
+        float gainLeft;
+        float gainRight;
+        uint64_t started;           // Start order, to steal the oldest
+    };
+
+    void Post(const Message& message);
+    void Apply(const Message& message);
+    void LowPass(float* buffer, uint32_t frames);
+
+    uint32_t sampleRate;
+    Ring<Message, 64> messages;
+    Ring<AudioClip*, 64> retired;
+    uint64_t clipBytes;                 // Game thread's view of the slots
+    uint64_t slotBytes[clipSlots];
+
+    // Audio thread state
+    AudioClip* clips[clipSlots];
+    Voice voices[maxVoices];
+    uint64_t voicesStarted;
+    float musicGain;
+    float duckGain;                     // Music gain while ducked, 1 when not
+    float releasePerFrame;              // Gain regained per frame after Unduck
+    float lowPassCoefficient;           // One-pole coefficient, 1 passes everything
+    float lowPassTarget;
+    float lowPassLeft;
+    float lowPassRight;
+
+    std::atomic<uint64_t> buffersMixed;
+    std::atomic<uint32_t> peakMixNs;
+    std::atomic<uint64_t> droppedMessages;
+
+    const float muffleCutoffHz = 700.0f;
+    const float muffleGlideSeconds = 0.15f;
+};
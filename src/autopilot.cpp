@@ -0,0 +1,74 @@
+#include <algorithm>
+
+#include "autopilot.h"
+
+Autopilot::Autopilot(uint32_t seed, float skill)
+    : rngState(seed ? seed : 1), skill(skill), aimOffset(0.0f), aimPipe(0xFFFFFFFF), customExtent(false),
+      extentLeft(0.0f), extentTop(0.0f), extentRight(0.0f), extentBottom(0.0f)
+{
+}
+
+void Autopilot::SetPlayerExtent(float left, float top, float right, float bottom)
+{
+    extentLeft = left;
+    extentTop = top;
+    extentRight = right;
+    extentBottom = bottom;
+    customExtent = true;
+}
+
+bool Autopilot::WantsFlap(const SimState& state, const SimConfig& config)
+{
+    float left = extentLeft, top = extentTop, right = extentRight, bottom = extentBottom;
+    if (!customExtent) {
+        left = right = config.playerSize * config.playerCollisionWidthRatio / 2;
+        top = bottom = config.playerSize * config.playerCollisionHeightRatio / 2;
+    }
+
+    // Aim for the first pipe the player hasn't cleared yet. While inside that pipe,
+    // already lean towards the following gap as far as the current one allows.
+    const float safety = 30.0f;
+    float targetY = config.height / 2;
+    const Pipe* current = nullptr;
+    for (const Pipe& pipe : state.pipes) {
+        if (pipe.x + config.pipeWidth <= state.playerX - left) {
+            continue;
+        }
+        float gapTop = pipe.gapCenter - config.pipeGap / 2;
+        float gapBottom = pipe.gapCenter + config.pipeGap / 2;
+        if (current == nullptr) {
+            current = &pipe;
+            targetY = (gapTop + top + gapBottom - bottom) / 2;
+            if (pipe.x > state.playerX + right) {
+                break;
+            }
+        } else {
+            float currentTop = current->gapCenter - config.pipeGap / 2;
+            float currentBottom = current->gapCenter + config.pipeGap / 2;
+            float lowest = currentTop + top + safety;
+            float highest = currentBottom - bottom - safety;
+            float next = (gapTop + top + gapBottom - bottom) / 2;
+            targetY = std::max(lowest, std::min(highest, next));
+            break;
+        }
+    }
+
+    uint32_t pipeIndex = (uint32_t)state.score;
+    if (pipeIndex != aimPipe) {
+        aimPipe = pipeIndex;
+        rngState ^= rngState << 13;
+        rngState ^= rngState >> 17;
+        rngState ^= rngState << 5;
+        float noise = (float)(rngState % 2001) / 1000.0f - 1.0f;
+        aimOffset = noise * (1.0f - skill) * config.pipeGap * 0.5f;
+    }
+
+    // Flap on the way down once below the aim point, unless the rise (about 67px)
+    // would hit the top of the gap we're heading into
+    const float flapMargin = 20.0f;
+    float flapRise = config.jumpForce * config.jumpForce / (2.0f * config.gravity);
+    if (current != nullptr && state.playerY - flapRise - top - 4.0f < current->gapCenter - config.pipeGap / 2) {
+        return false;
+    }
+    return state.playerVelocity > 0.0f && state.playerY > targetY + aimOffset + flapMargin;
+}
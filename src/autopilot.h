@@ -0,0 +1,26 @@
+#pragma once
+
+#include "simulation.h"
+
+// Simple controller that steers towards the next gap. Used to generate replay
+// corpora and to fast-forward headless runs; it is good enough to survive into the
+// max-speed phase, but the skill knob lets it make human-like mistakes.
+class Autopilot
+{
+public:
+    explicit Autopilot(uint32_t seed = 1, float skill = 1.0f);
+
+    // Solid extent of the player around its center (all positive), for pixel
+    // collision; defaults to the collision box
+    void SetPlayerExtent(float left, float top, float right, float bottom);
+
+    bool WantsFlap(const SimState& state, const SimConfig& config);
+
+private:
+    uint32_t rngState;
+    float skill;        // 1.0 = perfect aim, lower values add aim noise
+    float aimOffset;    // Current aim error, re-rolled for every pipe
+    uint32_t aimPipe;   // Pipe index the aim error belongs to
+    bool customExtent;
+    float extentLeft, extentTop, extentRight, extentBottom;
+};
@@ -0,0 +1,120 @@
+#include <algorithm>
+#include <cmath>
+
+#include "collisionmask.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define COLLISION_MASK_SSE2
+#endif
+
+namespace
+{
+    // Bits lo..hi (inclusive, 0..127) of a 128-bit row, split into its two words
+    void RangeBits(int lo, int hi, uint64_t out[2])
+    {
+        for (int word = 0; word < 2; word++) {
+            int first = std::max(lo - word * 64, 0);
+            int last = std::min(hi - word * 64, 63);
+            if (first > last) {
+                out[word] = 0;
+            } else {
+                uint64_t upTo = last == 63 ? ~0ull : ((1ull << (last + 1)) - 1);
+                out[word] = upTo & ~((1ull << first) - 1);
+            }
+        }
+    }
+}
+
+CollisionMask::CollisionMask()
+    : size(0), minX(0), maxX(-1), minY(0), maxY(-1)
+{
+}
+
+bool CollisionMask::Build(const uint8_t* rgba, int width, int height, int size, uint8_t alphaThreshold)
+{
+    rows.clear();
+    this->size = 0;
+    minX = minY = 0;
+    maxX = maxY = -1;
+    if (rgba == nullptr || width <= 0 || height <= 0 || size <= 0 || size > collisionMaskMaxSize) {
+        return false;
+    }
+
+    this->size = size;
+    rows.assign(size, Row{{0, 0}});
+    minX = minY = size;
+    for (int y = 0; y < size; y++) {
+        int sy0 = y * height / size;
+        int sy1 = std::max(sy0 + 1, (y + 1) * height / size);
+        for (int x = 0; x < size; x++) {
+            int sx0 = x * width / size;
+            int sx1 = std::max(sx0 + 1, (x + 1) * width / size);
+            int solid = 0;
+            for (int sy = sy0; sy < sy1; sy++) {
+                const uint8_t* pixel = rgba + ((size_t)sy * width + sx0) * 4;
+                for (int sx = sx0; sx < sx1; sx++, pixel += 4) {
+                    solid += pixel[3] >= alphaThreshold;
+                }
+            }
+            if (solid * 2 >= (sy1 - sy0) * (sx1 - sx0)) {
+                rows[y].bits[x >> 6] |= 1ull << (x & 63);
+                minX = std::min(minX, x);
+                maxX = std::max(maxX, x);
+                minY = std::min(minY, y);
+                maxY = std::max(maxY, y);
+            }
+        }
+    }
+    if (maxX < 0) {
+        minX = minY = 0;
+    }
+    return true;
+}
+
+bool CollisionMask::OverlapsRect(float left, float top, float right, float bottom) const
+{
+    // Broad phase: the solid bounds
+    if (Empty() || right <= (float)minX || left >= (float)(maxX + 1) || bottom <= (float)minY || top >= (float)(maxY + 1)) {
+        return false;
+    }
+
+    // Pixels the rectangle touches, clipped to the solid bounds
+    int x0 = std::max(minX, (int)std::floor(left));
+    int x1 = std::min(maxX, (int)std::ceil(right) - 1);
+    int y0 = std::max(minY, (int)std::floor(top));
+    int y1 = std::min(maxY, (int)std::ceil(bottom) - 1);
+    if (x0 > x1 || y0 > y1) {
+        return false;
+    }
+
+    uint64_t columns[2];
+    RangeBits(x0, x1, columns);
+
+#ifdef COLLISION_MASK_SSE2
+    __m128i any = _mm_setzero_si128();
+    for (int y = y0; y <= y1; y++) {
+        any = _mm_or_si128(any, _mm_loadu_si128(reinterpret_cast<const __m128i*>(rows[y].bits)));
+    }
+    __m128i hit = _mm_and_si128(any, _mm_loadu_si128(reinterpret_cast<const __m128i*>(columns)));
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(hit, _mm_setzero_si128())) != 0xFFFF;
+#else
+    uint64_t any0 = 0;
+    uint64_t any1 = 0;
+    for (int y = y0; y <= y1; y++) {
+        any0 |= rows[y].bits[0];
+        any1 |= rows[y].bits[1];
+    }
+    return ((any0 & columns[0]) | (any1 & columns[1])) != 0;
+#endif
+}
+
+uint64_t CollisionMask::Hash() const
+{
+    uint64_t hash = 14695981039346656037ull;
+    for (const Row& row : rows) {
+        hash = (hash ^ row.bits[0]) * 1099511628211ull;
+        hash = (hash ^ row.bits[1]) * 1099511628211ull;
+    }
+    return hash;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// 1-bit collision mask of a sprite, built from its alpha channel and scaled to the
+// size the sprite is drawn at. Each row is a 128-bit word so an overlap test against
+// a rectangle is one OR per covered row (SSE2 where available) and a single AND.
+
+const int collisionMaskMaxSize = 128;
+
+class CollisionMask
+{
+public:
+    CollisionMask();
+
+    // rgba: width*height RGBA8 pixels. A mask pixel is solid when at least half of
+    // the source pixels it covers have alpha >= alphaThreshold.
+    bool Build(const uint8_t* rgba, int width, int height, int size, uint8_t alphaThreshold = 128);
+
+    bool Empty() const { return minX > maxX; }
+    int Size() const { return size; }
+
+    // Tight bounds of the solid pixels (inclusive), for the broad phase
+    int MinX() const { return minX; }
+    int MaxX() const { return maxX; }
+    int MinY() const { return minY; }
+    int MaxY() const { return maxY; }
+
+    // Rectangle in mask pixel coordinates (the mask's top-left is 0,0), edges may be
+    // fractional or lie outside the mask
+    bool OverlapsRect(float left, float top, float right, float bottom) const;
+
+    uint64_t Hash() const;
+
+private:
+    struct Row {
+        uint64_t bits[2];   // Bit x of the row, low word first
+    };
+
+    std::vector<Row> rows;
+    int size;
+    int minX, maxX, minY, maxY;
+};
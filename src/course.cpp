@@ -0,0 +1,222 @@
+#include <algorithm>
+
+#include "course.h"
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#elif !defined(__EMSCRIPTEN__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+    const uint64_t windowPipes = 65536;         // 512 KB of records
+    // Mapping offsets must be multiples of the allocation granularity on Windows and
+    // of the page size elsewhere; 64 KB covers both
+    const uint64_t mapAlignment = 65536;
+
+    uint64_t RecordOffset(uint64_t index)
+    {
+        return sizeof(CourseHeader) + index * sizeof(CoursePipe);
+    }
+}
+
+CourseFile::CourseFile()
+    : fileSize(0), pipeCount(0), windowFirst(0), windowCount(0), readAheadFirst(0), window(nullptr),
+      windowBytes(0), windowMoves(0),
+#if defined(_WIN32)
+      file(INVALID_HANDLE_VALUE), mapping(nullptr), view(nullptr)
+#elif defined(__EMSCRIPTEN__)
+      file(nullptr)
+#else
+      fd(-1), view(nullptr), viewBytes(0)
+#endif
+{
+}
+
+CourseFile::~CourseFile()
+{
+    Close();
+}
+
+bool CourseFile::Open(const char* path)
+{
+    Close();
+    CourseHeader header = {};
+#if defined(_WIN32)
+    file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    LARGE_INTEGER size = {};
+    DWORD read = 0;
+    bool ok = file != INVALID_HANDLE_VALUE && GetFileSizeEx(file, &size)
+        && ReadFile(file, &header, sizeof(header), &read, nullptr) && read == sizeof(header);
+    fileSize = ok ? (uint64_t)size.QuadPart : 0;
+    if (ok) {
+        mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        ok = mapping != nullptr;
+    }
+#elif defined(__EMSCRIPTEN__)
+    file = fopen(path, "rb");
+    bool ok = file != nullptr && fread(&header, sizeof(header), 1, file) == 1
+        && fseek(file, 0, SEEK_END) == 0;
+    fileSize = ok ? (uint64_t)ftell(file) : 0;
+#else
+    fd = open(path, O_RDONLY);
+    struct stat info = {};
+    bool ok = fd >= 0 && fstat(fd, &info) == 0 && pread(fd, &header, sizeof(header), 0) == (ssize_t)sizeof(header);
+    fileSize = ok ? (uint64_t)info.st_size : 0;
+#endif
+    if (!ok) {
+        error = std::string("can't read ") + path;
+    } else if (header.magic != courseMagic || header.version != courseVersion || header.recordSize != sizeof(CoursePipe)) {
+        error = std::string(path) + " is not a version " + std::to_string(courseVersion) + " course file";
+    } else if (header.pipeCount == 0 || fileSize < RecordOffset(header.pipeCount)) {
+        error = std::string(path) + " is empty or truncated";
+    } else {
+        // The simulation counts pipes in 32 bits; 4 billion pipes is a long marathon
+        pipeCount = std::min<uint64_t>(header.pipeCount, UINT32_MAX);
+        if (MoveWindow(0)) {
+            error.clear();
+            return true;
+        }
+        error = std::string("can't map ") + path;
+    }
+    Close();
+    return false;
+}
+
+void CourseFile::Close()
+{
+    ReleaseWindow();
+#if defined(_WIN32)
+    if (mapping != nullptr) {
+        CloseHandle(mapping);
+        mapping = nullptr;
+    }
+    if (file != INVALID_HANDLE_VALUE) {
+        CloseHandle(file);
+        file = INVALID_HANDLE_VALUE;
+    }
+#elif defined(__EMSCRIPTEN__)
+    if (file != nullptr) {
+        fclose(file);
+        file = nullptr;
+    }
+#else
+    if (fd >= 0) {
+        close(fd);
+        fd = -1;
+    }
+#endif
+    fileSize = 0;
+    pipeCount = 0;
+    readAheadFirst = 0;
+}
+
+void CourseFile::ReleaseWindow()
+{
+#if defined(_WIN32)
+    if (view != nullptr) {
+        UnmapViewOfFile(view);
+        view = nullptr;
+    }
+#elif !defined(__EMSCRIPTEN__)
+    if (view != nullptr) {
+        munmap(view, viewBytes);
+        view = nullptr;
+        viewBytes = 0;
+    }
+#endif
+    window = nullptr;
+    windowFirst = 0;
+    windowCount = 0;
+    windowBytes = 0;
+}
+
+bool CourseFile::MoveWindow(uint64_t index)
+{
+    ReleaseWindow();
+    uint64_t first = index - index % windowPipes;
+    uint64_t count = std::min(windowPipes, pipeCount - first);
+    uint64_t start = RecordOffset(first);
+    size_t bytes = (size_t)(count * sizeof(CoursePipe));
+#if defined(_WIN32)
+    uint64_t mapStart = start - start % mapAlignment;
+    size_t mapBytes = (size_t)(start - mapStart) + bytes;
+    view = MapViewOfFile(mapping, FILE_MAP_READ, (DWORD)(mapStart >> 32), (DWORD)mapStart, mapBytes);
+    if (view == nullptr) {
+        return false;
+    }
+    window = static_cast<const unsigned char*>(view) + (start - mapStart);
+#elif defined(__EMSCRIPTEN__)
+    // The web build's files live in memory already; a buffer keeps the same window logic
+    buffer.resize(bytes);
+    if (fseek(file, (long)start, SEEK_SET) != 0 || fread(buffer.data(), 1, bytes, file) != bytes) {
+        return false;
+    }
+    window = buffer.data();
+#else
+    uint64_t mapStart = start - start % mapAlignment;
+    viewBytes = (size_t)(start - mapStart) + bytes;
+    view = mmap(nullptr, viewBytes, PROT_READ, MAP_SHARED, fd, (off_t)mapStart);
+    if (view == MAP_FAILED) {
+        view = nullptr;
+        viewBytes = 0;
+        return false;
+    }
+    // Pipes are pulled front to back, so the kernel can read ahead and drop behind
+    madvise(view, viewBytes, MADV_SEQUENTIAL);
+    window = static_cast<const unsigned char*>(view) + (start - mapStart);
+#endif
+    windowFirst = first;
+    windowCount = count;
+    windowBytes = bytes;
+    windowMoves++;
+    return true;
+}
+
+void CourseFile::ReadAhead(uint64_t index)
+{
+    // Halfway through a window, start reading the next one so sliding onto it
+    // doesn't stall the frame on disk
+    uint64_t next = windowFirst + windowCount;
+    if (index < windowFirst + windowCount / 2 || next >= pipeCount || readAheadFirst == next) {
+        return;
+    }
+    readAheadFirst = next;
+#if !defined(_WIN32) && !defined(__EMSCRIPTEN__)
+    uint64_t count = std::min(windowPipes, pipeCount - next);
+    posix_fadvise(fd, (off_t)RecordOffset(next), (off_t)(count * sizeof(CoursePipe)), POSIX_FADV_WILLNEED);
+#endif
+    // Windows reads ahead on its own for sequential faults on a mapped view
+}
+
+const CoursePipe* CourseFile::Pipe(uint64_t index)
+{
+    if (index >= pipeCount) {
+        return nullptr;
+    }
+    if (index < windowFirst || index >= windowFirst + windowCount || window == nullptr) {
+        if (!MoveWindow(index)) {
+            return nullptr;
+        }
+    }
+    ReadAhead(index);
+    return reinterpret_cast<const CoursePipe*>(window + (index - windowFirst) * sizeof(CoursePipe));
+}
+
+bool CourseFile::NextPipe(uint32_t index, SimState&, const SimConfig&, PipeSpec& spec)
+{
+    const CoursePipe* pipe = Pipe(index);
+    if (pipe == nullptr) {
+        return false;
+    }
+    spec.gapCenter = (float)pipe->gapCenter;
+    spec.speed = (float)pipe->speed;
+    spec.spacing = (float)pipe->spacing;
+    return true;
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "simulation.h"
+
+// Binary course files: hand-authored or pre-generated pipe sequences that replace the
+// random gaps. A CourseHeader followed by pipeCount fixed-size CoursePipe records,
+// little endian. Write them with tools/coursegen.
+
+struct CourseHeader {
+    uint32_t magic;         // courseMagic
+    uint16_t version;       // courseVersion
+    uint16_t recordSize;    // sizeof(CoursePipe)
+    uint64_t pipeCount;
+    uint32_t reserved[2];
+};
+
+struct CoursePipe {
+    uint16_t gapCenter;     // Pixels from the top of the 960x540 game screen
+    uint16_t speed;         // Pipe speed from this pipe on in pixels per second, 0 keeps the ramp
+    uint16_t spacing;       // Travel to the next pipe in pixels, 0 for the default
+    uint16_t reserved;
+};
+
+static_assert(sizeof(CourseHeader) == 24, "CourseHeader must stay a fixed 24 bytes");
+static_assert(sizeof(CoursePipe) == 8, "CoursePipe must stay a fixed 8 bytes");
+
+const uint32_t courseMagic = 0x43524B48;   // "HKRC"
+const uint16_t courseVersion = 1;
+
+// Streams a course file through a fixed-size window, so a marathon course of millions
+// of pipes costs the same memory as a short one. On desktop the window is a read-only
+// mapping that slides forward as pipes are pulled, and the next window is handed to the
+// kernel's read-ahead once the player is halfway through the current one. Web builds
+// read the window into a buffer instead.
+class CourseFile : public GapSource
+{
+public:
+    CourseFile();
+    ~CourseFile() override;
+    CourseFile(const CourseFile&) = delete;
+    CourseFile& operator=(const CourseFile&) = delete;
+
+    // Returns false with Error() set when the file is missing or not a valid course
+    bool Open(const char* path);
+    void Close();
+    bool IsOpen() const { return pipeCount > 0; }
+    const std::string& Error() const { return error; }
+
+    uint64_t PipeCount() const { return pipeCount; }
+    // Record of pipe index, nullptr past the end or when the window can't be read
+    const CoursePipe* Pipe(uint64_t index);
+
+    bool NextPipe(uint32_t index, SimState& state, const SimConfig& config, PipeSpec& spec) override;
+
+    // Mapped or buffered bytes, constant for any course longer than one window
+    size_t WindowBytes() const { return windowBytes; }
+    uint64_t WindowMoves() const { return windowMoves; }
+
+private:
+    bool MoveWindow(uint64_t index);
+    void ReleaseWindow();
+    void ReadAhead(uint64_t index);
+
+    std::string error;
+    uint64_t fileSize;
+    uint64_t pipeCount;
+    uint64_t windowFirst;       // First pipe inside the window
+    uint64_t windowCount;       // Pipes inside the window
+    uint64_t readAheadFirst;    // First pipe of the last read-ahead request
+    const unsigned char* window;    // Record of windowFirst
+    size_t windowBytes;
+    uint64_t windowMoves;
+#if defined(_WIN32)
+    void* file;
+    void* mapping;
+    void* view;
+#elif defined(__EMSCRIPTEN__)
+    FILE* file;
+    std::vector<unsigned char> buffer;
+#else
+    int fd;
+    void* view;
+    size_t viewBytes;
+#endif
+};
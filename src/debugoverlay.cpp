@@ -0,0 +1,186 @@
+#include <algorithm>
+#include <sstream>
+
+#include "debugoverlay.h"
+
+namespace
+{
+    const DebugColor playerBoxColor = { 230, 41, 55, 255 };
+    const DebugColor spriteBoxColor = { 230, 41, 55, 90 };
+    const DebugColor pipeBoxColor = { 255, 161, 0, 255 };
+    const DebugColor fatalPipeColor = { 230, 41, 55, 255 };
+    const DebugColor gapColor = { 0, 228, 48, 60 };
+    const DebugColor nextGapColor = { 0, 228, 48, 160 };
+    const DebugColor reachColor = { 102, 191, 255, 50 };
+    const DebugColor reachEdgeColor = { 102, 191, 255, 200 };
+    const DebugColor unreachableColor = { 230, 41, 55, 160 };
+    const DebugColor fallArcColor = { 255, 255, 255, 200 };
+    const DebugColor flapArcColor = { 253, 249, 0, 230 };
+    const DebugColor spawnTrackColor = { 0, 0, 0, 100 };
+    const DebugColor spawnColor = { 255, 0, 255, 200 };
+    const DebugColor spawnEndedColor = { 130, 130, 130, 200 };
+
+    const int maxPredictTicks = 2 * simTickRate;
+    const int arcSampleTicks = 4;       // Ticks per recorded line segment
+    const float barWidth = 6.0f;
+
+    // Player heights tick by tick, integrated exactly like Simulation::Step
+    struct Prediction {
+        std::vector<float> fall;        // Never flapping: the path without input and the lowest reach
+        std::vector<float> climb;       // Flapping every tick: the highest reach
+        std::vector<float> flap;        // One flap now, then falling
+    };
+
+    void Predict(const SimState& state, const SimConfig& config, int ticks, Prediction& out)
+    {
+        const float dt = simTickDt;
+        float fallY = state.playerY, fallVelocity = state.playerVelocity;
+        float climbY = state.playerY;
+        float flapY = state.playerY, flapVelocity = config.jumpForce;
+        out.fall.assign(1, state.playerY);
+        out.climb.assign(1, state.playerY);
+        out.flap.assign(1, state.playerY);
+        for (int tick = 0; tick < ticks; tick++) {
+            fallVelocity += config.gravity * dt;
+            fallY += fallVelocity * dt;
+            float climbVelocity = config.jumpForce + config.gravity * dt;
+            climbY += climbVelocity * dt;
+            flapVelocity += config.gravity * dt;
+            flapY += flapVelocity * dt;
+            out.fall.push_back(fallY);
+            out.climb.push_back(climbY);
+            out.flap.push_back(flapY);
+        }
+    }
+
+    // Line segments of a predicted path while it stays on the play field
+    void RecordArc(DebugDrawList& list, const std::vector<float>& heights, float playerX, float speed,
+        const SimConfig& config, DebugColor color)
+    {
+        for (size_t tick = arcSampleTicks; tick < heights.size(); tick += arcSampleTicks) {
+            float y0 = heights[tick - arcSampleTicks];
+            float y1 = heights[tick];
+            if (y1 < 0.0f || y1 > config.height) {
+                break;
+            }
+            list.Line(playerX + speed * (tick - arcSampleTicks) * simTickDt, y0, playerX + speed * tick * simTickDt, y1, color);
+        }
+    }
+}
+
+uint32_t ParseDebugLayers(const std::string& names)
+{
+    uint32_t layers = 0;
+    std::stringstream stream(names);
+    std::string name;
+    while (std::getline(stream, name, ',')) {
+        if (name == "all") {
+            layers |= DEBUG_LAYER_ALL;
+        } else if (name == "boxes") {
+            layers |= DEBUG_LAYER_BOXES;
+        } else if (name == "gaps") {
+            layers |= DEBUG_LAYER_GAPS;
+        } else if (name == "reach") {
+            layers |= DEBUG_LAYER_REACH;
+        } else if (name == "arcs") {
+            layers |= DEBUG_LAYER_ARCS;
+        } else if (name == "spawn") {
+            layers |= DEBUG_LAYER_SPAWN;
+        }
+    }
+    return layers;
+}
+
+void DebugDrawList::RectLines(float x, float y, float width, float height, DebugColor color)
+{
+    Line(x, y, x + width, y, color);
+    Line(x + width, y, x + width, y + height, color);
+    Line(x + width, y + height, x, y + height, color);
+    Line(x, y + height, x, y, color);
+}
+
+void RecordDebugOverlay(DebugDrawList& list, const Simulation& simulation, uint32_t layers)
+{
+    list.Clear();
+    const SimState& state = simulation.State();
+    const SimConfig& config = simulation.Config();
+    float halfWidth = config.playerSize * config.playerCollisionWidthRatio / 2;
+    float halfHeight = config.playerSize * config.playerCollisionHeightRatio / 2;
+
+    if (layers & DEBUG_LAYER_GAPS) {
+        for (const Pipe& pipe : state.pipes) {
+            list.Rect(pipe.x, pipe.gapCenter - config.pipeGap / 2, config.pipeWidth, config.pipeGap, gapColor);
+        }
+        // Random gaps walk at most maxGapHeightDifference from the newest pipe
+        if (!simulation.HasCourse() && !state.pipes.empty()) {
+            float newest = state.pipes.back().gapCenter;
+            float low = std::max(config.pipeGap / 2, newest - config.maxGapHeightDifference);
+            float high = std::min(config.height - config.pipeGap / 2, newest + config.maxGapHeightDifference);
+            list.Rect(config.width - barWidth, low - config.pipeGap / 2, barWidth, high - low + config.pipeGap, gapColor);
+            list.Rect(config.width - barWidth, low, barWidth, high - low, nextGapColor);
+        }
+    }
+
+    if (layers & (DEBUG_LAYER_REACH | DEBUG_LAYER_ARCS)) {
+        // The pipe speed ramp is ignored, a couple of seconds ahead it barely moves
+        float speed = std::max(state.pipeSpeed, 1.0f);
+        int ticks = std::min(maxPredictTicks, (int)((config.width - state.playerX) / speed * simTickRate) + 1);
+        Prediction prediction;
+        Predict(state, config, ticks, prediction);
+
+        if (layers & DEBUG_LAYER_REACH) {
+            for (const Pipe& pipe : state.pipes) {
+                // Where the box's leading edge meets the pipe
+                float travel = pipe.x - (state.playerX + halfWidth);
+                if (travel < 0.0f || pipe.scored) {
+                    continue;
+                }
+                int tick = (int)(travel / speed * simTickRate);
+                if (tick >= (int)prediction.fall.size()) {
+                    continue;
+                }
+                float top = std::max(prediction.climb[tick], halfHeight);
+                float bottom = std::min(prediction.fall[tick], config.height - halfHeight);
+                // Box centers that fit through the gap; none reachable means the pipe is lost
+                float gapTop = pipe.gapCenter - config.pipeGap / 2 + halfHeight;
+                float gapBottom = pipe.gapCenter + config.pipeGap / 2 - halfHeight;
+                bool reachable = top <= gapBottom && bottom >= gapTop;
+                list.Rect(pipe.x - barWidth, top, barWidth, std::max(bottom - top, 1.0f), reachable ? reachColor : unreachableColor);
+            }
+            RecordArc(list, prediction.climb, state.playerX, speed, config, reachEdgeColor);
+        }
+        if (layers & DEBUG_LAYER_ARCS) {
+            RecordArc(list, prediction.fall, state.playerX, speed, config, fallArcColor);
+            RecordArc(list, prediction.flap, state.playerX, speed, config, flapArcColor);
+        }
+    }
+
+    if (layers & DEBUG_LAYER_SPAWN) {
+        float phase = state.pipeSpawnInterval > 0.0f ? std::min(state.pipeSpawnTimer / state.pipeSpawnInterval, 1.0f) : 0.0f;
+        list.Rect(0.0f, config.height - barWidth, config.width, barWidth, spawnTrackColor);
+        list.Rect(0.0f, config.height - barWidth, config.width * phase, barWidth, state.gapSourceEnded ? spawnEndedColor : spawnColor);
+        if (!state.gapSourceEnded && !state.pipes.empty()) {
+            // Where the newest pipe will be when the next one appears at the right edge
+            float remaining = std::max(state.pipeSpawnInterval - state.pipeSpawnTimer, 0.0f);
+            float x = state.pipes.back().x - state.pipeSpeed * remaining;
+            list.Line(x, config.height - 3 * barWidth, x, config.height, spawnColor);
+        }
+    }
+
+    if (layers & DEBUG_LAYER_BOXES) {
+        for (const Pipe& pipe : state.pipes) {
+            bool fatal = state.gameOver && pipe.x == state.fatalPipe.x && pipe.gapCenter == state.fatalPipe.gapCenter;
+            DebugColor color = fatal ? fatalPipeColor : pipeBoxColor;
+            float gapTop = pipe.gapCenter - config.pipeGap / 2;
+            float gapBottom = pipe.gapCenter + config.pipeGap / 2;
+            list.RectLines(pipe.x, 0.0f, config.pipeWidth, gapTop, color);
+            list.RectLines(pipe.x, gapBottom, config.pipeWidth, config.height - gapBottom, color);
+        }
+        if (simulation.HasPlayerMasks()) {
+            // Pixel collision tests the sprite's mask inside this square
+            list.RectLines(state.playerX - config.playerSize / 2, state.playerY - config.playerSize / 2,
+                config.playerSize, config.playerSize, spriteBoxColor);
+        }
+        list.RectLines(state.playerX - halfWidth, state.playerY - halfHeight, halfWidth * 2, halfHeight * 2, playerBoxColor);
+    }
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "simulation.h"
+
+// Balance debugging shapes drawn over the play field, recorded from the simulation
+// state like the scene itself. Toggled at runtime (F1), so release builds can show
+// it; while it is off nothing is recorded or drawn.
+
+enum DebugLayer : uint32_t {
+    DEBUG_LAYER_BOXES = 1 << 0,     // Player and pipe collision boxes
+    DEBUG_LAYER_GAPS = 1 << 1,      // Gap bands and where the next gap can land
+    DEBUG_LAYER_REACH = 1 << 2,     // Heights the player can still reach, up to each pipe
+    DEBUG_LAYER_ARCS = 1 << 3,      // Predicted paths without input and with a flap now
+    DEBUG_LAYER_SPAWN = 1 << 4,     // Spawn timer phase
+    DEBUG_LAYER_ALL = (1 << 5) - 1
+};
+
+// Parses "boxes,gaps,reach,arcs,spawn" (or "all"); unknown names are ignored
+uint32_t ParseDebugLayers(const std::string& names);
+
+struct DebugColor {
+    uint8_t r, g, b, a;
+};
+
+struct DebugRect {
+    float x, y, width, height;
+    DebugColor color;
+};
+
+struct DebugLine {
+    float x0, y0, x1, y1;
+    DebugColor color;
+};
+
+// Filled rectangles and lines, kept apart so each kind is submitted as one batch.
+// Outlines are recorded as four lines.
+class DebugDrawList
+{
+public:
+    void Clear() { rects.clear(); lines.clear(); }
+    void Rect(float x, float y, float width, float height, DebugColor color) { rects.push_back({ x, y, width, height, color }); }
+    void Line(float x0, float y0, float x1, float y1, DebugColor color) { lines.push_back({ x0, y0, x1, y1, color }); }
+    void RectLines(float x, float y, float width, float height, DebugColor color);
+
+    std::vector<DebugRect> rects;
+    std::vector<DebugLine> lines;
+};
+
+void RecordDebugOverlay(DebugDrawList& list, const Simulation& simulation, uint32_t layers);
@@ -0,0 +1,60 @@
+#include <cstring>
+
+#include "drawlist.h"
+#include "scenery.h"
+
+void RecordScene(DrawList& list, const SimState& state, const SimConfig& config, const SceneTextureSizes& sizes,
+    const SceneryResidency& scenery, float backgroundScrollX, float screenWidth, float screenHeight)
+{
+    list.Clear();
+    RecordScenery(list, scenery, backgroundScrollX, screenWidth, screenHeight);
+
+    // Pipes: stretched body plus a fixed-height cap at the gap edge
+    const float capHeight = 24.0f; // Cap height in the pipe image
+    float pipeImgWidth = (float)sizes.width[DRAW_TEXTURE_PIPE];
+    float bodyHeight = (float)sizes.height[DRAW_TEXTURE_PIPE] - capHeight;
+    for (const auto& pipe : state.pipes) {
+        float topPipeHeight = pipe.gapCenter - config.pipeGap / 2;
+        float bottomPipeY = pipe.gapCenter + config.pipeGap / 2;
+        float bottomPipeHeight = config.height - bottomPipeY;
+
+        if (topPipeHeight > 0) {
+            float bodyDrawHeight = topPipeHeight - capHeight;
+            if (bodyDrawHeight > 0) {
+                list.AddQuad(DRAW_TEXTURE_PIPE, { 0, capHeight, pipeImgWidth, bodyHeight }, { pipe.x, 0, config.pipeWidth, bodyDrawHeight });
+            }
+            list.AddQuad(DRAW_TEXTURE_PIPE, { 0, 0, pipeImgWidth, capHeight }, { pipe.x, bodyDrawHeight, config.pipeWidth, capHeight });
+        }
+
+        if (bottomPipeHeight > 0) {
+            float bodyDrawHeight = bottomPipeHeight - capHeight;
+            if (bodyDrawHeight > 0) {
+                list.AddQuad(DRAW_TEXTURE_PIPE, { 0, capHeight, pipeImgWidth, bodyHeight }, { pipe.x, bottomPipeY + capHeight, config.pipeWidth, bodyDrawHeight });
+            }
+            list.AddQuad(DRAW_TEXTURE_PIPE, { 0, 0, pipeImgWidth, capHeight }, { pipe.x, bottomPipeY, config.pipeWidth, capHeight });
+        }
+    }
+
+    // Player: eyes closed while flapping and after crashing
+    DrawTexture playerTexture = (state.gameOver || state.playerEyesClosedTimer > 0.0f)
+        ? DRAW_TEXTURE_PLAYER_EYES_CLOSED : DRAW_TEXTURE_PLAYER;
+    list.AddQuad(playerTexture,
+        { 0, 0, (float)sizes.width[playerTexture], (float)sizes.height[playerTexture] },
+        { state.playerX - config.playerSize / 2, state.playerY - config.playerSize / 2, config.playerSize, config.playerSize });
+}
+
+uint64_t HashDrawList(const DrawList& list)
+{
+    uint64_t hash = 14695981039346656037ull;
+    for (const DrawQuad& quad : list.quads) {
+        float values[8] = { quad.source.x, quad.source.y, quad.source.width, quad.source.height,
+                            quad.dest.x, quad.dest.y, quad.dest.width, quad.dest.height };
+        uint32_t bits[8];
+        memcpy(bits, values, sizeof(bits));
+        for (uint32_t word : bits) {
+            hash = (hash ^ word) * 1099511628211ull;
+        }
+        hash = (hash ^ quad.texture) * 1099511628211ull;
+    }
+    return hash;
+}
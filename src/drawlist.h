@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "simulation.h"
+
+// Records the scene as a flat list of textured quads instead of drawing it directly.
+// The game submits the list through raylib; headless tools build the same list to
+// exercise and time the draw path without a window or GPU.
+
+enum DrawTexture : uint8_t {
+    DRAW_TEXTURE_SKY = 0,
+    DRAW_TEXTURE_PIPE,
+    DRAW_TEXTURE_PLAYER,
+    DRAW_TEXTURE_PLAYER_EYES_CLOSED,
+    DRAW_TEXTURE_COUNT,
+    DRAW_TEXTURE_SCENERY = DRAW_TEXTURE_COUNT   // First pooled scenery chunk, see SceneryTextureId()
+};
+
+struct SceneryResidency;
+
+struct DrawRect {
+    float x, y, width, height;
+};
+
+struct DrawQuad {
+    DrawRect source;
+    DrawRect dest;
+    uint8_t texture;    // DrawTexture
+};
+
+// Pixel sizes of the scene textures, the only thing the recorder needs to know about them
+struct SceneTextureSizes {
+    int width[DRAW_TEXTURE_COUNT];
+    int height[DRAW_TEXTURE_COUNT];
+};
+
+class DrawList
+{
+public:
+    DrawList() { quads.reserve(64); }
+
+    void Clear() { quads.clear(); }
+    void AddQuad(DrawTexture texture, DrawRect source, DrawRect dest) { quads.push_back({source, dest, (uint8_t)texture}); }
+
+    std::vector<DrawQuad> quads;
+};
+
+// Records scenery, pipes and player for one frame of the given simulation state
+void RecordScene(DrawList& list, const SimState& state, const SimConfig& config, const SceneTextureSizes& sizes,
+    const SceneryResidency& scenery, float backgroundScrollX, float screenWidth, float screenHeight);
+
+// Cheap order-sensitive checksum of a recorded frame, used by the replay gate
+uint64_t HashDrawList(const DrawList& list);
@@ -0,0 +1,42 @@
+#include <algorithm>
+
+#include "frameskipper.h"
+
+FrameSkipper::FrameSkipper()
+    : budget(1.0f / 60.0f), maxConsecutiveSkips(2), allowSkip(false), lag(0.0f), drawCost(0.0f),
+      consecutiveSkips(0), framesSkipped(0), framesDrawn(0)
+{
+}
+
+void FrameSkipper::BeginFrame(float frameTime)
+{
+    lag = std::min(maxLag, std::max(0.0f, lag + frameTime - budget));
+    allowSkip = false;
+}
+
+void FrameSkipper::AllowSkipping(bool allow)
+{
+    allowSkip = allow;
+    if (!allow) {
+        lag = 0.0f;     // Time spent in menus isn't worth catching up on
+    }
+}
+
+bool FrameSkipper::ShouldDraw()
+{
+    // A skipped frame returns a whole draw's worth of time, so it only helps when
+    // the loop is at least that far behind
+    if (allowSkip && drawCost > 0.0f && lag > drawCost && consecutiveSkips < maxConsecutiveSkips) {
+        consecutiveSkips++;
+        framesSkipped++;
+        return false;
+    }
+    consecutiveSkips = 0;
+    framesDrawn++;
+    return true;
+}
+
+void FrameSkipper::RecordDrawCost(float seconds)
+{
+    drawCost = drawCost == 0.0f ? seconds : drawCost + (seconds - drawCost) * costSmoothing;
+}
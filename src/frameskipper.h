@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+
+// Drops presents while the main loop is behind its frame budget. The simulation is
+// never skipped: every frame still runs the ticks its time covers, so only what is
+// shown gets choppier and gameplay timing stays exact on slow hardware. A frame is
+// skipped when the loop is further behind than one draw costs, never more than
+// maxConsecutiveSkips in a row so the screen keeps updating.
+class FrameSkipper
+{
+public:
+    FrameSkipper();
+
+    void SetBudget(float seconds) { budget = seconds; }
+    float Budget() const { return budget; }
+    void SetMaxConsecutiveSkips(int count) { maxConsecutiveSkips = count; }
+
+    // Start of a frame, frameTime is the wall time of the previous one. Skipping is
+    // off until AllowSkipping(true), so menus and pauses always draw.
+    void BeginFrame(float frameTime);
+    void AllowSkipping(bool allow);
+
+    // Whether this frame is drawn; counts the decision
+    bool ShouldDraw();
+    // Wall time of a drawn frame's rendering, without the frame limiter's wait
+    void RecordDrawCost(float seconds);
+
+    uint64_t FramesSkipped() const { return framesSkipped; }
+    uint64_t FramesDrawn() const { return framesDrawn; }
+    float DrawCost() const { return drawCost; }
+    float Lag() const { return lag; }
+
+private:
+    float budget;
+    int maxConsecutiveSkips;
+    bool allowSkip;
+    float lag;              // How far the loop is behind its budget, seconds
+    float drawCost;         // Moving average of RecordDrawCost
+    int consecutiveSkips;
+    uint64_t framesSkipped;
+    uint64_t framesDrawn;
+
+    const float maxLag = 0.25f;         // Same clamp as the simulation's catch-up
+    const float costSmoothing = 0.1f;
+};
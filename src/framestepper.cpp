@@ -0,0 +1,146 @@
+#include <cstdio>
+
+#include "framestepper.h"
+
+FrameStepper::FrameStepper(size_t capacity)
+    : records(capacity < 2 ? 2 : capacity), head(0), count(0), cursor(0), measuring(false), diverged(false)
+{
+}
+
+void FrameStepper::Reset(const Simulation& simulation)
+{
+    head = 0;
+    count = 1;
+    cursor = 0;
+    diverged = false;
+    StepRecord& record = records[0];
+    record.state = simulation.State();
+    record.hash = simulation.Hash();
+    record.flap = false;
+    record.events = 0;
+    record.measured = false;
+    record.drawNs = 0;
+}
+
+uint32_t FrameStepper::Advance(Simulation& simulation, bool flap)
+{
+    if (count == 0) {
+        Reset(simulation);
+    }
+
+    // A new input after stepping back starts a new branch
+    count = cursor + 1;
+    if (count == records.size()) {
+        head = (head + 1) % records.size();
+        count--;
+        cursor--;
+    }
+
+    StepRecord& record = records[Slot(count)];
+    simulation.SetProfile(measuring ? &record.profile : nullptr);
+    uint32_t events = simulation.Step(flap);
+    simulation.SetProfile(nullptr);
+
+    // Assignment reuses the pipe vector's storage once the ring has filled
+    record.state = simulation.State();
+    record.hash = simulation.Hash();
+    record.flap = flap;
+    record.events = events;
+    record.measured = measuring;
+    record.drawNs = 0;
+    count++;
+    cursor = count - 1;
+    return events;
+}
+
+bool FrameStepper::StepBack(Simulation& simulation)
+{
+    if (cursor == 0) {
+        return false;
+    }
+    cursor--;
+    simulation.MutableState() = Current().state;
+    return true;
+}
+
+bool FrameStepper::StepForward(Simulation& simulation)
+{
+    if (AtNewest()) {
+        return false;
+    }
+
+    // Re-run the tick rather than just restoring it, so it is measured again
+    // and any non-determinism shows up as a hash mismatch
+    StepRecord& record = records[Slot(cursor + 1)];
+    simulation.MutableState() = Current().state;
+    simulation.SetProfile(&record.profile);
+    record.events = simulation.Step(record.flap);
+    simulation.SetProfile(nullptr);
+    record.measured = true;
+    record.drawNs = 0;
+    if (simulation.Hash() != record.hash) {
+        diverged = true;
+    }
+    cursor++;
+    return true;
+}
+
+void FrameStepper::SetDrawCost(uint32_t ns)
+{
+    if (count > 0) {
+        records[Slot(cursor)].drawNs = ns;
+    }
+}
+
+std::string DescribeTick(const StepRecord& record, const SimConfig& config)
+{
+    static const char* sectionNames[SIM_SECTION_COUNT] = {
+        "input", "speed", "physics", "spawn", "pipes", "cleanup"
+    };
+
+    const SimState& state = record.state;
+    std::string text;
+    char line[160];
+
+    snprintf(line, sizeof(line), "tick %u%s%s%s%s%s\n", state.tick,
+        record.flap ? "  FLAP" : "",
+        (record.events & SIM_EVENT_SCORE) ? "  SCORE" : "",
+        (record.events & SIM_EVENT_PIPE_SPAWNED) ? "  SPAWN" : "",
+        (record.events & SIM_EVENT_DEATH) ? "  DEATH" : "",
+        state.gameOver ? "  (over)" : "");
+    text += line;
+    snprintf(line, sizeof(line), "player x %.2f y %.3f vy %.3f eyes %.3f\n",
+        state.playerX, state.playerY, state.playerVelocity, state.playerEyesClosedTimer);
+    text += line;
+    float halfHeight = config.playerSize * config.playerCollisionHeightRatio / 2;
+    snprintf(line, sizeof(line), "box top %.3f bottom %.3f\n", state.playerY - halfHeight, state.playerY + halfHeight);
+    text += line;
+    snprintf(line, sizeof(line), "pipeSpeed %.3f spawn %.4f / %.4f\n",
+        state.pipeSpeed, state.pipeSpawnTimer, state.pipeSpawnInterval);
+    text += line;
+    snprintf(line, sizeof(line), "score %d spawned %u rng %08x hash %016llx\n",
+        state.score, state.pipesSpawned, state.rngState, (unsigned long long)record.hash);
+    text += line;
+
+    for (size_t i = 0; i < state.pipes.size(); i++) {
+        const Pipe& pipe = state.pipes[i];
+        snprintf(line, sizeof(line), "pipe %zu x %.3f gap %.1f [%.1f..%.1f]%s\n", i, pipe.x, pipe.gapCenter,
+            pipe.gapCenter - config.pipeGap / 2, pipe.gapCenter + config.pipeGap / 2, pipe.scored ? " scored" : "");
+        text += line;
+    }
+
+    if (record.measured) {
+        uint32_t total = 0;
+        text += "cost ns:";
+        for (int i = 0; i < SIM_SECTION_COUNT; i++) {
+            snprintf(line, sizeof(line), " %s %u", sectionNames[i], record.profile.sectionNs[i]);
+            text += line;
+            total += record.profile.sectionNs[i];
+        }
+        snprintf(line, sizeof(line), " | sim %u draw %u\n", total, record.drawNs);
+        text += line;
+    } else {
+        text += "cost: not measured (step forward to measure)\n";
+    }
+    return text;
+}
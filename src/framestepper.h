@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "simulation.h"
+
+// Tick-by-tick debugger for the Simulation. Every tick goes through Advance(), which
+// keeps a ring of state snapshots; StepBack() restores an older snapshot and
+// StepForward() re-runs the recorded input from it, re-measuring the tick and
+// checking it lands on the same state. Used by the game's step mode and by the
+// headless stepper tool.
+
+struct StepRecord {
+    SimState state;             // State after the tick
+    uint64_t hash;              // Simulation::Hash() of state
+    bool flap;                  // Input applied on this tick
+    uint32_t events;            // SimEvent bits
+    bool measured;              // profile/drawNs are valid
+    SimTickProfile profile;
+    uint32_t drawNs;            // Scene recording for this state
+};
+
+class FrameStepper
+{
+public:
+    explicit FrameStepper(size_t capacity = 10 * simTickRate);
+
+    // Starts a new history at the simulation's current state
+    void Reset(const Simulation& simulation);
+    // Time each tick's sections (costs a few clock reads per tick)
+    void SetMeasuring(bool measuring) { this->measuring = measuring; }
+
+    // Runs a new tick; stepping back first drops the ticks after the current one
+    uint32_t Advance(Simulation& simulation, bool flap);
+    bool StepBack(Simulation& simulation);
+    bool StepForward(Simulation& simulation);
+
+    bool AtNewest() const { return cursor + 1 == count; }
+    size_t Depth() const { return cursor; }    // Ticks available to step back
+    bool Diverged() const { return diverged; }  // A re-run tick didn't reproduce its snapshot
+
+    const StepRecord& Current() const { return records[Slot(cursor)]; }
+    void SetDrawCost(uint32_t ns);
+
+private:
+    size_t Slot(size_t index) const { return (head + index) % records.size(); }
+
+    std::vector<StepRecord> records;
+    size_t head;        // Oldest record
+    size_t count;
+    size_t cursor;      // Record matching the simulation's state
+    bool measuring;
+    bool diverged;
+};
+
+// Multi-line description of a tick: player, timers, every pipe and the section costs
+std::string DescribeTick(const StepRecord& record, const SimConfig& config);
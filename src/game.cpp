@@ -4,16 +4,136 @@
 #include <cmath>  // For sqrtf
 #include <algorithm> // For std::remove_if
 #include <fstream>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 
 #include "raylib.h"
+#include "rlgl.h"
 #include "globals.h"
 #include "game.h"
+#include "sampler.h"
+#include "autopilot.h"
+#include "practice.h"
+#include "jobsystem.h"
 
 #ifdef __EMSCRIPTEN__
 #include <emscripten.h>
+#include <emscripten/heap.h>
 #endif
 
-//#define DEBUG
+namespace
+{
+    // TaskScheduler keys of work that is posted again while still queued
+    enum GameTaskKey : uint32_t {
+        TASK_KEY_HIGH_SCORE = 1,
+        TASK_KEY_REPLAY,
+        TASK_KEY_SCENERY_UPLOAD,
+    };
+
+    const size_t fileWriteChunk = 16 * 1024;   // Bytes per save step
+
+    // Writes a file a chunk per step. A whole file is written under a temporary name
+    // that replaces the old one once complete, so quitting mid-save never leaves a
+    // truncated high score or replay behind; appends go straight to the file.
+    class FileWriter
+    {
+    public:
+        FileWriter(const std::string& path, std::vector<uint8_t> bytes, bool append)
+            : path(path), bytes(std::move(bytes)), append(append), file(nullptr), written(0)
+        {
+        }
+
+        bool Step()
+        {
+            if (file == nullptr) {
+                file = fopen(append ? path.c_str() : (path + ".tmp").c_str(), append ? "ab" : "wb");
+                if (file == nullptr) {
+                    TraceLog(LOG_WARNING, "SAVE: Can't write %s", path.c_str());
+                    return true;
+                }
+            }
+            size_t chunk = std::min(fileWriteChunk, bytes.size() - written);
+            written += fwrite(bytes.data() + written, 1, chunk, file);
+            if (written < bytes.size() && !ferror(file)) {
+                return false;
+            }
+            bool ok = !ferror(file);
+            fclose(file);
+            file = nullptr;
+            if (!append && ok) {
+                remove(path.c_str());   // rename doesn't replace on Windows
+                ok = rename((path + ".tmp").c_str(), path.c_str()) == 0;
+            }
+            if (!ok) {
+                TraceLog(LOG_WARNING, "SAVE: Writing %s failed", path.c_str());
+            }
+            return true;
+        }
+
+    private:
+        std::string path;
+        std::vector<uint8_t> bytes;
+        bool append;
+        FILE* file;
+        size_t written;
+    };
+
+    // Mixer slots of the sound effects
+    enum GameClip : uint32_t {
+        CLIP_FLY,
+        CLIP_HIT,
+        CLIP_SCORE,
+    };
+
+    const float effectPanWidth = 0.6f;      // Pan at the screen edges
+    const float deathDuckGain = 0.25f;      // Music level under the hit and the game over screen
+    const float duckReleaseSeconds = 0.5f;
+    const float musicVolume = 0.15f;
+    const float maxMusicTempo = 1.3f;       // At the pipes' top speed, the base speed plays as recorded
+
+    float MusicTempo(const Simulation& simulation)
+    {
+        const SimConfig& config = simulation.Config();
+        float ramp = (simulation.State().pipeSpeed - config.basePipeSpeed) / (config.maxSpeed - config.basePipeSpeed);
+        return 1.0f + (maxMusicTempo - 1.0f) * std::max(0.0f, std::min(ramp, 1.0f));
+    }
+
+    // raylib's mixed processor callback has no user pointer
+    AudioMixer* attachedMixer = nullptr;
+
+    void MixAudio(void* buffer, unsigned int frames)
+    {
+        attachedMixer->Mix(static_cast<float*>(buffer), frames);
+    }
+
+    // raylib converts sounds to the device's rate and reports it on the stream, it has
+    // no other getter for it
+    unsigned int DeviceSampleRate()
+    {
+        float silence = 0.0f;
+        Wave wave = { 1, 44100, 32, 1, &silence };
+        Sound probe = LoadSoundFromWave(wave);
+        unsigned int rate = probe.stream.sampleRate;
+        UnloadSound(probe);
+        return rate > 0 ? rate : 48000;
+    }
+
+    // Mono float at the mixer's rate, nullptr for an empty wave
+    AudioClip* LoadClip(const Wave& wave, unsigned int sampleRate)
+    {
+        if (wave.frameCount == 0) {
+            return nullptr;
+        }
+        Wave converted = WaveCopy(wave);
+        WaveFormat(&converted, (int)sampleRate, 32, 1);
+        AudioClip* clip = new AudioClip(converted.frameCount);
+        memcpy(clip->samples, converted.data, (size_t)clip->frames * sizeof(float));
+        UnloadWave(converted);
+        return clip;
+    }
+}
 
 bool Game::isMobile = false;
 
@@ -23,39 +143,63 @@ Game::Game(int width, int height)
 
     // Initialize audio device
     InitAudioDevice();
-
-    // Initialize Flappy Bird variables
-    playerSize = 80.0f;
-    playerX = width / 4;
-    playerY = height / 2;
-    playerVelocity = 0.0f;
-    gravity = defaultGravity;
-    jumpForce = defaultJumpForce;
-    pipeWidth = defaultPipeWidth;
-    pipeGap = defaultPipeGap;
-    pipeSpeed = defaultPipeSpeed;
-    basePipeSpeed = pipeSpeed;  // Store initial speed
-    pipeSpawnInterval = defaultPipeSpawnInterval;
-    pipeSpawnTimer = pipeSpawnInterval;  // Initialize to spawn interval to trigger immediate spawn
-    initialPipeDistance = basePipeSpeed * pipeSpawnInterval;  // Store initial distance between pipes
-    speedLevel = 0;             // Start at level 0
+    unsigned int sampleRate = DeviceSampleRate();
+    mixer.SetSampleRate(sampleRate);
+
+    // Sprites and sounds are decoded on every core, the sounds straight into mixer
+    // clips; uploading the sprites to the GPU stays on this thread
+    const char* imagePaths[] = { "Data/redkat_eyes_open.png", "Data/redkat_eyes_closed.png", "Data/pipe.png" };
+    const char* wavePaths[] = { "Data/fly.mp3", "Data/hit.mp3", "Data/ding.mp3" };
+    Image images[3];
+    AudioClip* clips[3];
+    {
+        JobSystem loaders;
+        loaders.ParallelFor(6, 1, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) {
+                if (i < 3) {
+                    images[i] = LoadImage(imagePaths[i]);
+                    ImageFormat(&images[i], PIXELFORMAT_UNCOMPRESSED_R8G8B8A8);
+                } else {
+                    Wave wave = LoadWave(wavePaths[i - 3]);
+                    clips[i - 3] = LoadClip(wave, sampleRate);
+                    UnloadWave(wave);
+                }
+            }
+        });
+    }
 
     // Initialize sounds
-    gameMusic = LoadMusicStream("Data/music.mp3");
-    SetMusicVolume(gameMusic, 0.15f); 
-    flySound = LoadSound("Data/fly.mp3");
-    hitSound = LoadSound("Data/hit.mp3");
-    scoreSound = LoadSound("Data/ding.mp3");
+    music.SetVolume(musicVolume);
+    if (!music.Open("Data/music.mp3")) {
+        TraceLog(LOG_WARNING, "AUDIO: Can't decode Data/music.mp3");
+    }
+    mixer.SetClip(CLIP_FLY, clips[0]);
+    mixer.SetClip(CLIP_HIT, clips[1]);
+    mixer.SetClip(CLIP_SCORE, clips[2]);
+    audioMuffled = false;
+    attachedMixer = &mixer;
+    AttachAudioMixedProcessor(MixAudio);
     musicPlaying = false;  // Start with music off
     musicManuallyDisabled = false;  // Initialize as not manually disabled
+    musicUnderruns = 0;
     // Don't start music immediately, wait for game to begin
 
     // Initialize score
-    score = 0;
     LoadHighScore();
 
-    playerCollisionWidthRatio = 0.70f;
-    playerCollisionHeightRatio = 0.55f;
+    simTicks = 0;
+    drawCalls = 0;
+    frameStartTime = GetTime();
+    showMemory = false;
+    // HOVERCAT_DEBUG=boxes,reach,... starts with the overlay on, F1 toggles all of it
+    const char* debugSetting = getenv("HOVERCAT_DEBUG");
+    debugLayers = debugSetting != nullptr ? ParseDebugLayers(debugSetting) : 0;
+    showDebug = debugLayers != 0;
+    if (debugLayers == 0) {
+        debugLayers = DEBUG_LAYER_ALL;
+    }
+    memoryCheckTimer = 0.0f;
+    memoryWarned = 0;
 
 #ifdef __EMSCRIPTEN__
     // Check if we're running on a mobile device
@@ -64,8 +208,7 @@ Game::Game(int width, int height)
     });
 #endif
 
-    targetRenderTex = LoadRenderTexture(gameScreenWidth, gameScreenHeight);
-    SetTextureFilter(targetRenderTex.texture, TEXTURE_FILTER_BILINEAR);
+    presenter.Init(gameScreenWidth, gameScreenHeight, PRESENT_FIT);
 
     font = LoadFontEx("Font/monogram.ttf", 128, 0, 0);
     SetTextureFilter(font.texture, TEXTURE_FILTER_BILINEAR);
@@ -73,31 +216,60 @@ Game::Game(int width, int height)
     this->width = width;
     this->height = height;
 
-    // Background initialization
-    backgroundTexture = LoadTexture("Data/background.jpg");
+    // Background initialization, the scenery is generated on a worker thread as it scrolls in
+    scenery.Start((uint32_t)GetRandomValue(1, 0x7FFFFFFF));
     backgroundScrollX = 0.0f;
-    backgroundScrollSpeed = basePipeSpeed * 0.2f;  // Set initial scroll speed to 20% of pipe speed
-    playerTexture = LoadTexture("Data/redkat_eyes_open.png");
-    playerTextureEyesClosed = LoadTexture("Data/redkat_eyes_closed.png");
-    playerEyesClosedTimer = 0.0f;
+    backgroundScrollSpeed = simulation.State().pipeSpeed * 0.2f;  // Set initial scroll speed to 20% of pipe speed
+    playerTexture = LoadPlayerSprite(imagePaths[0], images[0], eyesOpenMask);
+    playerTextureEyesClosed = LoadPlayerSprite(imagePaths[1], images[1], eyesClosedMask);
+    if (!eyesOpenMask.Empty() && !eyesClosedMask.Empty()) {
+        simulation.SetPlayerMasks(&eyesOpenMask, &eyesClosedMask);
+    }
+
+    // Initialize the simulation, the first run spawns its first pipe immediately
+    LoadCourse();
+    tickAccumulator = 0.0f;
+    pendingFlap = false;
+    runSeed = (uint32_t)GetRandomValue(1, 0x7FFFFFFF);
+    uint16_t resetFlags = SIM_RESET_SPAWN_IMMEDIATELY | CollisionResetFlags();
+    simulation.Reset(runSeed, resetFlags);
+    replay.Begin(runSeed, resetFlags);
+    stepper.Reset(simulation);
+    masksReloaded[0] = masksReloaded[1] = false;
+    stepMode = false;
+    steppedRun = false;
+    practiceRun = false;
+    practiceSpeed = simulation.Config().maxSpeed;
     InitGame();
 
-    pipeTexture = LoadTexture("Data/pipe.png");
+    pipeTexture = LoadTextureFromImage(images[2]);
+    UnloadImage(images[2]);
+
+    // Needs every scene texture loaded, it draws the real scene offscreen
+    SelectQuality();
+
+#ifdef HOVERCAT_HOT_RELOAD
+    StartAssetWatcher();
+#endif
 }
 
 Game::~Game()
 {
-    UnloadRenderTexture(targetRenderTex);
+    // Pending saves must reach the disk, the rest is harmless to finish
+    tasks.Flush();
+#ifdef HOVERCAT_HOT_RELOAD
+    assetWatcher.Stop();
+#endif
+    presenter.Shutdown();
     UnloadFont(font);
 
-    // Unload background texture
-    UnloadTexture(backgroundTexture);
+    // Stop the scenery worker and unload its textures
+    scenery.Stop();
 
     // Unload sounds
-    UnloadMusicStream(gameMusic);
-    UnloadSound(flySound);
-    UnloadSound(hitSound);
-    UnloadSound(scoreSound);
+    music.Close();
+    DetachAudioMixedProcessor(MixAudio);
+    attachedMixer = nullptr;
     UnloadTexture(playerTexture);
     UnloadTexture(playerTextureEyesClosed);
     UnloadTexture(pipeTexture);
@@ -111,163 +283,181 @@ void Game::InitGame()
     paused = false;
     lostWindowFocus = false;
     gameOver = false;
+}
 
-    screenScale = MIN((float)GetScreenWidth() / gameScreenWidth, (float)GetScreenHeight() / gameScreenHeight);
+void Game::ApplyReloadedMasks()
+{
+    for (int i = 0; i < 2; i++) {
+        if (masksReloaded[i]) {
+            (i == 0 ? eyesOpenMask : eyesClosedMask) = reloadedMasks[i];
+            reloadedMasks[i] = CollisionMask();
+            masksReloaded[i] = false;
+        }
+    }
 }
 
 void Game::Reset()
 {
+    LogState(STATE_RESET);
     InitGame();
-    // Reset player position and velocity
-    playerX = width / 4;
-    playerY = height / 2;
-    playerVelocity = 0.0f;
-    // Clear all pipes
-    pipes.clear();
-    pipeSpawnTimer = 0.0f;
-    pipeSpawnInterval = 2.0f;
-    // Reset score and speed
-    score = 0;
-    speedLevel = 0;
-    pipeSpeed = basePipeSpeed;
+    ApplyReloadedMasks();
+    // Start a fresh run with a new seed
+    runSeed = (uint32_t)GetRandomValue(1, 0x7FFFFFFF);
+    simulation.Reset(runSeed, CollisionResetFlags());
+    replay.Begin(runSeed, CollisionResetFlags());
+    stepper.Reset(simulation);
+    tickAccumulator = 0.0f;
+    pendingFlap = false;
+    practiceRun = false;
+    steppedRun = false;
     
-    // Only restart music if it wasn't manually disabled
+    ResumeMusic();
+}
+
+void Game::StartPracticeRun()
+{
+    LogState(STATE_RESET);
+    InitGame();
+    ApplyReloadedMasks();
+    runSeed = (uint32_t)GetRandomValue(1, 0x7FFFFFFF);
+
+    // The autopilot is only flown when the state can't be built directly
+    Autopilot pilot(runSeed);
+    if (simulation.HasPlayerMasks()) {
+        float half = eyesOpenMask.Size() / 2.0f;
+        pilot.SetPlayerExtent(half - eyesOpenMask.MinX(), half - eyesOpenMask.MinY(),
+            eyesOpenMask.MaxX() + 1 - half, eyesOpenMask.MaxY() + 1 - half);
+    }
+    PracticeStart start = StartPractice(simulation, pilot, runSeed, CollisionResetFlags(), practiceSpeed, practiceAutoPipe);
+    const char* how = start == PRACTICE_BUILT ? "built" : start == PRACTICE_FAST_FORWARDED ? "fast-forwarded" : "failed, normal run";
+    TraceLog(LOG_INFO, "PRACTICE: Speed %d, pipe %d (%s)", (int)simulation.State().pipeSpeed, simulation.State().score, how);
+
+    // Replays always start from a reset, so this one is never saved
+    replay.Begin(runSeed, CollisionResetFlags());
+    stepper.Reset(simulation);
+    tickAccumulator = 0.0f;
+    pendingFlap = false;
+    practiceRun = true;
+    steppedRun = false;
+    ResumeMusic();
+}
+
+void Game::ResumeMusic()
+{
+    mixer.Unduck(duckReleaseSeconds);
+    // Only restart music if it wasn't manually disabled; after a death it kept
+    // playing under the duck, and restarting a playing stream skips
     if (!musicManuallyDisabled) {
-        PlayMusicStream(gameMusic);
+        music.Play();
         musicPlaying = true;
     }
 }
 
+float Game::PlayerPan() const
+{
+    return (simulation.State().playerX / simulation.Config().width * 2.0f - 1.0f) * effectPanWidth;
+}
+
+void Game::UpdatePracticeSpeed()
+{
+    // [ and ] pick the practice speed on the start and game over screens
+    const SimConfig& config = simulation.Config();
+    if (IsKeyPressed(KEY_LEFT_BRACKET)) {
+        practiceSpeed = MAX(config.basePipeSpeed, practiceSpeed - 100.0f);
+    } else if (IsKeyPressed(KEY_RIGHT_BRACKET)) {
+        practiceSpeed = MIN(config.maxSpeed, practiceSpeed + 100.0f);
+    }
+}
+
 void Game::Update(float dt)
 {
+    hitchDetector.BeginFrame();
+    frameStartTime = GetTime();
+    frameSkipper.BeginFrame(dt);
+#ifdef HOVERCAT_HOT_RELOAD
+    ApplyAssetReloads();
+#endif
+
     if (dt == 0)
     {
         return;
     }
 
-    screenScale = MIN((float)GetScreenWidth() / gameScreenWidth, (float)GetScreenHeight() / gameScreenHeight);
+    CheckMemoryBudget(dt);
+    presenter.Refresh();
+    hitchDetector.BeginPhase(PHASE_INPUT_UI);
     bool skipFrame = UpdateUI();
+    hitchDetector.EndPhase();
+    bool muffled = paused || lostWindowFocus || isInExitMenu;
+    if (muffled != audioMuffled) {
+        mixer.SetMuffled(muffled);
+        audioMuffled = muffled;
+    }
+    mixer.ReleaseRetired();
     if(skipFrame) {
         return;
     }
 
-    bool running = (firstTimeGameStart == false && paused == false && lostWindowFocus == false && isInExitMenu == false && gameOver == false);
+    bool active = (firstTimeGameStart == false && paused == false && lostWindowFocus == false && isInExitMenu == false);
+    bool running = active && gameOver == false && stepMode == false;
+    SamplingProfiler::SetGameplayActive(running);
+    frameSkipper.AllowSkipping(running);
 
     // Only scroll background when running
     if (running) {
+        backgroundScrollSpeed = simulation.State().pipeSpeed * 0.2f;  // 20% of current pipe speed
         backgroundScrollX += backgroundScrollSpeed * dt;
-        if (backgroundScrollX >= backgroundTexture.width)
-            backgroundScrollX -= backgroundTexture.width;
+    }
+
+    {
+        HitchDetector::Scope phase(hitchDetector, PHASE_TEXTURE_UPLOAD);
+        scenery.Update(backgroundScrollX, (float)gameScreenWidth);
+    }
+    if (scenery.PendingUploads() > 0 && !tasks.Has(TASK_KEY_SCENERY_UPLOAD)) {
+        tasks.Post("scenery upload", TASK_HIGH, [this]() {
+            HitchDetector::Scope phase(hitchDetector, PHASE_TEXTURE_UPLOAD);
+            HeapScope heapScope(MEM_SCENERY);
+            return !scenery.UploadNext();
+        }, TASK_KEY_SCENERY_UPLOAD);
     }
 
     if (musicPlaying) {
-        UpdateMusicStream(gameMusic);
+        HitchDetector::Scope phase(hitchDetector, PHASE_MUSIC_STREAM);
+        music.Update();
+        if (music.Underruns() != musicUnderruns) {
+            musicUnderruns = music.Underruns();
+            TraceLog(LOG_WARNING, "AUDIO: Music ran dry (%llu times)", (unsigned long long)musicUnderruns);
+        }
     }
 
-    if (running)
+    if (active && stepMode)
     {
+        HitchDetector::Scope phase(hitchDetector, PHASE_SIMULATION);
+        UpdateStepMode();
+    }
+    else if (running)
+    {
+        hitchDetector.BeginPhase(PHASE_INPUT_UI);
         HandleInput();
-
-        UpdatePipeSpeed(dt);
-        
-        // Update player physics
-        playerVelocity += gravity * dt;
-        playerY += playerVelocity * dt;
-
-        // Calculate collision box dimensions
-        float collisionBoxWidth = playerSize * playerCollisionWidthRatio;
-        float collisionBoxHeight = playerSize * playerCollisionHeightRatio;
-
-        // Check for collisions with screen boundaries using collision box
-        if (playerY - collisionBoxHeight/2 < 0 || playerY + collisionBoxHeight/2 > height) {
-            gameOver = true;
-            gameOverDelayTimer = gameOverDelayDuration; // Initialize delay timer
-            // Stop all sounds before playing hit sound
-            StopMusicStream(gameMusic);
-            StopSound(flySound);
-            StopSound(scoreSound);
-            PlaySound(hitSound);
-            if (score > highScore) {
-                highScore = score;
-                SaveHighScore();
-            }
-        }
-
-        // Update pipes
-        pipeSpawnTimer += dt;
-        if (pipeSpawnTimer >= pipeSpawnInterval) {
-            pipeSpawnTimer = 0.0f;
-            
-            // Calculate the target gap center based on the previous pipe
-            float targetGapCenter;
-            if (pipes.empty()) {
-                // First pipe - place it in the middle
-                targetGapCenter = height / 2;
-            } else {
-                // Get the previous pipe's gap center
-                float prevGapCenter = pipes.back().gapCenter;
-                
-                // Calculate the minimum and maximum allowed gap center
-                float minGapCenter = MAX(pipeGap/2, prevGapCenter - maxGapHeightDifference);
-                float maxGapCenter = MIN(height - pipeGap/2, prevGapCenter + maxGapHeightDifference);
-                
-                // Randomly choose a new gap center within the allowed range
-                targetGapCenter = GetRandomValue(minGapCenter, maxGapCenter);
-            }
-            
-            pipes.push_back({(float)width, targetGapCenter, false});
-        }
-
-        // Move pipes and check collisions
-        for (auto& pipe : pipes) {
-            pipe.x -= pipeSpeed * dt;
-            // Check if player has passed the pipe
-            if (playerX > pipe.x + pipeWidth && !pipe.scored) {
-                score++;
-                pipe.scored = true;
-                PlaySound(scoreSound);
-                if (score > highScore) {
-                    highScore = score;
-                    SaveHighScore();
-                }
-            }
-
-            // Check collision with pipe using collision box
-            if (!gameOver) {
-                // Check if player is within pipe's x range
-                if (playerX + collisionBoxWidth/2 > pipe.x && playerX - collisionBoxWidth/2 < pipe.x + pipeWidth) {
-                    // Check if player is outside the gap
-                    if (playerY - collisionBoxHeight/2 < pipe.gapCenter - pipeGap/2 || 
-                        playerY + collisionBoxHeight/2 > pipe.gapCenter + pipeGap/2) {
-                        gameOver = true;
-                        gameOverDelayTimer = gameOverDelayDuration; // Initialize delay timer
-                        // Stop all sounds before playing hit sound
-                        StopMusicStream(gameMusic);
-                        StopSound(flySound);
-                        StopSound(scoreSound);
-                        PlaySound(hitSound);
-                        if (score > highScore) {
-                            highScore = score;
-                            SaveHighScore();
-                        }
-                    }
-                }
-            }
-        }
-
-        // Remove pipes that are off screen
-        pipes.erase(std::remove_if(pipes.begin(), pipes.end(), 
-            [this](const auto& pipe) { return pipe.x < -this->pipeWidth; }), 
-            pipes.end());
-
-        if (playerEyesClosedTimer > 0.0f) {
-            playerEyesClosedTimer -= dt;
-            if (playerEyesClosedTimer < 0.0f) playerEyesClosedTimer = 0.0f;
+        hitchDetector.EndPhase();
+
+        // Run as many fixed ticks as this frame covers; long stalls are clamped
+        // so a hitch doesn't turn into a burst of catch-up ticks
+        HitchDetector::Scope phase(hitchDetector, PHASE_SIMULATION);
+        tickAccumulator += MIN(dt, maxFrameCatchUp);
+        while (tickAccumulator >= simTickDt && !gameOver) {
+            tickAccumulator -= simTickDt;
+            StepSimulation();
         }
     }
+    else
+    {
+        tickAccumulator = 0.0f;
+    }
+    music.SetTempo(MusicTempo(simulation));
 
     // Handle game over restart
-    if (gameOver) {
+    if (gameOver && !stepMode) {
         // Update game over delay timer
         if (gameOverDelayTimer > 0.0f) {
             gameOverDelayTimer -= dt;
@@ -282,11 +472,41 @@ void Game::Update(float dt)
                 }
             } else if (IsKeyPressed(KEY_ENTER)) {
                 Reset();
+            } else if (IsKeyPressed(KEY_T)) {
+                StartPracticeRun();
+            } else {
+                UpdatePracticeSpeed();
             }
         }
     }
 }
 
+void Game::UpdateStepMode()
+{
+    stepper.SetMeasuring(true);
+    if (!simulation.State().gameOver && (IsKeyPressed(KEY_SPACE) || IsKeyPressed(KEY_UP) || IsKeyPressed(KEY_W))) {
+        pendingFlap = true;     // Applied on the next tick, branching off the recorded history
+    }
+
+    // Right/Left step one tick (held keys repeat), Shift steps ten
+    int count = (IsKeyDown(KEY_LEFT_SHIFT) || IsKeyDown(KEY_RIGHT_SHIFT)) ? 10 : 1;
+    if (IsKeyPressed(KEY_RIGHT) || IsKeyPressedRepeat(KEY_RIGHT)) {
+        for (int i = 0; i < count; i++) {
+            if (!pendingFlap && stepper.StepForward(simulation)) {
+                continue;
+            }
+            if (simulation.State().gameOver) {
+                break;
+            }
+            gameOver = false;   // A new branch from before the death
+            StepSimulation();
+        }
+    } else if (IsKeyPressed(KEY_LEFT) || IsKeyPressedRepeat(KEY_LEFT)) {
+        for (int i = 0; i < count && stepper.StepBack(simulation); i++) {
+        }
+    }
+}
+
 void Game::HandleInput()
 {
     // Only handle flap input if the game is running and not paused
@@ -295,20 +515,21 @@ void Game::HandleInput()
         if (IsKeyPressed(KEY_SPACE) || IsKeyPressed(KEY_UP) || IsKeyPressed(KEY_W)
             || (isMobile && IsGestureDetected(GESTURE_TAP)))
         {
-            playerVelocity = jumpForce;
-            PlaySound(flySound);
-            playerEyesClosedTimer = playerEyesClosedDuration;
+            pendingFlap = true;
+            LogInput(INPUT_FLAP, simulation.State().playerY, simulation.State().playerVelocity);
+            mixer.Play(CLIP_FLY, 1.0f, PlayerPan());
         }
     }
 
     // Handle music toggle with M key
     if (IsKeyPressed(KEY_M)) {
+        LogInput(INPUT_MUSIC_TOGGLE);
         if (musicPlaying) {
-            PauseMusicStream(gameMusic);
+            music.Pause();
             musicPlaying = false;
             musicManuallyDisabled = true;  // Player manually disabled music
         } else {
-            PlayMusicStream(gameMusic);
+            music.Play();
             musicPlaying = true;
             musicManuallyDisabled = false;  // Player manually enabled music
         }
@@ -322,11 +543,13 @@ bool Game::UpdateUI()
     {
         exitWindowRequested = true;
         isInExitMenu = true;
+        LogState(STATE_EXIT_MENU_OPEN);
         return false;
     }
 
     if (IsKeyPressed(KEY_ENTER) && (IsKeyDown(KEY_LEFT_ALT) || IsKeyDown(KEY_RIGHT_ALT)))
     {
+        LogInput(INPUT_FULLSCREEN_TOGGLE);
         if (fullscreen)
         {
             fullscreen = false;
@@ -337,6 +560,48 @@ bool Game::UpdateUI()
             fullscreen = true;
             ToggleBorderlessWindowed();
         }
+        presenter.Invalidate();
+    }
+
+    // F7 switches between fit and integer scaling
+    if (IsKeyPressed(KEY_F7))
+    {
+        presenter.SetMode(presenter.Mode() == PRESENT_FIT ? PRESENT_INTEGER : PRESENT_FIT);
+        TraceLog(LOG_INFO, "PRESENT: %s scaling", presenter.Mode() == PRESENT_FIT ? "Fit" : "Integer");
+    }
+
+    // F1 shows the debug overlay
+    if (IsKeyPressed(KEY_F1))
+    {
+        showDebug = !showDebug;
+    }
+
+    // F8 shows the memory footprint
+    if (IsKeyPressed(KEY_F8))
+    {
+        showMemory = !showMemory;
+    }
+
+    // F9 pauses/resumes sample capture when started with HOVERCAT_PROFILE
+    if (IsKeyPressed(KEY_F9) && SamplingProfiler::IsRunning())
+    {
+        SamplingProfiler::SetCapturing(!SamplingProfiler::IsCapturing());
+        TraceLog(LOG_INFO, "SAMPLER: Capture %s", SamplingProfiler::IsCapturing() ? "resumed" : "paused");
+    }
+
+    // F6 enters/leaves tick step mode
+    if (IsKeyPressed(KEY_F6) && !firstTimeGameStart)
+    {
+        stepMode = !stepMode;
+        stepper.SetMeasuring(stepMode);
+        // A run flapped tick by tick or resumed after a death doesn't get a high score
+        steppedRun |= stepMode;
+        if (!stepMode && gameOver && !simulation.State().gameOver) {
+            // Stepped back from a death, resume play from here
+            gameOver = false;
+            ResumeMusic();
+        }
+        tickAccumulator = 0.0f;
     }
 #endif
 
@@ -344,17 +609,27 @@ bool Game::UpdateUI()
         if(isMobile) {
             if(IsGestureDetected(GESTURE_TAP)) {
                 firstTimeGameStart = false;
+                LogState(STATE_GAME_START);
                 // Start music when game begins
-                PlayMusicStream(gameMusic);
+                music.Play();
                 musicPlaying = true;
             }
         }
         else if(IsKeyDown(KEY_ENTER)) {
             firstTimeGameStart = false;
+            LogState(STATE_GAME_START);
             // Start music when game begins
-            PlayMusicStream(gameMusic);
+            music.Play();
             musicPlaying = true;
         }
+        else if(IsKeyPressed(KEY_T)) {
+            firstTimeGameStart = false;
+            LogState(STATE_GAME_START);
+            StartPracticeRun();
+        }
+        else {
+            UpdatePracticeSpeed();
+        }
     }
 
     if (exitWindowRequested)
@@ -367,17 +642,16 @@ bool Game::UpdateUI()
         {
             exitWindowRequested = false;
             isInExitMenu = false;
+            LogState(STATE_EXIT_MENU_CLOSE);
         }
     }
 
-    if (IsWindowFocused() == false)
-    {
-        lostWindowFocus = true;
-    }
-    else
+    bool focused = IsWindowFocused();
+    if (focused == lostWindowFocus)
     {
-        lostWindowFocus = false;
+        LogState(focused ? STATE_FOCUS_GAINED : STATE_FOCUS_LOST);
     }
+    lostWindowFocus = !focused;
 
 #ifndef EMSCRIPTEN_BUILD
     if (exitWindowRequested == false && lostWindowFocus == false && gameOver == false && IsKeyPressed(KEY_P))
@@ -386,31 +660,27 @@ bool Game::UpdateUI()
 #endif
     {
         paused = !paused;
+        LogInput(INPUT_PAUSE_TOGGLE);
+        LogState(paused ? STATE_PAUSED : STATE_RESUMED);
     }
 
     // Handle pausing/unpausing on mobile with tap
     if (isMobile && !firstTimeGameStart && !gameOver && !exitWindowRequested) {
         if (!paused && IsGestureDetected(GESTURE_TAP)) {
-            // Get tap position in screen space
-            Vector2 tapPos = GetTouchPosition(0);
-            
-            // Transform tap position from screen space to game space
-            float screenOffsetX = (GetScreenWidth() - ((float)gameScreenWidth * screenScale)) * 0.5f;
-            float screenOffsetY = (GetScreenHeight() - ((float)gameScreenHeight * screenScale)) * 0.5f;
-            
-            // Convert screen coordinates to game coordinates
-            tapPos.x = (tapPos.x - screenOffsetX) / screenScale;
-            tapPos.y = (tapPos.y - screenOffsetY) / screenScale;
+            // Tap position in game coordinates
+            Vector2 tapPos = presenter.ScreenToGame(GetTouchPosition(0));
             
             // Create a rectangle at the top of the screen
             Rectangle titleArea = {0, 0, (float)width, 100};
             // Check if tap is within the title area
             if (CheckCollisionPointRec(tapPos, titleArea)) {
                 paused = true;
+                LogState(STATE_PAUSED);
                 return true;
             }
         } else if (paused && IsGestureDetected(GESTURE_TAP)) {
             paused = false;
+            LogState(STATE_RESUMED);
             return true;
         }
     }
@@ -419,252 +689,240 @@ bool Game::UpdateUI()
 
 void Game::Draw()
 {
-    // render everything to a texture
-    BeginTextureMode(targetRenderTex);
-
-    // Draw scrolling background (revert to original logic)
-    float srcX = backgroundScrollX;
-    float srcWidth = (float)gameScreenWidth;
-    if (srcX + srcWidth <= backgroundTexture.width) {
-        // No wrap needed
-        DrawTexturePro(
-            backgroundTexture,
-            { srcX, 0, srcWidth, (float)gameScreenHeight },
-            { 0, 0, srcWidth, (float)gameScreenHeight },
-            { 0, 0 }, 0.0f, WHITE
-        );
-    } else {
-        // Wrap around
-        float firstPart = backgroundTexture.width - srcX;
-        DrawTexturePro(
-            backgroundTexture,
-            { srcX, 0, firstPart, (float)gameScreenHeight },
-            { 0, 0, firstPart, (float)gameScreenHeight },
-            { 0, 0 }, 0.0f, WHITE
-        );
-        DrawTexturePro(
-            backgroundTexture,
-            { 0, 0, srcWidth - firstPart, (float)gameScreenHeight },
-            { firstPart, 0, srcWidth - firstPart, (float)gameScreenHeight },
-            { 0, 0 }, 0.0f, WHITE
-        );
+    drawCalls = 0;
+    if (!frameSkipper.ShouldDraw()) {
+        // EndDrawing normally polls input, a skipped frame still has to
+        PollInputEvents();
+        // Behind already: only tasks that have waited too long get a step
+        tasks.Run(0.0);
+        return;
     }
+    double drawStart = GetTime();
+    hitchDetector.BeginPhase(PHASE_DRAW_SCENE);
 
-    // Draw pipes with graphics
-    for (const auto& pipe : pipes) {
-        float topPipeHeight = pipe.gapCenter - pipeGap/2;
-        float bottomPipeY = pipe.gapCenter + pipeGap/2;
-        float bottomPipeHeight = height - bottomPipeY;
-
-        int capHeight = 24; // Set this to the cap height in your image
-        int pipeImgWidth = pipeTexture.width;
-        int pipeImgHeight = pipeTexture.height;
-        int bodyHeight = pipeImgHeight - capHeight;
-
-        // Draw top pipe (flipped vertically)
-        if (topPipeHeight > 0) {
-            // Draw body (stretched)
-            float bodyDrawHeight = topPipeHeight - capHeight;
-            if (bodyDrawHeight > 0) {
-                DrawTexturePro(
-                    pipeTexture,
-                    { 0, (float)capHeight, (float)pipeImgWidth, (float)bodyHeight },
-                    { pipe.x, 0, pipeWidth, bodyDrawHeight },
-                    { 0, 0 }, 0.0f, WHITE
-                );
-            }
-            // Draw cap (flipped)
-            DrawTexturePro(
-                pipeTexture,
-                { 0, 0, (float)pipeImgWidth, (float)capHeight },
-                { pipe.x, bodyDrawHeight, pipeWidth, (float)capHeight },
-                { 0, 0 }, 0.0f, WHITE
-            );
-        }
-
-        // Draw bottom pipe (normal)
-        if (bottomPipeHeight > 0) {
-            // Draw body (stretched)
-            float bodyDrawHeight = bottomPipeHeight - capHeight;
-            if (bodyDrawHeight > 0) {
-                DrawTexturePro(
-                    pipeTexture,
-                    { 0, (float)capHeight, (float)pipeImgWidth, (float)bodyHeight },
-                    { pipe.x, bottomPipeY + (float)capHeight, pipeWidth, bodyDrawHeight },
-                    { 0, 0 }, 0.0f, WHITE
-                );
-            }
-            // Draw cap (normal)
-            DrawTexturePro(
-                pipeTexture,
-                { 0, 0, (float)pipeImgWidth, (float)capHeight },
-                { pipe.x, bottomPipeY, pipeWidth, (float)capHeight },
-                { 0, 0 }, 0.0f, WHITE
-            );
-        }
-    }
-
-    // Choose player texture:
-    Texture2D currentPlayerTexture;
-    if (gameOver) {
-        // If crashed, always show eyes closed
-        currentPlayerTexture = playerTextureEyesClosed;
-    } else if (playerEyesClosedTimer > 0.0f) {
-        // If flapping, show eyes closed
-        currentPlayerTexture = playerTextureEyesClosed;
-    } else {
-        // Otherwise, show eyes open
-        currentPlayerTexture = playerTexture;
-    }
-
-    DrawTexturePro(
-        currentPlayerTexture,
-        { 0, 0, (float)currentPlayerTexture.width, (float)currentPlayerTexture.height },
-        { playerX - playerSize/2, playerY - playerSize/2, playerSize, playerSize },
-        { 0, 0 }, 0.0f, WHITE
-    );
-
-#ifdef DEBUG
-    // Draw player collision box for debugging (red outline)
-    float collisionBoxWidth = playerSize * playerCollisionWidthRatio;
-    float collisionBoxHeight = playerSize * playerCollisionHeightRatio;
-    DrawRectangleLines(
-        (int)(playerX - collisionBoxWidth/2),
-        (int)(playerY - collisionBoxHeight/2),
-        (int)collisionBoxWidth,
-        (int)collisionBoxHeight,
-        RED
-    );
-#endif
-    DrawUI();
+    // render everything to a texture
+    BeginTextureMode(presenter.Target());
 
+    // Record the scene and submit it; the draw lists are gameplay's, the blit and
+    // the tasks below aren't
+    {
+        auto recordStart = std::chrono::steady_clock::now();
+        HeapScope heapScope(MEM_GAMEPLAY);
+        RecordScene(sceneDrawList, simulation.State(), simulation.Config(), SceneSizes(), scenery.Residency(),
+            backgroundScrollX, (float)gameScreenWidth, (float)gameScreenHeight);
+        if (stepMode) {
+            stepper.SetDrawCost((uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - recordStart).count());
+        }
+        BeginMode2D(presenter.Camera());
+        SubmitScene();
+
+        if (showDebug) {
+            RecordDebugOverlay(debugDrawList, simulation, debugLayers);
+            SubmitDebugOverlay();
+        }
+        EndMode2D();
+    }
     EndTextureMode();
+    hitchDetector.EndPhase();
 
     // render the scaled frame texture to the screen
+    HitchDetector::Scope phase(hitchDetector, PHASE_PRESENT);
     BeginDrawing();
     ClearBackground(BLACK);
-    DrawTexturePro(targetRenderTex.texture, 
-        (Rectangle){0.0f, 0.0f, (float)targetRenderTex.texture.width, (float)-targetRenderTex.texture.height},
-        (Rectangle){(GetScreenWidth() - ((float)gameScreenWidth * screenScale)) * 0.5f, (GetScreenHeight() - ((float)gameScreenHeight * screenScale)) * 0.5f, (float)gameScreenWidth * screenScale, (float)gameScreenHeight * screenScale},
-        (Vector2){0, 0}, 0.0f, WHITE);
+    presenter.Blit();
+    drawCalls++;
+
+    // UI goes on top at native resolution, so text isn't blurred by the upscale
+    hitchDetector.BeginPhase(PHASE_DRAW_UI);
+    ui.Begin(presenter.Scale(), presenter.Viewport().x, presenter.Viewport().y);
+    DrawUI();
+    drawCalls += ui.DrawCalls();
+    hitchDetector.EndPhase();
+
+    // Deferred work fills the rest of the frame. The batch is drawn first, so a task
+    // may replace a texture the UI has just used.
+    rlDrawRenderBatchActive();
+    double tasksStart = GetTime();
+    tasks.Run(frameSkipper.Budget() - (tasksStart - frameStartTime) - taskPresentMargin);
+
+    double presentStart = GetTime();
     EndDrawing();
+
+    // EndDrawing also sleeps for the frame limiter, that wait isn't draw cost, and
+    // neither are the tasks that used up time the limiter would have slept
+    double presentTime = GetTime() - presentStart;
+    double limiterWait = MAX(0.0, frameSkipper.Budget() - (presentStart - frameStartTime));
+    frameSkipper.RecordDrawCost((float)(tasksStart - drawStart + MAX(0.0, presentTime - limiterWait)));
 }
 
 void Game::DrawUI()
 {
+    HeapScope heapScope(MEM_UI);
     float screenX = 0.0f;
     float screenY = 0.0f;
 
+    if (showMemory) {
+        MemoryUsage usage = CollectMemory();
+        const MemoryBudget& budget = GetMemoryBudget(qualityTier);
+        uint32_t overage = ::CheckMemoryBudget(usage, budget);
+        std::string text = FormatMemoryUsage(usage);
+        text += "\nbudget (" + std::string(QualityTierName(qualityTier)) + " tier): ";
+        text += overage ? DescribeMemoryOverage(usage, budget, overage) : "ok";
+        Color panelColor = {0, 0, 0, 180};
+        ui.FillRect(10, gameScreenHeight - 150, 620, 80, panelColor);
+        ui.Text(text.c_str(), 16, gameScreenHeight - 144, 10, overage ? RED : WHITE);
+    }
+
+    if (showDebug) {
+        // Above the memory panel, clear of the music hint along the bottom edge
+        ui.Text("F1 debug: gap bands green, reach blue (red: gap out of reach), arcs white no input / yellow flap now, spawn phase magenta",
+            10, gameScreenHeight - 166, 10, BLACK);
+    }
+
     if(isMobile) {
         // Draw pause rectangle area at the top of the screen
         Color grayTransparent = {128, 128, 128, 8}; // Semi-transparent gray
-        DrawRectangle(0, 0, gameScreenWidth, 100, grayTransparent);
+        ui.FillRect(0, 0, gameScreenWidth, 100, grayTransparent);
         
         // Draw centered "Tap to pause" text
         const char* text = "Tap to pause";
         int fontSize = 20;
-        int textWidth = MeasureText(text, fontSize);
-        DrawText(text, (gameScreenWidth - textWidth)/2, 40, fontSize, BLACK);
+        float textWidth = ui.TextWidth(text, fontSize);
+        ui.Text(text, (gameScreenWidth - textWidth)/2, 40, fontSize, BLACK);
     }
 
     // Draw score on the right side
-    std::string scoreText = "Score: " + std::to_string(score);
+    std::string scoreText = "Score: " + std::to_string(simulation.State().score);
     std::string highScoreText = "High Score: " + std::to_string(highScore);
-    std::string speedText = "Speed: " + std::to_string((int)pipeSpeed);
-    int scoreWidth = MeasureText(scoreText.c_str(), 20);
-    int highScoreWidth = MeasureText(highScoreText.c_str(), 20);
-    int speedWidth = MeasureText(speedText.c_str(), 20);
+    std::string speedText = "Speed: " + std::to_string((int)simulation.State().pipeSpeed);
+    float scoreWidth = ui.TextWidth(scoreText.c_str(), 20);
+    float highScoreWidth = ui.TextWidth(highScoreText.c_str(), 20);
+    float speedWidth = ui.TextWidth(speedText.c_str(), 20);
     int rightPadding = 20;
     
-    DrawText(scoreText.c_str(), width - scoreWidth - rightPadding, 20, 20, BLACK);
-    DrawText(highScoreText.c_str(), width - highScoreWidth - rightPadding, 50, 20, BLACK);
-    DrawText(speedText.c_str(), width - speedWidth - rightPadding, 80, 20, BLACK);
+    ui.Text(scoreText.c_str(), width - scoreWidth - rightPadding, 20, 20, BLACK);
+    ui.Text(highScoreText.c_str(), width - highScoreWidth - rightPadding, 50, 20, BLACK);
+    ui.Text(speedText.c_str(), width - speedWidth - rightPadding, 80, 20, BLACK);
+    if (practiceRun) {
+        float practiceWidth = ui.TextWidth("Practice", 20);
+        ui.Text("Practice", width - practiceWidth - rightPadding, 110, 20, BLACK);
+    } else if (simulation.HasCourse()) {
+        std::string courseText = "Course " + std::to_string(simulation.State().pipesSpawned) + "/" + std::to_string(course.PipeCount());
+        float courseWidth = ui.TextWidth(courseText.c_str(), 20);
+        ui.Text(courseText.c_str(), width - courseWidth - rightPadding, 110, 20, BLACK);
+    }
 
     if(!isMobile) {
         // Draw music toggle instruction at the bottom
         const char* musicText = "Press M to toggle music";
-        int musicTextWidth = MeasureText(musicText, 20);
-        DrawText(musicText, (gameScreenWidth - musicTextWidth)/2, gameScreenHeight - 30, 20, BLACK);
+        float musicTextWidth = ui.TextWidth(musicText, 20);
+        ui.Text(musicText, (gameScreenWidth - musicTextWidth)/2, gameScreenHeight - 30, 20, BLACK);
     }
 
     if (exitWindowRequested)
     {
-        DrawRectangleRounded({screenX + (float)(gameScreenWidth / 2 - 250), screenY + (float)(gameScreenHeight / 2 - 20), 500, 60}, 0.76f, 20, BLACK);
-        DrawText("Are you sure you want to exit? [Y/N]", screenX + (gameScreenWidth / 2 - 200), screenY + gameScreenHeight / 2, 20, yellow);
+        ui.FillRoundedRect({screenX + (float)(gameScreenWidth / 2 - 250), screenY + (float)(gameScreenHeight / 2 - 20), 500, 60}, 0.76f, 20, BLACK);
+        ui.Text("Are you sure you want to exit? [Y/N]", screenX + (gameScreenWidth / 2 - 200), screenY + gameScreenHeight / 2, 20, yellow);
     }
     else if (firstTimeGameStart)
     {
-        DrawRectangleRounded(
+        ui.FillRoundedRect(
             {screenX + (float)(gameScreenWidth / 2 - 320), screenY + (float)(gameScreenHeight / 2 - 130), 700, 300},
             0.76f, 20, BLACK
         );
 
         // Welcome and instructions
         int y = (int)(screenY + (gameScreenHeight / 2 - 110));
-        DrawText("Welcome to Hovercat", (int)(screenX + (gameScreenWidth / 2 - 260)), y, 20, yellow);
+        ui.Text("Welcome to Hovercat", (int)(screenX + (gameScreenWidth / 2 - 260)), y, 20, yellow);
         y += 40;
-        DrawText("Controls:", (int)(screenX + (gameScreenWidth / 2 - 260)), y, 20, yellow);
+        ui.Text("Controls:", (int)(screenX + (gameScreenWidth / 2 - 260)), y, 20, yellow);
         y += 30;
         if(!isMobile) {
-            DrawText("- Press [Space], [W] or [Up Arrow] to flap", (int)(screenX + (gameScreenWidth / 2 - 220)), y, 20, WHITE);
+            ui.Text("- Press [Space], [W] or [Up Arrow] to flap", (int)(screenX + (gameScreenWidth / 2 - 220)), y, 20, WHITE);
             y += 30;
 #ifndef EMSCRIPTEN_BUILD
-            DrawText("- Press [P] to pause", (int)(screenX + (gameScreenWidth / 2 - 220)), y, 20, WHITE);
+            ui.Text("- Press [P] to pause", (int)(screenX + (gameScreenWidth / 2 - 220)), y, 20, WHITE);
             y += 30;
-            DrawText("- Press [Esc] to exit", (int)(screenX + (gameScreenWidth / 2 - 220)), y, 20, WHITE);
+            ui.Text("- Press [Esc] to exit", (int)(screenX + (gameScreenWidth / 2 - 220)), y, 20, WHITE);
             y += 30;
-            DrawText("- Press [M] to toggle music", (int)(screenX + (gameScreenWidth / 2 - 220)), y, 20, WHITE);
+            ui.Text("- Press [M] to toggle music", (int)(screenX + (gameScreenWidth / 2 - 220)), y, 20, WHITE);
             y += 40;
-            DrawText("Press Enter to play", (int)(screenX + (gameScreenWidth / 2 - 100)), y, 20, yellow);
+            ui.Text("Press Enter to play", (int)(screenX + (gameScreenWidth / 2 - 100)), y, 20, yellow);
             y += 30;
-            DrawText("Alt+Enter: toggle fullscreen", (int)(screenX + (gameScreenWidth / 2 - 120)), y, 20, yellow);
+            ui.Text("Alt+Enter: toggle fullscreen", (int)(screenX + (gameScreenWidth / 2 - 120)), y, 20, yellow);
+            y += 25;
+            ui.Text(PracticePrompt().c_str(), (int)(screenX + (gameScreenWidth / 2 - 220)), y, 20, WHITE);
 #else
-            DrawText("- Press [P] or [ESC] to pause", (int)(screenX + (gameScreenWidth / 2 - 220)), y, 20, WHITE);
+            ui.Text("- Press [P] or [ESC] to pause", (int)(screenX + (gameScreenWidth / 2 - 220)), y, 20, WHITE);
             y += 30;
-            DrawText("- Press [M] to toggle music", (int)(screenX + (gameScreenWidth / 2 - 220)), y, 20, WHITE);
+            ui.Text("- Press [M] to toggle music", (int)(screenX + (gameScreenWidth / 2 - 220)), y, 20, WHITE);
             y += 70;
-            DrawText("Press Enter to play", (int)(screenX + (gameScreenWidth / 2 - 100)), y, 20, yellow);        
+            ui.Text("Press Enter to play", (int)(screenX + (gameScreenWidth / 2 - 100)), y, 20, yellow);        
+            y += 30;
+            ui.Text(PracticePrompt().c_str(), (int)(screenX + (gameScreenWidth / 2 - 220)), y, 20, WHITE);
 #endif
         } else {
-            DrawText("- Tap to flap", (int)(screenX + (gameScreenWidth / 2 - 220)), y, 20, WHITE);
+            ui.Text("- Tap to flap", (int)(screenX + (gameScreenWidth / 2 - 220)), y, 20, WHITE);
             y += 30;
-            DrawText("- Tap title bar to pause", (int)(screenX + (gameScreenWidth / 2 - 220)), y, 20, WHITE);  
+            ui.Text("- Tap title bar to pause", (int)(screenX + (gameScreenWidth / 2 - 220)), y, 20, WHITE);  
             y += 70;
-            DrawText("Tap to play", (int)(screenX + (gameScreenWidth / 2 - 100)), y, 20, yellow);
+            ui.Text("Tap to play", (int)(screenX + (gameScreenWidth / 2 - 100)), y, 20, yellow);
         }
     }
     else if (paused)
     {
-        DrawRectangleRounded({screenX + (float)(gameScreenWidth / 2 - 250), screenY + (float)(gameScreenHeight / 2 - 20), 500, 60}, 0.76f, 20, BLACK);
+        ui.FillRoundedRect({screenX + (float)(gameScreenWidth / 2 - 250), screenY + (float)(gameScreenHeight / 2 - 20), 500, 60}, 0.76f, 20, BLACK);
 #ifndef EMSCRIPTEN_BUILD
-        DrawText("Game paused, press P to continue", screenX + (gameScreenWidth / 2 - 200), screenY + gameScreenHeight / 2, 20, yellow);
+        ui.Text("Game paused, press P to continue", screenX + (gameScreenWidth / 2 - 200), screenY + gameScreenHeight / 2, 20, yellow);
 #else
         if (isMobile) {
-            DrawText("Game paused, tap to continue", screenX + (gameScreenWidth / 2 - 200), screenY + gameScreenHeight / 2, 20, yellow);
+            ui.Text("Game paused, tap to continue", screenX + (gameScreenWidth / 2 - 200), screenY + gameScreenHeight / 2, 20, yellow);
         } else {
-            DrawText("Game paused, press P or ESC to continue", screenX + (gameScreenWidth / 2 - 200), screenY + gameScreenHeight / 2, 20, yellow);
+            ui.Text("Game paused, press P or ESC to continue", screenX + (gameScreenWidth / 2 - 200), screenY + gameScreenHeight / 2, 20, yellow);
         }
 #endif
     }
     else if (lostWindowFocus)
     {
-        DrawRectangleRounded({screenX + (float)(gameScreenWidth / 2 - 250), screenY + (float)(gameScreenHeight / 2 - 20), 500, 60}, 0.76f, 20, BLACK);
-        DrawText("Game paused, focus window to continue", screenX + (gameScreenWidth / 2 - 200), screenY + gameScreenHeight / 2, 20, yellow);
+        ui.FillRoundedRect({screenX + (float)(gameScreenWidth / 2 - 250), screenY + (float)(gameScreenHeight / 2 - 20), 500, 60}, 0.76f, 20, BLACK);
+        ui.Text("Game paused, focus window to continue", screenX + (gameScreenWidth / 2 - 200), screenY + gameScreenHeight / 2, 20, yellow);
+    }
+    else if (stepMode)
+    {
+        std::string text = DescribeTick(stepper.Current(), simulation.Config());
+        text += stepper.Diverged() ? "DIVERGED: a re-run tick differs from its snapshot\n" : "";
+        text += "STEP MODE  [Right] step  [Left] back  [Shift] x10  [Space] flap  [F6] resume";
+        int lines = 1;
+        for (char c : text) {
+            if (c == '\n') lines++;
+        }
+        Color panelColor = {0, 0, 0, 180};
+        ui.FillRect(10, 10, 620, lines * 14 + 12, panelColor);
+        ui.Text(text.c_str(), 16, 16, 10, WHITE);
     }
     else if (gameOver)
     {
-        DrawRectangleRounded({screenX + (float)(gameScreenWidth / 2 - 250), screenY + (float)(gameScreenHeight / 2 - 20), 500, 100}, 0.76f, 20, BLACK);
-        std::string gameOverText = "Game Over! Score: " + std::to_string(score);
-        int gameOverTextWidth = MeasureText(gameOverText.c_str(), 20);
-        DrawText(gameOverText.c_str(), screenX + (gameScreenWidth / 2 - gameOverTextWidth/2), screenY + gameScreenHeight / 2 - 10, 20, yellow);
+        ui.FillRoundedRect({screenX + (float)(gameScreenWidth / 2 - 250), screenY + (float)(gameScreenHeight / 2 - 20), 500, isMobile ? 100.0f : 125.0f}, 0.76f, 20, BLACK);
+        std::string gameOverText = (practiceRun ? "Practice over! Score: " : "Game Over! Score: ") + std::to_string(simulation.State().score);
+        float gameOverTextWidth = ui.TextWidth(gameOverText.c_str(), 20);
+        ui.Text(gameOverText.c_str(), screenX + (gameScreenWidth / 2 - gameOverTextWidth/2), screenY + gameScreenHeight / 2 - 10, 20, yellow);
         if (isMobile) {
-            DrawText("Tap to play again", screenX + (gameScreenWidth / 2 - 100), screenY + gameScreenHeight / 2 + 30, 20, yellow);
+            ui.Text("Tap to play again", screenX + (gameScreenWidth / 2 - 100), screenY + gameScreenHeight / 2 + 30, 20, yellow);
         } else {
-            DrawText("Press Enter to play again", screenX + (gameScreenWidth / 2 - 120), screenY + gameScreenHeight / 2 + 30, 20, yellow);
+            ui.Text("Press Enter to play again", screenX + (gameScreenWidth / 2 - 120), screenY + gameScreenHeight / 2 + 30, 20, yellow);
+            std::string prompt = PracticePrompt();
+            float promptWidth = ui.TextWidth(prompt.c_str(), 20);
+            ui.Text(prompt.c_str(), screenX + (gameScreenWidth / 2 - promptWidth / 2), screenY + gameScreenHeight / 2 + 60, 20, WHITE);
         }
     }
 }
 
+std::string Game::PracticePrompt() const
+{
+    return "T: practice at speed " + std::to_string((int)practiceSpeed) + "  [ ]: change";
+}
+
 std::string Game::FormatWithLeadingZeroes(int number, int width)
 {
     std::string numberText = std::to_string(number);
@@ -677,6 +935,331 @@ void Game::Randomize()
 {
 }
 
+Texture2D Game::LoadPlayerSprite(const char* path, Image& image, CollisionMask& mask)
+{
+    // One decode for both the texture and its collision mask
+    if (!mask.Build((const uint8_t*)image.data, image.width, image.height, (int)simulation.Config().playerSize)) {
+        TraceLog(LOG_WARNING, "COLLISION: No mask for %s, using the collision box", path);
+    }
+    Texture2D texture = LoadTextureFromImage(image);
+    UnloadImage(image);
+    return texture;
+}
+
+#ifdef HOVERCAT_HOT_RELOAD
+void Game::StartAssetWatcher()
+{
+    assetWatcher.Track("Data/pipe.png", RELOAD_IMAGE);
+    assetWatcher.Track("Data/redkat_eyes_open.png", RELOAD_IMAGE);
+    assetWatcher.Track("Data/redkat_eyes_closed.png", RELOAD_IMAGE);
+    assetWatcher.Track("Data/fly.mp3", RELOAD_WAVE);
+    assetWatcher.Track("Data/hit.mp3", RELOAD_WAVE);
+    assetWatcher.Track("Data/ding.mp3", RELOAD_WAVE);
+    assetWatcher.Track("Data/music.mp3", RELOAD_FILE);
+    assetWatcher.Track("Font/monogram.ttf", RELOAD_FILE);
+    if (assetWatcher.Start({ "Data", "Font" })) {
+        TraceLog(LOG_INFO, "HOTRELOAD: Watching Data/ and Font/");
+    }
+}
+
+namespace
+{
+    // Swaps in a texture only once it uploaded, the old one stays on failure
+    bool SwapTexture(Texture2D& texture, const Image& image)
+    {
+        Texture2D loaded = LoadTextureFromImage(image);
+        if (loaded.id == 0) {
+            return false;
+        }
+        UnloadTexture(texture);
+        texture = loaded;
+        return true;
+    }
+
+    // The mixer frees the old clip once the audio thread has let go of it
+    bool SwapClip(AudioMixer& mixer, uint32_t slot, const Wave& wave)
+    {
+        AudioClip* clip = LoadClip(wave, mixer.SampleRate());
+        if (clip == nullptr) {
+            return false;
+        }
+        mixer.SetClip(slot, clip);
+        return true;
+    }
+}
+
+void Game::ApplyAssetReloads()
+{
+    reloadedAssets.clear();
+    if (!assetWatcher.TakeReady(reloadedAssets)) {
+        return;
+    }
+    // Uploading or baking a font is a spike of its own, so each swap is a task
+    for (ReloadedAsset& asset : reloadedAssets) {
+        tasks.Post("asset reload", TASK_NORMAL, [this, asset]() mutable {
+            ApplyAssetReload(asset);
+            return true;
+        });
+    }
+}
+
+void Game::ApplyAssetReload(ReloadedAsset& asset)
+{
+    HitchDetector::Scope phase(hitchDetector, PHASE_TEXTURE_UPLOAD);
+    HeapScope heapScope(MEM_OTHER);     // Assets, not the run that happens to be playing
+    const std::string& path = asset.path;
+    bool swapped = false;
+    if (path == "Data/pipe.png") {
+        swapped = SwapTexture(pipeTexture, asset.image);
+    } else if (path == "Data/redkat_eyes_open.png" || path == "Data/redkat_eyes_closed.png") {
+        bool eyesOpen = path == "Data/redkat_eyes_open.png";
+        // The simulation points at the masks, only replace one that rebuilt, and only
+        // once this run is over
+        CollisionMask mask;
+        if (mask.Build((const uint8_t*)asset.image.data, asset.image.width, asset.image.height, (int)simulation.Config().playerSize)) {
+            reloadedMasks[eyesOpen ? 0 : 1] = mask;
+            masksReloaded[eyesOpen ? 0 : 1] = true;
+        }
+        swapped = SwapTexture(eyesOpen ? playerTexture : playerTextureEyesClosed, asset.image);
+    } else if (path == "Data/fly.mp3") {
+        swapped = SwapClip(mixer, CLIP_FLY, asset.wave);
+    } else if (path == "Data/hit.mp3") {
+        swapped = SwapClip(mixer, CLIP_HIT, asset.wave);
+    } else if (path == "Data/ding.mp3") {
+        swapped = SwapClip(mixer, CLIP_SCORE, asset.wave);
+    } else if (path == "Data/music.mp3") {
+        // The stream decodes from the bytes as it plays, so it keeps them
+        swapped = music.Open(asset.data, asset.dataSize);
+        asset.data = nullptr;
+    } else if (path == "Font/monogram.ttf") {
+        Font loaded = LoadFontFromMemory(".ttf", asset.data, asset.dataSize, 128, nullptr, 0);
+        if (loaded.texture.id != 0) {
+            UnloadFont(font);
+            font = loaded;
+            SetTextureFilter(font.texture, TEXTURE_FILTER_BILINEAR);
+            swapped = true;
+        }
+    }
+    TraceLog(swapped ? LOG_INFO : LOG_WARNING, "HOTRELOAD: %s %s", path.c_str(), swapped ? "reloaded" : "failed to load");
+    AssetWatcher::Release(asset);
+}
+#endif
+
+uint16_t Game::CollisionResetFlags() const
+{
+    return simulation.HasPlayerMasks() ? SIM_RESET_PIXEL_COLLISION : 0;
+}
+
+SceneTextureSizes Game::SceneSizes() const
+{
+    SceneTextureSizes sizes;
+    for (int i = 0; i < DRAW_TEXTURE_COUNT; i++) {
+        Texture2D texture = SceneTexture((uint8_t)i);
+        sizes.width[i] = texture.width;
+        sizes.height[i] = texture.height;
+    }
+    return sizes;
+}
+
+Texture2D Game::SceneTexture(uint8_t texture) const
+{
+    if (texture >= DRAW_TEXTURE_SCENERY) {
+        return scenery.Texture(texture);
+    }
+    switch (texture) {
+        case DRAW_TEXTURE_SKY: return scenery.SkyTexture();
+        case DRAW_TEXTURE_PIPE: return pipeTexture;
+        case DRAW_TEXTURE_PLAYER: return playerTexture;
+        default: return playerTextureEyesClosed;
+    }
+}
+
+void Game::SubmitScene()
+{
+    for (const DrawQuad& quad : sceneDrawList.quads) {
+        DrawTexturePro(
+            SceneTexture(quad.texture),
+            { quad.source.x, quad.source.y, quad.source.width, quad.source.height },
+            { quad.dest.x, quad.dest.y, quad.dest.width, quad.dest.height },
+            { 0, 0 }, 0.0f, WHITE
+        );
+    }
+    drawCalls += (uint32_t)sceneDrawList.quads.size();
+}
+
+void Game::SubmitDebugOverlay()
+{
+    // Grouped by primitive, so raylib keeps each kind in one batch
+    for (const DebugRect& rect : debugDrawList.rects) {
+        DrawRectangleRec({ rect.x, rect.y, rect.width, rect.height }, { rect.color.r, rect.color.g, rect.color.b, rect.color.a });
+    }
+    for (const DebugLine& line : debugDrawList.lines) {
+        DrawLineV({ line.x0, line.y0 }, { line.x1, line.y1 }, { line.color.r, line.color.g, line.color.b, line.color.a });
+    }
+    drawCalls += (uint32_t)(debugDrawList.rects.size() + debugDrawList.lines.size());
+}
+
+void Game::SelectQuality()
+{
+    QualityTier tier = QUALITY_HIGH;
+    const char* forced = getenv("HOVERCAT_QUALITY");
+    if (forced != nullptr && ParseQualityTier(forced, tier)) {
+        TraceLog(LOG_INFO, "QUALITY: %s (forced by HOVERCAT_QUALITY)", forced);
+        ApplyQuality(tier);
+        return;
+    }
+
+    QualityCache cache;
+    std::string hardware = QualityHardwareKey();
+    std::string build = QualityBuildKey();
+#ifndef __EMSCRIPTEN__
+    if (LoadQualityCache("quality.txt", cache) && cache.hardware == hardware && cache.build == build) {
+        TraceLog(LOG_INFO, "QUALITY: %s (cached, %.2f ms/frame)", QualityTierName(cache.tier), cache.frameMs);
+        ApplyQuality(cache.tier);
+        return;
+    }
+#endif
+
+    // First launch, new hardware or new build: measure
+    cache.hardware = hardware;
+    cache.build = build;
+    cache.frameMs = RunQualityBenchmark();
+    cache.tier = PickQualityTier(cache.frameMs);
+    TraceLog(LOG_INFO, "QUALITY: %s (benchmarked %.2f ms/frame)", QualityTierName(cache.tier), cache.frameMs);
+#ifndef __EMSCRIPTEN__
+    SaveQualityCache("quality.txt", cache);
+#endif
+    ApplyQuality(cache.tier);
+}
+
+float Game::RunQualityBenchmark()
+{
+    const int warmupFrames = 30;
+    const int measuredFrames = 300;
+    const int fps = GetQualitySettings(QUALITY_HIGH).targetFps;
+    const uint16_t resetFlags = SIM_RESET_SPAWN_IMMEDIATELY | CollisionResetFlags();
+
+    // A scratch run steered by the autopilot, so the real game state is untouched
+    Simulation bench;
+    if (simulation.HasPlayerMasks()) {
+        bench.SetPlayerMasks(&eyesOpenMask, &eyesClosedMask);
+    }
+    bench.Reset(0x5EED, resetFlags);
+    Autopilot pilot(0x5EED);
+    SceneryResidency benchScenery;
+    float scrollX = 0.0f;
+    float tickBudget = 0.0f;
+    double start = 0.0;
+
+    for (int frame = 0; frame < warmupFrames + measuredFrames; frame++) {
+        if (frame == warmupFrames) {
+            // Drain the warm-up frames from the GPU before starting the clock
+            UnloadImage(LoadImageFromTexture(presenter.Target().texture));
+            start = GetTime();
+        }
+        for (tickBudget += (float)simTickRate / fps; tickBudget >= 1.0f; tickBudget -= 1.0f) {
+            if (bench.State().gameOver) {
+                bench.Reset(0x5EED, resetFlags);
+            }
+            bench.Step(pilot.WantsFlap(bench.State(), bench.Config()));
+        }
+        scrollX += bench.State().pipeSpeed * 0.2f / fps;
+
+        // Every scenery chunk counts as resident so the full layer stack is drawn
+        benchScenery.FillNeeded(scrollX, (float)gameScreenWidth);
+        RecordScene(sceneDrawList, bench.State(), bench.Config(), SceneSizes(), benchScenery,
+            scrollX, (float)gameScreenWidth, (float)gameScreenHeight);
+        BeginTextureMode(presenter.Target());
+        BeginMode2D(presenter.Camera());
+        SubmitScene();
+        EndMode2D();
+        EndTextureMode();
+    }
+
+    // Reading the target back waits until the GPU has finished every frame
+    UnloadImage(LoadImageFromTexture(presenter.Target().texture));
+    drawCalls = 0;
+    return (float)((GetTime() - start) * 1000.0 / measuredFrames);
+}
+
+void Game::ApplyQuality(QualityTier tier)
+{
+    qualityTier = tier;
+    const QualitySettings& settings = GetQualitySettings(tier);
+    presenter.SetRenderScale(settings.renderScale);
+    scenery.SetLayerMask(settings.sceneryLayers);
+}
+
+MetricsSample Game::CollectMetrics(float frameTime) const
+{
+    MetricsSample sample;
+    sample.frameTime = frameTime;
+    sample.simTicks = simTicks;
+    sample.drawCalls = drawCalls;
+    sample.framesSkipped = frameSkipper.FramesSkipped();
+    sample.pipeSpeed = simulation.State().pipeSpeed;
+    sample.score = simulation.State().score;
+    sample.highScore = highScore;
+    sample.musicPlaying = musicPlaying;
+    sample.musicTempo = MusicTempo(simulation);
+    sample.musicUnderruns = music.Underruns();
+    sample.musicOverBudget = music.OverBudget();
+    sample.memory = CollectMemory();
+    return sample;
+}
+
+namespace
+{
+    uint64_t TextureBytes(Texture2D texture)
+    {
+        return texture.id != 0 ? (uint64_t)GetPixelDataSize(texture.width, texture.height, texture.format) : 0;
+    }
+
+    // raylib converts sounds to the playback device's format: 32-bit float stereo
+    const uint64_t deviceFrameBytes = 2 * sizeof(float);
+    // raylib gives an audio stream two sub-buffers of this many frames, even one fed by a callback
+    const uint64_t musicStreamFrames = 4096;
+}
+
+MemoryUsage Game::CollectMemory() const
+{
+    MemoryUsage usage = {};
+    for (int i = 0; i < MEM_SUBSYSTEM_COUNT; i++) {
+        usage.heap[i] = GetHeapBytes((MemorySubsystem)i);
+    }
+    usage.gpuScenery = scenery.GpuBytes();
+    usage.gpuSprites = TextureBytes(pipeTexture) + TextureBytes(playerTexture) + TextureBytes(playerTextureEyesClosed);
+    usage.gpuFont = TextureBytes(font.texture);
+    // The depth attachment is a 24-bit renderbuffer, padded to 32 bits
+    Texture2D target = presenter.Target().texture;
+    usage.gpuRenderTarget = TextureBytes(target) + (uint64_t)target.width * target.height * 4;
+    usage.audioMusic = 2 * musicStreamFrames * deviceFrameBytes + music.Bytes();
+    usage.audioSounds = mixer.ClipBytes();
+#ifdef __EMSCRIPTEN__
+    usage.wasmHeap = emscripten_get_heap_size();
+#endif
+    return usage;
+}
+
+void Game::CheckMemoryBudget(float dt)
+{
+    memoryCheckTimer -= dt;
+    if (memoryCheckTimer > 0.0f) {
+        return;
+    }
+    memoryCheckTimer = 1.0f;
+    MemoryUsage usage = CollectMemory();
+    const MemoryBudget& budget = GetMemoryBudget(qualityTier);
+    uint32_t overage = ::CheckMemoryBudget(usage, budget);
+    // Each pool is reported once when it first goes over
+    uint32_t fresh = overage & ~memoryWarned;
+    if (fresh != 0) {
+        TraceLog(LOG_WARNING, "MEMORY: Over the %s tier budget: %s", QualityTierName(qualityTier),
+            DescribeMemoryOverage(usage, budget, fresh).c_str());
+        memoryWarned |= fresh;
+    }
+}
+
 void Game::LoadHighScore()
 {
 #ifndef __EMSCRIPTEN__
@@ -695,25 +1278,117 @@ void Game::LoadHighScore()
 void Game::SaveHighScore()
 {
 #ifndef __EMSCRIPTEN__
-    std::ofstream file("highscore.txt");
-    if (file.is_open()) {
-        file << highScore;
-        file.close();
-    }
+    // A newer score replaces a save that hasn't started, so a streak writes once
+    std::string text = std::to_string(highScore);
+    PostFileWrite("high score", "highscore.txt", std::vector<uint8_t>(text.begin(), text.end()), false, TASK_KEY_HIGH_SCORE);
 #endif
 }
 
-void Game::UpdatePipeSpeed(float dt)
+void Game::PostFileWrite(const char* name, const std::string& path, std::vector<uint8_t> bytes, bool append, uint32_t key)
 {
-    pipeSpeed += pipeSpeedIncrease * dt;  // Smooth speed increase over time 
-    if (pipeSpeed > maxSpeed) {
-        pipeSpeed = maxSpeed;
+    FileWriter writer(path, std::move(bytes), append);
+    tasks.Post(name, TASK_LOW, [this, writer]() mutable {
+        HitchDetector::Scope phase(hitchDetector, PHASE_SAVE_IO);
+        HeapScope heapScope(MEM_OTHER);
+        return writer.Step();
+    }, key);
+}
+
+void Game::StepSimulation()
+{
+    HeapScope heapScope(MEM_GAMEPLAY);
+    uint32_t events = replay.RecordStep(simulation, stepper, pendingFlap);
+    pendingFlap = false;
+    simTicks++;
+
+    if (events & SIM_EVENT_SCORE) {
+        mixer.Play(CLIP_SCORE, 1.0f, PlayerPan());
+        if (simulation.State().score > highScore && IsRankedRun()) {
+            highScore = simulation.State().score;
+            SaveHighScore();
+        }
     }
-    pipeSpawnInterval = initialPipeDistance / pipeSpeed; // Adjust spawn interval to maintain constant distance between pipes
-    backgroundScrollSpeed = pipeSpeed * 0.2f;  // Update background scroll speed to 20% of current pipe speed
-    
-    // Scale gravity and jump force with pipe speed
-    //float speedRatio = pipeSpeed / basePipeSpeed;  // How much faster we are compared to base speed
-    //gravity = defaultGravity * speedRatio;  // Scale gravity with speed
-    //jumpForce = defaultJumpForce * speedRatio;  // Scale jump force with speed
-}
\ No newline at end of file
+    if (events & SIM_EVENT_COURSE_END) {
+        TraceLog(LOG_INFO, "COURSE: All %u pipes spawned", simulation.State().pipesSpawned);
+    }
+    if (events & SIM_EVENT_DEATH) {
+        PlayerDied();
+    }
+}
+
+void Game::LoadCourse()
+{
+    const char* path = getenv("HOVERCAT_COURSE");
+    if (path == nullptr || path[0] == '\0') {
+        return;
+    }
+    if (course.Open(path)) {
+        simulation.SetGapSource(&course);
+        TraceLog(LOG_INFO, "COURSE: %s, %llu pipes streamed through a %d KB window", path,
+            (unsigned long long)course.PipeCount(), (int)(course.WindowBytes() / 1024));
+    } else {
+        TraceLog(LOG_WARNING, "COURSE: %s, playing random gaps", course.Error().c_str());
+    }
+}
+
+void Game::PlayerDied()
+{
+    const SimState& state = simulation.State();
+    gameOver = true;
+    gameOverDelayTimer = gameOverDelayDuration; // Initialize delay timer
+    LogState(STATE_GAME_OVER);
+    // Cut the other effects and duck the music under the hit sound until the next run
+    mixer.StopVoices();
+    mixer.Duck(deathDuckGain);
+    mixer.Play(CLIP_HIT, 1.0f, PlayerPan());
+    if (state.score > highScore && IsRankedRun()) {
+        highScore = state.score;
+        SaveHighScore();
+    }
+
+    replay.Finish(simulation);
+    // Practice, course and stepped runs would skew the heatmaps of normal play
+    if (IsRankedRun()) {
+        RunRecord record = {};
+        record.magic = runRecordMagic;
+        record.pipeIndex = (uint32_t)state.score;
+        record.playerY = state.playerY;
+        record.pipeSpeed = state.pipeSpeed;
+        record.gapDelta = state.fatalPipe.gapDelta;
+        record.gapCenter = state.fatalPipe.gapCenter;
+        record.cause = state.deathCause;
+        AppendRunRecord(record);
+        SaveReplay();
+    }
+}
+
+void Game::SaveReplay()
+{
+#ifndef __EMSCRIPTEN__
+    std::vector<uint8_t> bytes;
+    replay.Encode(bytes);
+    PostFileWrite("replay", "last_run.hkrp", std::move(bytes), false, TASK_KEY_REPLAY);
+#endif
+}
+
+void Game::AppendRunRecord(const RunRecord& record)
+{
+#ifndef __EMSCRIPTEN__
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&record);
+    PostFileWrite("run record", "runs.bin", std::vector<uint8_t>(bytes, bytes + sizeof(record)), true);
+#else
+    (void)record;
+#endif
+}
+
+void Game::LogInput(TelemetryInput input, float value0, float value1)
+{
+    Telemetry::Write(TELEMETRY_INPUT, input, value0, value1);
+    hitchDetector.NoteInput(input);
+}
+
+void Game::LogState(TelemetryState state)
+{
+    Telemetry::Write(TELEMETRY_STATE, state, (float)simulation.State().score, simulation.State().pipeSpeed);
+    hitchDetector.NoteState(state);
+}
@@ -4,12 +4,26 @@
 #include <vector>
 #include <fstream>
 #include "raylib.h"
-
-struct Pipe {
-    float x;
-    float gapCenter;
-    bool scored;
-};
+#include "runrecord.h"
+#include "metrics.h"
+#include "telemetry.h"
+#include "hitchdetector.h"
+#include "simulation.h"
+#include "course.h"
+#include "replay.h"
+#include "drawlist.h"
+#include "debugoverlay.h"
+#include "framestepper.h"
+#include "scenerystreamer.h"
+#include "uicanvas.h"
+#include "presenter.h"
+#include "qualitytier.h"
+#include "frameskipper.h"
+#include "memorybudget.h"
+#include "assetwatcher.h"
+#include "taskscheduler.h"
+#include "audiomixer.h"
+#include "musicstream.h"
 
 class Game
 {
@@ -18,6 +32,7 @@ public:
     ~Game();
     void InitGame();
     void Reset();
+    void StartPracticeRun();
     void Update(float dt);
     void HandleInput();
     bool UpdateUI();
@@ -26,6 +41,13 @@ public:
     void DrawUI();
     std::string FormatWithLeadingZeroes(int number, int width);
     void Randomize();
+    MetricsSample CollectMetrics(float frameTime) const;
+    void SetFrameBudget(float seconds)
+    {
+        hitchDetector.SetFrameBudget(seconds);
+        frameSkipper.SetBudget(seconds);
+    }
+    int TargetFps() const { return GetQualitySettings(qualityTier).targetFps; }
 
     static bool isMobile;
 
@@ -36,76 +58,152 @@ private:
     bool lostWindowFocus;
     bool gameOver;
 
-    float screenScale;
-    RenderTexture2D targetRenderTex;
+    // Render target and the cached screen transform
+    Presenter presenter;
     Font font;
 
     int width;
     int height;
 
-    // Score system
-    int score;
+    // Score system (the current score lives in the simulation)
     int highScore;
     void LoadHighScore();
     void SaveHighScore();
 
+    // Death handling and run records for offline difficulty analysis
+    void PlayerDied();
+    void AppendRunRecord(const RunRecord& record);
+
     float ballX;
     float ballY;
     int ballRadius;
     float ballSpeed;
     Color ballColor;
 
-    // Game variables
-    float playerX;
-    float playerY;
-    float playerSize;
-    float playerVelocity;
-    const float defaultGravity = 1200.0f;
-    const float defaultJumpForce = -400.0f;
-    const float defaultPipeSpeed = 300.0f;
-    const float defaultPipeSpawnInterval = 600.0f / defaultPipeSpeed;
-    const float defaultPipeWidth = 80.0f;
-    const float defaultPipeGap = 230.0f;
-    const float pipeSpeedIncrease = 10.0f;  // Speed increase per second
-    const float maxGapHeightDifference = 100.0f;  // Maximum allowed vertical distance between consecutive pipe gaps
-    const float maxSpeed = 1200.0f;
-    float gravity;
-    float jumpForce;
-    float pipeWidth;
-    float pipeGap;
-    float pipeSpeed;
-    float basePipeSpeed;  // Store the initial pipe speed
-    float initialPipeDistance;  // Store the initial distance between pipes
-    int speedLevel;       // Track the current speed level
-    std::vector<Pipe> pipes;
-    float pipeSpawnTimer;
-    float pipeSpawnInterval;
-
-    // Sound variables
-    Music gameMusic;
-    Sound flySound;
-    Sound hitSound;
-    Sound scoreSound;
+    // Gameplay runs in fixed ticks on a deterministic simulation
+    Simulation simulation;
+    float tickAccumulator;      // Frame time not yet consumed by simulation ticks
+    bool pendingFlap;           // Flap input waiting for the next tick
+    uint32_t runSeed;           // Seed of the current run
+    const float maxFrameCatchUp = 0.25f;  // Longest frame time turned into ticks
+    void StepSimulation();
+
+    // Step mode (F6): the simulation only advances by hand, one tick at a time,
+    // and can be stepped back through the stepper's snapshots
+    FrameStepper stepper;
+    bool stepMode;
+    bool steppedRun;            // Step mode was entered this run, so it isn't ranked
+    void UpdateStepMode();
+
+    // Every run is recorded so it can be replayed and verified
+    Replay replay;
+    void SaveReplay();
+
+    // Sound variables. The music is time-stretched to the pipe speed and mixed by
+    // raylib, the mixer adds the effects on the audio thread and applies ducking,
+    // panning and the pause low-pass.
+    MusicStream music;
+    AudioMixer mixer;
+    bool audioMuffled;          // Last state sent to the mixer
     bool musicPlaying;
     bool musicManuallyDisabled;
+    uint64_t musicUnderruns;    // Last count logged
+    float PlayerPan() const;
+    // Restarts the music at full volume for a new run unless the player turned it off
+    void ResumeMusic();
 
-    void UpdatePipeSpeed(float dt);  // Add function to update pipe speed
-
-    // Background scrolling
-    Texture2D backgroundTexture;
+    // Background scrolling over streamed procedural scenery
+    SceneryStreamer scenery;
     float backgroundScrollX;
     float backgroundScrollSpeed;
 
     Texture2D playerTexture;
     Texture2D playerTextureEyesClosed;
-    float playerEyesClosedTimer; // Time left to display eyes closed
-    const float playerEyesClosedDuration = 0.33f; // Duration in seconds
+
+    // Pixel collision masks built from the player sprites' alpha
+    CollisionMask eyesOpenMask;
+    CollisionMask eyesClosedMask;
+    // Hot-reloaded masks wait for the next run: the one being recorded has to replay
+    // with the masks it started with
+    CollisionMask reloadedMasks[2];     // Eyes open, eyes closed
+    bool masksReloaded[2];
+    void ApplyReloadedMasks();
+    // Builds the mask and uploads a decoded RGBA8 sprite, then frees the image
+    Texture2D LoadPlayerSprite(const char* path, Image& image, CollisionMask& mask);
+    uint16_t CollisionResetFlags() const;
 
     float gameOverDelayTimer; // Time left before allowing input after game over
     const float gameOverDelayDuration = 0.5f; // Duration in seconds
 
-    float playerCollisionWidthRatio; 
-    float playerCollisionHeightRatio;
-
     Texture2D pipeTexture;
+
+    // Scene is recorded into a draw list, then submitted through raylib
+    DrawList sceneDrawList;
+    SceneTextureSizes SceneSizes() const;
+    Texture2D SceneTexture(uint8_t texture) const;
+    void SubmitScene();
+
+    // Collision boxes, gaps, reach and predicted arcs over the play field (F1). Off
+    // costs nothing: the overlay is only recorded and drawn while shown.
+    bool showDebug;
+    uint32_t debugLayers;       // DebugLayer bits, from HOVERCAT_DEBUG
+    DebugDrawList debugDrawList;
+    void SubmitDebugOverlay();
+
+    // Practice runs start straight at practiceSpeed; they don't set high scores or save replays
+    bool practiceRun;
+    float practiceSpeed;
+    void UpdatePracticeSpeed();
+    std::string PracticePrompt() const;
+
+    // Authored course from HOVERCAT_COURSE=<file>, replacing the random gaps. Like
+    // practice runs, course runs don't set high scores or save replays.
+    CourseFile course;
+    void LoadCourse();
+    bool IsRankedRun() const { return !practiceRun && !steppedRun && !simulation.HasCourse(); }
+
+    // Quality tier from the cached or freshly run startup benchmark
+    QualityTier qualityTier;
+    void SelectQuality();
+    float RunQualityBenchmark();
+    void ApplyQuality(QualityTier tier);
+
+    // HUD and menus, drawn after the scaled blit at screen resolution
+    UiCanvas ui;
+
+    // Memory footprint against the quality tier's budget, checked once a second and
+    // shown with F8
+    bool showMemory;
+    float memoryCheckTimer;
+    uint32_t memoryWarned;      // MemoryOverage bits already logged
+    MemoryUsage CollectMemory() const;
+    void CheckMemoryBudget(float dt);
+
+    // Main-thread work that can wait: texture uploads, asset swaps and save flushes
+    // run at the end of a drawn frame, in whatever time is left before its deadline
+    TaskScheduler tasks;
+    const double taskPresentMargin = 0.002;     // Kept free for EndDrawing's swap
+    void PostFileWrite(const char* name, const std::string& path, std::vector<uint8_t> bytes, bool append, uint32_t key = 0);
+
+#ifdef HOVERCAT_HOT_RELOAD
+    // Changed assets are decoded by the watcher and swapped in by scheduled tasks
+    AssetWatcher assetWatcher;
+    std::vector<ReloadedAsset> reloadedAssets;
+    void StartAssetWatcher();
+    void ApplyAssetReloads();
+    void ApplyAssetReload(ReloadedAsset& asset);
+#endif
+
+    // Runtime counters for the metrics endpoint
+    uint64_t simTicks;    // Simulation updates since startup
+    uint32_t drawCalls;   // Scene draw submissions in the last Draw()
+
+    // Per-phase frame timing with pre-hitch context capture
+    HitchDetector hitchDetector;
+
+    // Drops presents while the loop is behind, the simulation keeps its ticks
+    FrameSkipper frameSkipper;
+    double frameStartTime;
+    void LogInput(TelemetryInput input, float value0 = 0.0f, float value1 = 0.0f);
+    void LogState(TelemetryState state);
 };
\ No newline at end of file
@@ -0,0 +1,207 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#include "hitchdetector.h"
+#include "telemetry.h"
+
+const char* FramePhaseName(int phase)
+{
+    static const char* names[PHASE_COUNT] = {
+        "other", "input/ui", "music streaming", "simulation", "save I/O",
+        "texture upload", "draw scene", "draw ui", "present"
+    };
+    return (phase >= 0 && phase < PHASE_COUNT) ? names[phase] : "unknown";
+}
+
+HitchDetector::HitchDetector()
+    : frameBudget(1.0f / 144.0f), history(historySize), frameCount(0), current(nullptr),
+      phaseDepth(0), cooldown(0.0f), reportsWritten(0), stopRequested(false)
+{
+    std::fill(phaseAverage, phaseAverage + PHASE_COUNT, 0.0f);
+#ifndef __EMSCRIPTEN__
+    writerThread = std::thread(&HitchDetector::WriterLoop, this);
+#endif
+}
+
+HitchDetector::~HitchDetector()
+{
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        stopRequested = true;
+    }
+    queueCondition.notify_one();
+    if (writerThread.joinable()) {
+        writerThread.join();
+    }
+}
+
+void HitchDetector::BeginFrame()
+{
+    Clock::time_point now = Clock::now();
+    if (current != nullptr) {
+        ChargeCurrentPhase();
+        EndFrame(std::chrono::duration<float>(now - frameStart).count());
+    }
+
+    current = &history[frameCount % historySize];
+    memset(current, 0, sizeof(FrameTrace));
+    current->frame = frameCount++;
+    frameStart = now;
+    phaseStart = now;
+    phaseDepth = 0;
+    phaseStack[0] = PHASE_OTHER;
+}
+
+void HitchDetector::ChargeCurrentPhase()
+{
+    // Charge the time since the last switch to whichever phase was running
+    Clock::time_point now = Clock::now();
+    current->phaseTime[phaseStack[phaseDepth]] += std::chrono::duration<float>(now - phaseStart).count();
+    phaseStart = now;
+}
+
+void HitchDetector::BeginPhase(FramePhase phase)
+{
+    if (current == nullptr || phaseDepth + 1 >= maxPhaseDepth) {
+        return;
+    }
+    ChargeCurrentPhase();
+    phaseStack[++phaseDepth] = phase;
+}
+
+void HitchDetector::EndPhase()
+{
+    if (current == nullptr || phaseDepth == 0) {
+        return;
+    }
+    ChargeCurrentPhase();
+    phaseDepth--;
+}
+
+void HitchDetector::NoteInput(uint16_t code)
+{
+    if (current != nullptr && current->inputCount < 4) {
+        current->inputs[current->inputCount++] = code;
+    }
+}
+
+void HitchDetector::NoteState(uint16_t code)
+{
+    if (current != nullptr && current->stateCount < 4) {
+        current->states[current->stateCount++] = code;
+    }
+}
+
+void HitchDetector::EndFrame(float frameTime)
+{
+    current->frameTime = frameTime;
+    cooldown = std::max(0.0f, cooldown - frameTime);
+
+    bool hitch = frameCount > warmupFrames && frameTime > hitchFactor * frameBudget;
+    if (hitch) {
+        // The phase that grew the most over its usual cost is the likely culprit
+        int offending = PHASE_OTHER;
+        float worstExcess = -1.0f;
+        for (int phase = 0; phase < PHASE_COUNT; phase++) {
+            float excess = current->phaseTime[phase] - phaseAverage[phase];
+            if (excess > worstExcess) {
+                worstExcess = excess;
+                offending = phase;
+            }
+        }
+        Telemetry::Write(TELEMETRY_HITCH, (uint16_t)offending, frameTime, frameBudget);
+
+        if (cooldown <= 0.0f && writerThread.joinable()) {
+            cooldown = reportCooldown;
+            Report report;
+            report.frameBudget = frameBudget;
+            report.offendingPhase = offending;
+            int count = (int)std::min<uint32_t>(frameCount, historySize);
+            report.history.reserve(count);
+            for (int i = count - 1; i >= 0; i--) {
+                report.history.push_back(history[(frameCount - 1 - i) % historySize]);
+            }
+            {
+                std::lock_guard<std::mutex> lock(queueMutex);
+                queue.push_back(std::move(report));
+            }
+            queueCondition.notify_one();
+            reportsWritten++;
+        }
+    } else {
+        // Hitch frames are kept out of the averages so they stay representative
+        for (int phase = 0; phase < PHASE_COUNT; phase++) {
+            phaseAverage[phase] += (current->phaseTime[phase] - phaseAverage[phase]) * 0.05f;
+        }
+    }
+}
+
+void HitchDetector::WriterLoop()
+{
+    std::unique_lock<std::mutex> lock(queueMutex);
+    for (;;) {
+        queueCondition.wait(lock, [this] { return stopRequested || !queue.empty(); });
+        if (queue.empty()) {
+            return;
+        }
+        Report report = std::move(queue.front());
+        queue.pop_front();
+        lock.unlock();
+        WriteReport(report);
+        lock.lock();
+    }
+}
+
+void HitchDetector::WriteReport(const Report& report)
+{
+    const FrameTrace& hitch = report.history.back();
+    char path[64];
+    snprintf(path, sizeof(path), "hitch_%u.txt", hitch.frame);
+    FILE* file = fopen(path, "w");
+    if (file == nullptr) {
+        return;
+    }
+
+    // Per-phase medians over the captured window, for comparison with the hitch frame
+    float median[PHASE_COUNT];
+    std::vector<float> values(report.history.size());
+    for (int phase = 0; phase < PHASE_COUNT; phase++) {
+        for (size_t i = 0; i < report.history.size(); i++) {
+            values[i] = report.history[i].phaseTime[phase];
+        }
+        std::nth_element(values.begin(), values.begin() + values.size() / 2, values.end());
+        median[phase] = values[values.size() / 2];
+    }
+
+    fprintf(file, "Hitch at frame %u: %.3f ms (budget %.3f ms)\n", hitch.frame,
+        hitch.frameTime * 1000.0f, report.frameBudget * 1000.0f);
+    fprintf(file, "Offending phase: %s\n\n", FramePhaseName(report.offendingPhase));
+    fprintf(file, "%-18s %10s %10s\n", "phase", "hitch ms", "median ms");
+    for (int phase = 0; phase < PHASE_COUNT; phase++) {
+        fprintf(file, "%-18s %10.3f %10.3f\n", FramePhaseName(phase),
+            hitch.phaseTime[phase] * 1000.0f, median[phase] * 1000.0f);
+    }
+
+    fprintf(file, "\nPrevious %d frames (ms), oldest first:\nframe,total", (int)report.history.size());
+    for (int phase = 0; phase < PHASE_COUNT; phase++) {
+        fprintf(file, ",%s", FramePhaseName(phase));
+    }
+    fprintf(file, ",inputs,states\n");
+    for (const FrameTrace& trace : report.history) {
+        fprintf(file, "%u,%.3f", trace.frame, trace.frameTime * 1000.0f);
+        for (int phase = 0; phase < PHASE_COUNT; phase++) {
+            fprintf(file, ",%.3f", trace.phaseTime[phase] * 1000.0f);
+        }
+        fprintf(file, ",");
+        for (int i = 0; i < trace.inputCount; i++) {
+            fprintf(file, "%s%u", i ? " " : "", trace.inputs[i]);
+        }
+        fprintf(file, ",");
+        for (int i = 0; i < trace.stateCount; i++) {
+            fprintf(file, "%s%u", i ? " " : "", trace.states[i]);
+        }
+        fprintf(file, "\n");
+    }
+    fclose(file);
+}
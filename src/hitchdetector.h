@@ -0,0 +1,107 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Subsystems timed every frame. Times are exclusive: a nested phase pauses its parent.
+enum FramePhase {
+    PHASE_OTHER = 0,
+    PHASE_INPUT_UI,
+    PHASE_MUSIC_STREAM,
+    PHASE_SIMULATION,
+    PHASE_SAVE_IO,
+    PHASE_TEXTURE_UPLOAD,
+    PHASE_DRAW_SCENE,
+    PHASE_DRAW_UI,
+    PHASE_PRESENT,
+    PHASE_COUNT
+};
+
+const char* FramePhaseName(int phase);
+
+struct FrameTrace {
+    uint32_t frame;
+    float frameTime;                // Wall time from this frame's start to the next one
+    float phaseTime[PHASE_COUNT];
+    uint16_t inputs[4];             // TelemetryInput codes seen this frame
+    uint16_t states[4];             // TelemetryState codes entered this frame
+    uint8_t inputCount;
+    uint8_t stateCount;
+};
+
+// Keeps the last few seconds of per-phase frame timings in memory. When a frame
+// exceeds hitchFactor times the budget, the history is handed to a background thread
+// that writes hitch_<frame>.txt naming the phase that blew up.
+class HitchDetector
+{
+public:
+    HitchDetector();
+    ~HitchDetector();
+
+    void SetFrameBudget(float seconds) { frameBudget = seconds; }
+
+    // Closes the previous frame (checking it for a hitch) and starts timing a new one
+    void BeginFrame();
+
+    void BeginPhase(FramePhase phase);
+    void EndPhase();
+
+    void NoteInput(uint16_t code);
+    void NoteState(uint16_t code);
+
+    int ReportsWritten() const { return reportsWritten; }
+
+    // RAII helper for BeginPhase/EndPhase
+    class Scope
+    {
+    public:
+        Scope(HitchDetector& detector, FramePhase phase) : detector(detector) { detector.BeginPhase(phase); }
+        ~Scope() { detector.EndPhase(); }
+    private:
+        HitchDetector& detector;
+    };
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    struct Report {
+        std::vector<FrameTrace> history;    // Oldest first, hitch frame last
+        float frameBudget;
+        int offendingPhase;
+    };
+
+    void ChargeCurrentPhase();
+    void EndFrame(float frameTime);
+    void WriterLoop();
+    static void WriteReport(const Report& report);
+
+    static const int historySize = 1024;        // About 7s at 144 FPS
+    static const int maxPhaseDepth = 8;
+    const float hitchFactor = 2.0f;
+    const float reportCooldown = 10.0f;         // Seconds between reports
+    const uint32_t warmupFrames = 120;          // Ignore loading hitches right after startup
+
+    float frameBudget;
+    std::vector<FrameTrace> history;
+    uint32_t frameCount;
+    FrameTrace* current;
+    float phaseAverage[PHASE_COUNT];            // Exponential moving average per phase
+
+    Clock::time_point frameStart;
+    Clock::time_point phaseStart;
+    FramePhase phaseStack[maxPhaseDepth];
+    int phaseDepth;
+    float cooldown;
+    int reportsWritten;
+
+    std::thread writerThread;
+    std::mutex queueMutex;
+    std::condition_variable queueCondition;
+    std::deque<Report> queue;
+    bool stopRequested;
+};
@@ -0,0 +1,234 @@
+#include <algorithm>
+
+#include "jobsystem.h"
+
+namespace
+{
+    // Which system's worker this thread is, and its queue
+    thread_local const JobSystem* currentSystem = nullptr;
+    thread_local unsigned currentThread = 0;
+    // Victim selection, xorshift seeded per thread
+    thread_local uint32_t stealState = 0;
+
+    uint32_t NextVictim()
+    {
+        if (stealState == 0) {
+            stealState = (uint32_t)std::hash<std::thread::id>()(std::this_thread::get_id()) | 1u;
+        }
+        stealState ^= stealState << 13;
+        stealState ^= stealState >> 17;
+        stealState ^= stealState << 5;
+        return stealState;
+    }
+}
+
+JobSystem::JobSystem(unsigned threads)
+    : queues(1), queuedJobs(0), quit(false), sleepers(0), jobsRun(0), jobsStolen(0)
+{
+#ifndef __EMSCRIPTEN__
+    if (threads == 0) {
+        threads = std::thread::hardware_concurrency();
+    }
+    if (threads > 1) {
+        std::vector<Queue> sized(threads);
+        queues.swap(sized);
+        for (unsigned thread = 1; thread < threads; thread++) {
+            workers.emplace_back(&JobSystem::WorkerLoop, this, thread);
+        }
+    }
+#else
+    (void)threads;
+#endif
+}
+
+JobSystem::~JobSystem()
+{
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        quit.store(true);
+    }
+    wake.notify_all();
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+}
+
+unsigned JobSystem::CurrentThread() const
+{
+    return currentSystem == this ? currentThread : 0;
+}
+
+void JobSystem::Submit(Job job, JobCounter& counter)
+{
+    job.counter = &counter;
+    counter.pending.fetch_add(1, std::memory_order_relaxed);
+    Queue& queue = queues[CurrentThread()];
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.jobs.push_back(job);
+        queue.size.store(queue.jobs.size(), std::memory_order_relaxed);
+    }
+    queuedJobs.fetch_add(1);
+    if (sleepers.load() > 0) {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        wake.notify_one();
+    }
+}
+
+bool JobSystem::TakeJob(unsigned thread, Job& job)
+{
+    if (queuedJobs.load(std::memory_order_relaxed) == 0) {
+        return false;
+    }
+    // Newest of our own first
+    Queue& own = queues[thread];
+    if (own.size.load(std::memory_order_relaxed) > 0) {
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.jobs.empty()) {
+            job = own.jobs.back();
+            own.jobs.pop_back();
+            own.size.store(own.jobs.size(), std::memory_order_relaxed);
+            queuedJobs.fetch_sub(1);
+            return true;
+        }
+    }
+    // Then the oldest of someone else's, starting at a random victim
+    size_t count = queues.size();
+    size_t first = NextVictim() % count;
+    for (size_t i = 0; i < count; i++) {
+        Queue& victim = queues[(first + i) % count];
+        if (&victim == &own || victim.size.load(std::memory_order_relaxed) == 0) {
+            continue;
+        }
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.jobs.empty()) {
+            job = victim.jobs.front();
+            victim.jobs.pop_front();
+            victim.size.store(victim.jobs.size(), std::memory_order_relaxed);
+            queuedJobs.fetch_sub(1);
+            jobsStolen.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+    return false;
+}
+
+void JobSystem::Execute(const Job& job)
+{
+    JobCounter* counter = job.counter;
+    job.function(job);
+    jobsRun.fetch_add(1, std::memory_order_relaxed);
+    counter->pending.fetch_sub(1, std::memory_order_release);
+}
+
+void JobSystem::Wait(JobCounter& counter)
+{
+    unsigned thread = CurrentThread();
+    Job job;
+    while (!counter.Done()) {
+        if (TakeJob(thread, job)) {
+            Execute(job);
+        } else {
+            // Whatever is left is running on other threads
+            std::this_thread::yield();
+        }
+    }
+}
+
+void JobSystem::WorkerLoop(unsigned thread)
+{
+    currentSystem = this;
+    currentThread = thread;
+    Job job;
+    int idle = 0;
+    while (!quit.load(std::memory_order_relaxed)) {
+        if (TakeJob(thread, job)) {
+            Execute(job);
+            idle = 0;
+            continue;
+        }
+        if (++idle < idleSpins) {
+            std::this_thread::yield();
+            continue;
+        }
+        // Submit checks for sleepers after queueing, so a job queued between the
+        // check below and the wait still wakes us
+        sleepers.fetch_add(1);
+        {
+            std::unique_lock<std::mutex> lock(sleepMutex);
+            while (queuedJobs.load() == 0 && !quit.load()) {
+                wake.wait(lock);
+            }
+        }
+        sleepers.fetch_sub(1);
+        idle = 0;
+    }
+}
+
+void JobSystem::RunRange(const Job& job)
+{
+    const ForContext& context = *static_cast<const ForContext*>(job.data);
+    JobSystem& system = *context.system;
+    Queue& own = system.queues[system.CurrentThread()];
+    size_t begin = job.begin;
+    size_t end = job.end;
+    while (begin < end) {
+        if (end - begin > context.grain && own.size.load(std::memory_order_relaxed) == 0) {
+            // Nothing of ours left to steal: offer the upper half
+            size_t middle = begin + (end - begin) / 2;
+            system.Submit(Job{ &RunRange, job.data, middle, end, nullptr }, *job.counter);
+            end = middle;
+            continue;
+        }
+        size_t stop = begin + std::min(context.grain, end - begin);
+        context.call(context.body, begin, stop);
+        begin = stop;
+    }
+}
+
+TaskGraph::Node TaskGraph::Add(std::function<void()> work)
+{
+    nodes.emplace_back();
+    nodes.back().work = std::move(work);
+    return (Node)(nodes.size() - 1);
+}
+
+void TaskGraph::Precede(Node before, Node after)
+{
+    nodes[before].successors.push_back(after);
+    nodes[after].predecessors++;
+}
+
+void TaskGraph::Run(JobSystem& jobs)
+{
+    running = &jobs;
+    for (NodeData& node : nodes) {
+        node.remaining.store(node.predecessors, std::memory_order_relaxed);
+    }
+    JobCounter counter;
+    for (size_t i = 0; i < nodes.size(); i++) {
+        if (nodes[i].predecessors == 0) {
+            Schedule((Node)i, counter);
+        }
+    }
+    jobs.Wait(counter);
+    running = nullptr;
+}
+
+void TaskGraph::Schedule(Node node, JobCounter& counter)
+{
+    running->Submit(Job{ &RunNode, this, node, node + 1, nullptr }, counter);
+}
+
+void TaskGraph::RunNode(const Job& job)
+{
+    TaskGraph& graph = *static_cast<TaskGraph*>(job.data);
+    NodeData& node = graph.nodes[job.begin];
+    node.work();
+    // The counter can't reach zero while this job is still running
+    for (Node successor : node.successors) {
+        if (graph.nodes[successor].remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            graph.Schedule(successor, *job.counter);
+        }
+    }
+}
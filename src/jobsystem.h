@@ -0,0 +1,152 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Jobs still running or queued under one Submit/Wait scope
+class JobCounter
+{
+public:
+    JobCounter() : pending(0) {}
+    bool Done() const { return pending.load(std::memory_order_acquire) == 0; }
+
+private:
+    friend class JobSystem;
+    std::atomic<uint32_t> pending;
+};
+
+// A unit of work. function runs it; data, begin and end are whatever it needs.
+struct Job {
+    void (*function)(const Job& job);
+    void* data;
+    size_t begin;
+    size_t end;
+    JobCounter* counter;        // Set by Submit
+};
+
+// Work-stealing thread pool. Every thread has its own deque: it pushes and pops jobs
+// at the back, so it keeps working on what it split off last while that is still in
+// cache, and idle threads steal the oldest (biggest) job from the front of someone
+// else's. A thread waiting on a counter runs jobs instead of blocking, so jobs may
+// submit and wait on jobs of their own. Web builds have no threads and run every job
+// on the waiting thread.
+class JobSystem
+{
+public:
+    // threads = 0 sizes the pool to the machine: a worker per hardware thread besides
+    // the one that waits
+    explicit JobSystem(unsigned threads = 0);
+    ~JobSystem();
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    // Threads that run jobs, the workers plus the waiting thread
+    unsigned ThreadCount() const { return (unsigned)queues.size(); }
+    // 1..ThreadCount()-1 on workers, 0 on any other thread. Fixed for a job's duration,
+    // so it can index per-thread scratch data as long as one outside thread waits at a time.
+    unsigned CurrentThread() const;
+
+    void Submit(Job job, JobCounter& counter);
+    // Runs queued jobs until every job submitted under counter has finished
+    void Wait(JobCounter& counter);
+
+    // body(begin, end) over [0, count) in pieces of at least grain items. A range is
+    // only split while the splitting thread has nothing queued for others to steal, so
+    // tiny bodies cost a few splits per thread instead of a job per item.
+    template<typename Body>
+    void ParallelFor(size_t count, size_t grain, const Body& body);
+
+    uint64_t JobsRun() const { return jobsRun.load(std::memory_order_relaxed); }
+    uint64_t JobsStolen() const { return jobsStolen.load(std::memory_order_relaxed); }
+
+private:
+    struct alignas(64) Queue {
+        std::mutex mutex;
+        std::deque<Job> jobs;
+        std::atomic<size_t> size{0};
+    };
+
+    struct ForContext {
+        JobSystem* system;
+        size_t grain;
+        const void* body;
+        void (*call)(const void* body, size_t begin, size_t end);
+    };
+
+    template<typename Body>
+    static void CallBody(const void* body, size_t begin, size_t end)
+    {
+        (*static_cast<const Body*>(body))(begin, end);
+    }
+
+    static void RunRange(const Job& job);
+
+    bool TakeJob(unsigned thread, Job& job);
+    void Execute(const Job& job);
+    void WorkerLoop(unsigned thread);
+
+    std::vector<Queue> queues;          // Index 0 belongs to outside threads
+    std::vector<std::thread> workers;
+    std::atomic<size_t> queuedJobs;
+    std::atomic<bool> quit;
+
+    // Idle workers sleep here until a job is queued
+    std::mutex sleepMutex;
+    std::condition_variable wake;
+    std::atomic<unsigned> sleepers;
+
+    std::atomic<uint64_t> jobsRun;
+    std::atomic<uint64_t> jobsStolen;
+
+    const int idleSpins = 64;          // Steal attempts before a worker sleeps
+};
+
+template<typename Body>
+void JobSystem::ParallelFor(size_t count, size_t grain, const Body& body)
+{
+    if (count == 0) {
+        return;
+    }
+    ForContext context = { this, grain > 0 ? grain : 1, &body, &CallBody<Body> };
+    JobCounter counter;
+    Submit(Job{ &RunRange, &context, 0, count, nullptr }, counter);
+    Wait(counter);
+}
+
+// Jobs with dependencies, built once and run as often as needed. Each node becomes a
+// job as soon as the last of its predecessors finishes.
+class TaskGraph
+{
+public:
+    typedef uint32_t Node;
+
+    Node Add(std::function<void()> work);
+    // after runs only once before has finished
+    void Precede(Node before, Node after);
+    // Runs every node once; returns when all have finished
+    void Run(JobSystem& jobs);
+
+    size_t Size() const { return nodes.size(); }
+
+private:
+    struct NodeData {
+        std::function<void()> work;
+        std::vector<Node> successors;
+        uint32_t predecessors = 0;
+        std::atomic<uint32_t> remaining{0};     // Predecessors still running this Run
+    };
+
+    static void RunNode(const Job& job);
+    void Schedule(Node node, JobCounter& counter);
+
+    std::deque<NodeData> nodes;     // Stable addresses, NodeData isn't movable
+    JobSystem* running = nullptr;
+};
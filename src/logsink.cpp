@@ -0,0 +1,322 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include "raylib.h"
+#include "logsink.h"
+
+#ifndef __EMSCRIPTEN__
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#endif
+
+namespace
+{
+    const size_t ringCapacity = 1024;           // Slots, power of two
+    const size_t maxLineLength = 232;           // Longer lines are truncated
+    const int flushIntervalMs = 100;
+    const size_t maxFileBytes = 1024 * 1024;    // Rotate after this much
+    const int keptFiles = 3;                    // hovercat.log, .1 and .2
+    const uint32_t linesPerCategorySecond = 30;
+    const size_t categoryBuckets = 64;
+    const size_t maxCategoryLength = 16;
+    const int linesPerPump = 8;
+
+    // One formatted line. sequence is the slot's turn in the ring: producers may fill it
+    // when it equals their position, the consumer may read it once it is position + 1.
+    struct LogSlot {
+        std::atomic<uint64_t> sequence;
+        uint64_t timeNs;
+        int level;
+        uint32_t length;
+        char text[maxLineLength];
+    };
+
+    // Lines from one category (the "TEXTURE:" style prefix raylib and the game use)
+    // within the current second. Categories share a bucket when their hashes collide.
+    struct CategoryBucket {
+        std::atomic<uint32_t> second{0};
+        std::atomic<uint32_t> lines{0};
+        std::atomic<uint32_t> suppressed{0};
+    };
+
+    LogSlot slots[ringCapacity];
+    std::atomic<uint64_t> enqueuePos(0);
+    uint64_t dequeuePos = 0;                    // Consumer only
+    CategoryBucket buckets[categoryBuckets];
+
+    std::atomic<bool> enabled(false);
+    std::atomic<uint64_t> droppedLines(0);
+    std::atomic<uint64_t> rateLimitedLines(0);
+    std::chrono::steady_clock::time_point startTime;
+
+    FILE* outputFile = nullptr;     // stdout for the console
+    std::string outputPath;         // Empty for the console
+    size_t fileBytes = 0;
+
+#ifndef __EMSCRIPTEN__
+    std::thread writerThread;
+    std::mutex wakeMutex;
+    std::condition_variable wakeCondition;
+    bool stopRequested = false;
+#endif
+
+    const char* LevelName(int level)
+    {
+        // raylib's TraceLogLevel
+        switch (level) {
+            case LOG_TRACE: return "TRACE";
+            case LOG_DEBUG: return "DEBUG";
+            case LOG_INFO: return "INFO";
+            case LOG_WARNING: return "WARNING";
+            case LOG_ERROR: return "ERROR";
+            case LOG_FATAL: return "FATAL";
+            default: return "LOG";
+        }
+    }
+
+    uint64_t NowNs()
+    {
+        return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - startTime).count();
+    }
+
+    // Claims a slot and copies the line in; false when the ring is full
+    bool Enqueue(int level, const char* text, size_t length)
+    {
+        uint64_t pos = enqueuePos.load(std::memory_order_relaxed);
+        LogSlot* slot;
+        for (;;) {
+            slot = &slots[pos & (ringCapacity - 1)];
+            uint64_t sequence = slot->sequence.load(std::memory_order_acquire);
+            int64_t diff = (int64_t)(sequence - pos);
+            if (diff == 0) {
+                if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                droppedLines.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            } else {
+                pos = enqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+        slot->timeNs = NowNs();
+        slot->level = level;
+        slot->length = (uint32_t)std::min(length, maxLineLength);
+        memcpy(slot->text, text, slot->length);
+        slot->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    size_t CategoryLength(const char* text)
+    {
+        // "TEXTURE: [ID 3] Unloaded" -> "TEXTURE"
+        size_t length = 0;
+        while (length < maxCategoryLength && ((text[length] >= 'A' && text[length] <= 'Z') || (text[length] >= '0' && text[length] <= '9') || text[length] == '_')) {
+            length++;
+        }
+        return text[length] == ':' ? length : 0;
+    }
+
+    // Counts the line against its category; false once the category is over its limit
+    bool TakeRateLimit(const char* text)
+    {
+        size_t length = CategoryLength(text);
+        uint32_t hash = 2166136261u;
+        for (size_t i = 0; i < length; i++) {
+            hash = (hash ^ (uint8_t)text[i]) * 16777619u;
+        }
+        CategoryBucket& bucket = buckets[hash & (categoryBuckets - 1)];
+
+        uint32_t second = (uint32_t)(NowNs() / 1000000000ull) + 1;
+        uint32_t bucketSecond = bucket.second.load(std::memory_order_relaxed);
+        if (bucketSecond != second && bucket.second.compare_exchange_strong(bucketSecond, second, std::memory_order_relaxed)) {
+            // First line of a new second reports what the last one held back
+            bucket.lines.store(0, std::memory_order_relaxed);
+            uint32_t suppressed = bucket.suppressed.exchange(0, std::memory_order_relaxed);
+            if (suppressed > 0) {
+                char note[96];
+                int noteLength = snprintf(note, sizeof(note), "LOG: %u %.*s lines rate limited", suppressed,
+                    (int)(length > 0 ? length : 7), length > 0 ? text : "GENERAL");
+                Enqueue(LOG_WARNING, note, (size_t)noteLength);
+            }
+        }
+        if (bucket.lines.fetch_add(1, std::memory_order_relaxed) >= linesPerCategorySecond) {
+            bucket.suppressed.fetch_add(1, std::memory_order_relaxed);
+            rateLimitedLines.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        return true;
+    }
+
+    void Rotate()
+    {
+        if (outputFile != nullptr) {
+            fclose(outputFile);
+        }
+        for (int i = keptFiles - 1; i > 0; i--) {
+            std::string from = i > 1 ? outputPath + "." + std::to_string(i - 1) : outputPath;
+            std::string to = outputPath + "." + std::to_string(i);
+            remove(to.c_str());     // rename doesn't replace on Windows
+            rename(from.c_str(), to.c_str());
+        }
+        outputFile = fopen(outputPath.c_str(), "w");
+        fileBytes = 0;
+    }
+
+    // Writes up to maxLines queued lines; returns how many were written
+    int Drain(int maxLines)
+    {
+        int written = 0;
+        while (written < maxLines) {
+            LogSlot& slot = slots[dequeuePos & (ringCapacity - 1)];
+            if (slot.sequence.load(std::memory_order_acquire) != dequeuePos + 1) {
+                break;
+            }
+            if (outputFile != nullptr) {
+                double seconds = (double)slot.timeNs / 1e9;
+                int length = fprintf(outputFile, "%10.3f %s: %.*s\n", seconds, LevelName(slot.level), (int)slot.length, slot.text);
+                fileBytes += length > 0 ? (size_t)length : 0;
+            }
+            slot.sequence.store(dequeuePos + ringCapacity, std::memory_order_release);
+            dequeuePos++;
+            written++;
+            if (!outputPath.empty() && fileBytes >= maxFileBytes) {
+                Rotate();
+            }
+        }
+        if (written > 0 && outputFile != nullptr) {
+            fflush(outputFile);
+        }
+        return written;
+    }
+
+#ifndef __EMSCRIPTEN__
+    void WriterLoop()
+    {
+        std::unique_lock<std::mutex> lock(wakeMutex);
+        while (!stopRequested) {
+            wakeCondition.wait_for(lock, std::chrono::milliseconds(flushIntervalMs));
+            lock.unlock();
+            while (Drain((int)ringCapacity) > 0) {
+            }
+            lock.lock();
+        }
+        lock.unlock();
+        while (Drain((int)ringCapacity) > 0) {
+        }
+    }
+#endif
+}
+
+namespace LogSink
+{
+    bool StartFromEnvironment()
+    {
+        const char* setting = getenv("HOVERCAT_LOG");
+        if (setting != nullptr && strcmp(setting, "0") == 0) {
+            return false;
+        }
+        return Start(setting != nullptr && setting[0] != '\0' ? setting : nullptr);
+    }
+
+    bool Start(const char* path)
+    {
+        if (enabled.load()) {
+            return true;
+        }
+        outputPath = path != nullptr ? path : "";
+        outputFile = path != nullptr ? fopen(path, "w") : stdout;
+        if (outputFile == nullptr) {
+            return false;
+        }
+        fileBytes = 0;
+        for (size_t i = 0; i < ringCapacity; i++) {
+            slots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+        enqueuePos.store(0, std::memory_order_relaxed);
+        dequeuePos = 0;
+        startTime = std::chrono::steady_clock::now();
+#ifndef __EMSCRIPTEN__
+        stopRequested = false;
+        writerThread = std::thread(WriterLoop);
+#endif
+        enabled.store(true, std::memory_order_release);
+        SetTraceLogCallback(Write);
+        return true;
+    }
+
+    void Stop()
+    {
+        if (!enabled.exchange(false)) {
+            return;
+        }
+        SetTraceLogCallback(nullptr);
+#ifndef __EMSCRIPTEN__
+        {
+            std::lock_guard<std::mutex> lock(wakeMutex);
+            stopRequested = true;
+        }
+        wakeCondition.notify_one();
+        writerThread.join();
+#else
+        while (Drain((int)ringCapacity) > 0) {
+        }
+#endif
+        if (outputFile != stdout && outputFile != nullptr) {
+            fclose(outputFile);
+        }
+        outputFile = nullptr;
+    }
+
+    void Write(int logLevel, const char* format, va_list args)
+    {
+        char line[maxLineLength + 1];
+        int length = vsnprintf(line, sizeof(line), format, args);
+        if (length < 0) {
+            return;
+        }
+        if (logLevel >= LOG_FATAL) {
+            // raylib only exits on a fatal line when no callback is set, so do it here
+            // once the line and everything before it are written out
+            bool queued = enabled.load(std::memory_order_acquire) && Enqueue(logLevel, line, std::min((size_t)length, maxLineLength));
+            Stop();
+            if (!queued || !outputPath.empty()) {
+                fprintf(stderr, "%s: %s\n", LevelName(logLevel), line);
+            }
+            exit(EXIT_FAILURE);
+        }
+        if (!enabled.load(std::memory_order_acquire)) {
+            fprintf(stderr, "%s: %s\n", LevelName(logLevel), line);
+            return;
+        }
+        if (TakeRateLimit(line)) {
+            Enqueue(logLevel, line, std::min((size_t)length, maxLineLength));
+        }
+    }
+
+    void Pump()
+    {
+#ifdef __EMSCRIPTEN__
+        if (enabled.load(std::memory_order_relaxed)) {
+            Drain(linesPerPump);
+        }
+#endif
+    }
+
+    uint64_t DroppedLines()
+    {
+        return droppedLines.load(std::memory_order_relaxed);
+    }
+
+    uint64_t RateLimitedLines()
+    {
+        return rateLimitedLines.load(std::memory_order_relaxed);
+    }
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstdarg>
+#include <cstdint>
+
+// Asynchronous replacement for raylib's TraceLog output. Lines are formatted on the
+// calling thread into a fixed slot of a lock-free multi-producer ring; a background
+// thread writes them to a rotating log file or the console. A full ring or a chatty
+// category drops lines and counts them instead of waiting, so logging never blocks a
+// frame. The web build has no threads and pumps a few lines per frame instead.
+
+namespace LogSink
+{
+    // Reads HOVERCAT_LOG: unset logs to the console, "0" keeps raylib's synchronous
+    // output, anything else is the path of a rotating log file
+    bool StartFromEnvironment();
+    bool Start(const char* path);   // nullptr for the console
+    void Stop();    // Writes out every queued line and restores raylib's output
+
+    // TraceLogCallback, installed by Start
+    void Write(int logLevel, const char* format, va_list args);
+    // Web builds only: writes up to a frame's share of queued lines
+    void Pump();
+
+    // Lines lost to a full ring
+    uint64_t DroppedLines();
+    // Lines suppressed by the per-category rate limit
+    uint64_t RateLimitedLines();
+}
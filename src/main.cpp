@@ -1,33 +1,75 @@
 #include "raylib.h"
 #include "globals.h"
 #include "game.h"
+#include "metrics.h"
+#include "telemetry.h"
+#include "sampler.h"
+#include "logsink.h"
 #include <iostream>
+#include <cstdlib>
 #ifdef __EMSCRIPTEN__
 #include <emscripten.h>
 #endif
 
 Game* game = nullptr;
+MetricsServer* metricsServer = nullptr;
+uint32_t frameIndex = 0;
+const int targetFPS = 144;
+double lastFrameStart = 0.0;
 
 void mainLoop()
 {
-    float dt = GetFrameTime();
+    // Measured here rather than with GetFrameTime, which only advances in EndDrawing
+    // and so stalls on frames the frame skipper doesn't draw
+    double now = GetTime();
+    float dt = (float)(now - lastFrameStart);
+    lastFrameStart = now;
+    Telemetry::SetFrame(frameIndex++);
+
     game->Update(dt);
     game->Draw();
+
+    // dt covers the previous frame including present and the frame limiter wait,
+    // hitches are reported by the game's hitch detector
+    Telemetry::Write(TELEMETRY_FRAME, 0, dt, (float)(GetTime() - now));
+
+    if (metricsServer) {
+        metricsServer->Publish(game->CollectMetrics(dt));
+    }
+    LogSink::Pump();
 }
 
 int main()
 {
+    // Before InitWindow so raylib's startup lines go through the sink too
+    LogSink::StartFromEnvironment();
     InitWindow(gameScreenWidth, gameScreenHeight, "Hovercat");
 #ifndef EMSCRIPTEN_BUILD
     SetWindowState(FLAG_WINDOW_RESIZABLE);
     ToggleBorderlessWindowed();
 #endif
     SetExitKey(KEY_NULL);
-    SetTargetFPS(144);
+    SetTargetFPS(targetFPS);
     
+    Telemetry::StartFromEnvironment();
+    SamplingProfiler::StartFromEnvironment();
+
     game = new Game(gameScreenWidth, gameScreenHeight);
     game->Randomize();
+    // The quality tier picked at startup decides the frame rate
+    SetTargetFPS(game->TargetFps());
+    game->SetFrameBudget(1.0f / game->TargetFps());
+
+    // Opt-in Prometheus endpoint, enabled with HOVERCAT_METRICS_PORT=<port>
+    metricsServer = new MetricsServer();
+    if (metricsServer->StartFromEnvironment()) {
+        TraceLog(LOG_INFO, "METRICS: Serving on 127.0.0.1:%s", getenv("HOVERCAT_METRICS_PORT"));
+    } else {
+        delete metricsServer;
+        metricsServer = nullptr;
+    }
 
+    lastFrameStart = GetTime();
 #ifdef __EMSCRIPTEN__
     emscripten_set_main_loop(mainLoop, 0, 1);
 #else
@@ -38,8 +80,12 @@ int main()
     {
         mainLoop();
     }
+    SamplingProfiler::Stop();
+    delete metricsServer;
     delete game;
+    Telemetry::Stop();
     CloseWindow();
+    LogSink::Stop();
 #endif
 
     return 0;
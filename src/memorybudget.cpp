@@ -0,0 +1,88 @@
+#include <cstdio>
+
+#include "memorybudget.h"
+
+namespace
+{
+    const uint64_t MB = 1024 * 1024;
+
+    // The low tier matches the web build's 16 MB initial heap allowed to grow to 64 MB
+    const MemoryBudget budgets[QUALITY_TIER_COUNT] = {
+        { 16 * MB, 32 * MB, 24 * MB, 64 * MB },     // Low
+        { 32 * MB, 64 * MB, 32 * MB, 128 * MB },    // Medium
+        { 64 * MB, 128 * MB, 32 * MB, 256 * MB },   // High
+    };
+
+    std::string Megabytes(uint64_t bytes)
+    {
+        char text[32];
+        snprintf(text, sizeof(text), "%.1f MB", (double)bytes / MB);
+        return text;
+    }
+}
+
+uint64_t MemoryUsage::HeapTotal() const
+{
+    uint64_t total = 0;
+    for (uint64_t bytes : heap) {
+        total += bytes;
+    }
+    return total;
+}
+
+const MemoryBudget& GetMemoryBudget(QualityTier tier)
+{
+    return budgets[tier];
+}
+
+uint32_t CheckMemoryBudget(const MemoryUsage& usage, const MemoryBudget& budget)
+{
+    uint32_t overage = 0;
+    if (usage.HeapTotal() > budget.heap) {
+        overage |= MEMORY_OVER_HEAP;
+    }
+    if (usage.GpuTotal() > budget.gpu) {
+        overage |= MEMORY_OVER_GPU;
+    }
+    if (usage.AudioTotal() > budget.audio) {
+        overage |= MEMORY_OVER_AUDIO;
+    }
+    if (usage.wasmHeap > budget.wasmHeap) {
+        overage |= MEMORY_OVER_WASM_HEAP;
+    }
+    return overage;
+}
+
+std::string DescribeMemoryOverage(const MemoryUsage& usage, const MemoryBudget& budget, uint32_t overage)
+{
+    struct Field { uint32_t bit; const char* name; uint64_t used; uint64_t limit; };
+    const Field fields[] = {
+        { MEMORY_OVER_HEAP, "heap", usage.HeapTotal(), budget.heap },
+        { MEMORY_OVER_GPU, "gpu", usage.GpuTotal(), budget.gpu },
+        { MEMORY_OVER_AUDIO, "audio", usage.AudioTotal(), budget.audio },
+        { MEMORY_OVER_WASM_HEAP, "wasm heap", usage.wasmHeap, budget.wasmHeap },
+    };
+    std::string text;
+    for (const Field& field : fields) {
+        if (overage & field.bit) {
+            text += (text.empty() ? "" : ", ") + std::string(field.name) + " " + Megabytes(field.used) + " of " + Megabytes(field.limit);
+        }
+    }
+    return text;
+}
+
+std::string FormatMemoryUsage(const MemoryUsage& usage)
+{
+    std::string text = "heap " + Megabytes(usage.HeapTotal()) + ":";
+    for (int i = 0; i < MEM_SUBSYSTEM_COUNT; i++) {
+        text += std::string(" ") + MemorySubsystemName((MemorySubsystem)i) + " " + Megabytes(usage.heap[i]);
+    }
+    text += "\ngpu " + Megabytes(usage.GpuTotal()) + ": scenery " + Megabytes(usage.gpuScenery) + " sprites "
+        + Megabytes(usage.gpuSprites) + " font " + Megabytes(usage.gpuFont) + " target " + Megabytes(usage.gpuRenderTarget);
+    text += "\naudio " + Megabytes(usage.AudioTotal()) + ": music " + Megabytes(usage.audioMusic) + " sounds "
+        + Megabytes(usage.audioSounds);
+    if (usage.wasmHeap > 0) {
+        text += "\nwasm heap " + Megabytes(usage.wasmHeap);
+    }
+    return text;
+}
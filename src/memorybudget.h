@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "alloctrack.h"
+#include "qualitytier.h"
+
+// Memory footprint of a running game. GPU and audio figures are estimates from the
+// resource sizes (raylib doesn't report what the driver or miniaudio really hold):
+// textures count width x height x their pixel format, sound effects their mono float
+// mixer clips, the music its stream's sub-buffers plus the FIFO and time-stretch buffers.
+struct MemoryUsage {
+    uint64_t heap[MEM_SUBSYSTEM_COUNT];     // Live operator new bytes
+    uint64_t gpuScenery;        // Scenery pool and sky
+    uint64_t gpuSprites;        // Pipe and player sprites
+    uint64_t gpuFont;           // Font atlas
+    uint64_t gpuRenderTarget;   // Color and depth of the game render target
+    uint64_t audioMusic;        // Music stream buffers
+    uint64_t audioSounds;       // Decoded sound effects
+    uint64_t wasmHeap;          // Web builds: size of the wasm heap, 0 elsewhere
+
+    uint64_t HeapTotal() const;
+    uint64_t GpuTotal() const { return gpuScenery + gpuSprites + gpuFont + gpuRenderTarget; }
+    uint64_t AudioTotal() const { return audioMusic + audioSounds; }
+};
+
+// Per quality tier; the low tier is what the mobile web build has to fit in
+struct MemoryBudget {
+    uint64_t heap;
+    uint64_t gpu;
+    uint64_t audio;
+    uint64_t wasmHeap;
+};
+
+const MemoryBudget& GetMemoryBudget(QualityTier tier);
+
+// Bit per MemoryBudget field that usage exceeds
+enum MemoryOverage : uint32_t {
+    MEMORY_OVER_HEAP = 1 << 0,
+    MEMORY_OVER_GPU = 1 << 1,
+    MEMORY_OVER_AUDIO = 1 << 2,
+    MEMORY_OVER_WASM_HEAP = 1 << 3,
+};
+
+uint32_t CheckMemoryBudget(const MemoryUsage& usage, const MemoryBudget& budget);
+// "gpu 41.2 MB of 32.0 MB" for each bit in overage, comma separated
+std::string DescribeMemoryOverage(const MemoryUsage& usage, const MemoryBudget& budget, uint32_t overage);
+// Multi-line breakdown for overlays and logs
+std::string FormatMemoryUsage(const MemoryUsage& usage);
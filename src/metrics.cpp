@@ -0,0 +1,354 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "metrics.h"
+#include "alloctrack.h"
+#include "logsink.h"
+
+#if defined(_WIN32)
+#include <winsock2.h>
+#include <ws2tcpip.h>
+typedef SOCKET SocketHandle;
+#define CLOSE_SOCKET closesocket
+#elif !defined(__EMSCRIPTEN__)
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <unistd.h>
+typedef int SocketHandle;
+#define CLOSE_SOCKET close
+#define INVALID_SOCKET (-1)
+#endif
+
+// A scraper hanging up early must not raise SIGPIPE and kill the game; where the
+// send flag doesn't exist the socket option does (macOS), Windows has no SIGPIPE
+#if defined(MSG_NOSIGNAL)
+#define SEND_FLAGS MSG_NOSIGNAL
+#else
+#define SEND_FLAGS 0
+#endif
+
+namespace
+{
+    // Label sets of hovercat_memory_bytes, in MetricsServer::memoryBytes order after
+    // the per-subsystem heap entries
+    const char* memoryLabels[] = {
+        "pool=\"gpu\",use=\"scenery\"",
+        "pool=\"gpu\",use=\"sprites\"",
+        "pool=\"gpu\",use=\"font\"",
+        "pool=\"gpu\",use=\"render_target\"",
+        "pool=\"audio\",use=\"music\"",
+        "pool=\"audio\",use=\"sounds\"",
+        "pool=\"wasm_heap\",use=\"total\"",
+    };
+}
+
+MetricsServer::MetricsServer()
+    : sequence(0), simTicks(0), drawCalls(0), framesSkipped(0), pipeSpeed(0.0f), score(0), highScore(0),
+      musicPlaying(false), musicTempo(1.0f), musicUnderruns(0), musicOverBudget(0), simTicksPerSecond(0.0f), frameCount(0),
+      rateWindow(0.0f), rateWindowStartTicks(0), running(false), listenSocket(-1)
+{
+    for (auto& bytes : memoryBytes) {
+        bytes.store(0, std::memory_order_relaxed);
+    }
+    for (auto& frameTime : frameTimes) {
+        frameTime.store(0.0f, std::memory_order_relaxed);
+    }
+}
+
+MetricsServer::~MetricsServer()
+{
+    Stop();
+}
+
+bool MetricsServer::StartFromEnvironment()
+{
+    const char* port = getenv("HOVERCAT_METRICS_PORT");
+    if (port == nullptr || atoi(port) <= 0) {
+        return false;
+    }
+    return Start(atoi(port));
+}
+
+void MetricsServer::Publish(const MetricsSample& sample)
+{
+    // Frame times go to the ring first, readers only trust entries below frameCount
+    uint64_t frame = frameCount.load(std::memory_order_relaxed);
+    frameTimes[frame % frameHistorySize].store(sample.frameTime, std::memory_order_relaxed);
+    frameCount.store(frame + 1, std::memory_order_release);
+
+    rateWindow += sample.frameTime;
+    if (rateWindow >= 1.0f) {
+        simTicksPerSecond.store((float)(sample.simTicks - rateWindowStartTicks) / rateWindow, std::memory_order_relaxed);
+        rateWindow = 0.0f;
+        rateWindowStartTicks = sample.simTicks;
+    }
+
+    // Odd sequence marks a write in progress
+    uint32_t seq = sequence.load(std::memory_order_relaxed);
+    sequence.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    simTicks.store(sample.simTicks, std::memory_order_relaxed);
+    drawCalls.store(sample.drawCalls, std::memory_order_relaxed);
+    framesSkipped.store(sample.framesSkipped, std::memory_order_relaxed);
+    pipeSpeed.store(sample.pipeSpeed, std::memory_order_relaxed);
+    score.store(sample.score, std::memory_order_relaxed);
+    highScore.store(sample.highScore, std::memory_order_relaxed);
+    musicPlaying.store(sample.musicPlaying, std::memory_order_relaxed);
+    musicTempo.store(sample.musicTempo, std::memory_order_relaxed);
+    musicUnderruns.store(sample.musicUnderruns, std::memory_order_relaxed);
+    musicOverBudget.store(sample.musicOverBudget, std::memory_order_relaxed);
+    const MemoryUsage& memory = sample.memory;
+    const uint64_t pools[] = { memory.gpuScenery, memory.gpuSprites, memory.gpuFont, memory.gpuRenderTarget,
+        memory.audioMusic, memory.audioSounds, memory.wasmHeap };
+    for (int i = 0; i < memoryFieldCount; i++) {
+        memoryBytes[i].store(i < MEM_SUBSYSTEM_COUNT ? memory.heap[i] : pools[i - MEM_SUBSYSTEM_COUNT], std::memory_order_relaxed);
+    }
+    sequence.store(seq + 2, std::memory_order_release);
+}
+
+int MetricsServer::BuildResponseBody(char* out, int capacity)
+{
+    // Copy the scalar snapshot, retrying while the frame thread is mid-write
+    uint64_t ticks;
+    uint32_t draws;
+    uint64_t skipped;
+    float speed;
+    float tickRate;
+    int currentScore;
+    int best;
+    bool music;
+    float tempo;
+    uint64_t underruns;
+    uint64_t overBudget;
+    uint64_t memory[memoryFieldCount];
+    for (;;) {
+        uint32_t before = sequence.load(std::memory_order_acquire);
+        if (before & 1) {
+            std::this_thread::yield();
+            continue;
+        }
+        ticks = simTicks.load(std::memory_order_relaxed);
+        draws = drawCalls.load(std::memory_order_relaxed);
+        skipped = framesSkipped.load(std::memory_order_relaxed);
+        speed = pipeSpeed.load(std::memory_order_relaxed);
+        tickRate = simTicksPerSecond.load(std::memory_order_relaxed);
+        currentScore = score.load(std::memory_order_relaxed);
+        best = highScore.load(std::memory_order_relaxed);
+        music = musicPlaying.load(std::memory_order_relaxed);
+        tempo = musicTempo.load(std::memory_order_relaxed);
+        underruns = musicUnderruns.load(std::memory_order_relaxed);
+        overBudget = musicOverBudget.load(std::memory_order_relaxed);
+        for (int i = 0; i < memoryFieldCount; i++) {
+            memory[i] = memoryBytes[i].load(std::memory_order_relaxed);
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (sequence.load(std::memory_order_relaxed) == before) {
+            break;
+        }
+    }
+
+    // Percentiles over the most recent frames; a torn entry only skews one sample
+    uint64_t frames = frameCount.load(std::memory_order_acquire);
+    int count = (int)std::min<uint64_t>(frames, frameHistorySize);
+    float sorted[frameHistorySize];
+    for (int i = 0; i < count; i++) {
+        sorted[i] = frameTimes[i].load(std::memory_order_relaxed);
+    }
+    std::sort(sorted, sorted + count);
+    auto percentile = [&](float p) {
+        return count > 0 ? sorted[std::min(count - 1, (int)(p * count))] : 0.0f;
+    };
+
+    int length = snprintf(out, capacity,
+        "# HELP hovercat_frame_time_seconds Frame time over the last %d frames.\n"
+        "# TYPE hovercat_frame_time_seconds summary\n"
+        "hovercat_frame_time_seconds{quantile=\"0.5\"} %.6f\n"
+        "hovercat_frame_time_seconds{quantile=\"0.9\"} %.6f\n"
+        "hovercat_frame_time_seconds{quantile=\"0.99\"} %.6f\n"
+        "hovercat_frame_time_seconds_count %llu\n"
+        "# TYPE hovercat_sim_ticks_total counter\n"
+        "hovercat_sim_ticks_total %llu\n"
+        "# TYPE hovercat_sim_ticks_per_second gauge\n"
+        "hovercat_sim_ticks_per_second %.2f\n"
+        "# TYPE hovercat_draw_calls gauge\n"
+        "hovercat_draw_calls %u\n"
+        "# TYPE hovercat_frames_skipped_total counter\n"
+        "hovercat_frames_skipped_total %llu\n"
+        "# TYPE hovercat_allocations_total counter\n"
+        "hovercat_allocations_total %llu\n"
+        "# TYPE hovercat_deallocations_total counter\n"
+        "hovercat_deallocations_total %llu\n"
+        "# TYPE hovercat_log_dropped_total counter\n"
+        "hovercat_log_dropped_total %llu\n"
+        "# TYPE hovercat_log_rate_limited_total counter\n"
+        "hovercat_log_rate_limited_total %llu\n"
+        "# TYPE hovercat_music_playing gauge\n"
+        "hovercat_music_playing %d\n"
+        "# TYPE hovercat_music_tempo gauge\n"
+        "hovercat_music_tempo %.3f\n"
+        "# TYPE hovercat_music_underruns_total counter\n"
+        "hovercat_music_underruns_total %llu\n"
+        "# TYPE hovercat_music_stretch_over_budget_total counter\n"
+        "hovercat_music_stretch_over_budget_total %llu\n"
+        "# TYPE hovercat_pipe_speed gauge\n"
+        "hovercat_pipe_speed %.2f\n"
+        "# TYPE hovercat_score gauge\n"
+        "hovercat_score %d\n"
+        "# TYPE hovercat_high_score gauge\n"
+        "hovercat_high_score %d\n",
+        count, percentile(0.5f), percentile(0.9f), percentile(0.99f),
+        (unsigned long long)frames, (unsigned long long)ticks, tickRate, draws, (unsigned long long)skipped,
+        (unsigned long long)GetAllocationCount(), (unsigned long long)GetDeallocationCount(),
+        (unsigned long long)LogSink::DroppedLines(), (unsigned long long)LogSink::RateLimitedLines(),
+        music ? 1 : 0, tempo, (unsigned long long)underruns, (unsigned long long)overBudget, speed, currentScore, best);
+
+    // Heap is live operator new bytes; GPU and audio are estimates from resource sizes
+    length += snprintf(out + length, std::max(0, capacity - length),
+        "# HELP hovercat_memory_bytes Memory by pool and use.\n"
+        "# TYPE hovercat_memory_bytes gauge\n");
+    for (int i = 0; i < memoryFieldCount && length < capacity; i++) {
+        if (i < MEM_SUBSYSTEM_COUNT) {
+            length += snprintf(out + length, capacity - length, "hovercat_memory_bytes{pool=\"heap\",use=\"%s\"} %llu\n",
+                MemorySubsystemName((MemorySubsystem)i), (unsigned long long)memory[i]);
+        } else {
+            length += snprintf(out + length, capacity - length, "hovercat_memory_bytes{%s} %llu\n",
+                memoryLabels[i - MEM_SUBSYSTEM_COUNT], (unsigned long long)memory[i]);
+        }
+    }
+    length += snprintf(out + length, std::max(0, capacity - length),
+        "# TYPE hovercat_heap_peak_bytes gauge\n"
+        "hovercat_heap_peak_bytes %llu\n", (unsigned long long)GetPeakHeapBytes());
+    return length;
+}
+
+#if defined(__EMSCRIPTEN__)
+
+bool MetricsServer::Start(int)
+{
+    return false;
+}
+
+void MetricsServer::Stop()
+{
+}
+
+void MetricsServer::Serve()
+{
+    HeapScope heapScope(MEM_DIAGNOSTICS);
+}
+
+#else
+
+bool MetricsServer::Start(int port)
+{
+    if (running.load()) {
+        return true;
+    }
+
+#if defined(_WIN32)
+    WSADATA wsaData;
+    if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) {
+        return false;
+    }
+#endif
+
+    SocketHandle sock = socket(AF_INET, SOCK_STREAM, 0);
+    if (sock == INVALID_SOCKET) {
+        return false;
+    }
+    int reuse = 1;
+    setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, (const char*)&reuse, sizeof(reuse));
+
+    // Loopback only, this is a monitoring hook and not meant to be reachable remotely
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((unsigned short)port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(sock, (sockaddr*)&addr, sizeof(addr)) != 0 || listen(sock, 4) != 0) {
+        CLOSE_SOCKET(sock);
+        return false;
+    }
+
+    listenSocket = (intptr_t)sock;
+    running.store(true);
+    serverThread = std::thread(&MetricsServer::Serve, this);
+    return true;
+}
+
+void MetricsServer::Stop()
+{
+    if (!running.exchange(false)) {
+        return;
+    }
+    if (serverThread.joinable()) {
+        serverThread.join();
+    }
+    CLOSE_SOCKET((SocketHandle)listenSocket);
+    listenSocket = -1;
+#if defined(_WIN32)
+    WSACleanup();
+#endif
+}
+
+void MetricsServer::Serve()
+{
+    HeapScope heapScope(MEM_DIAGNOSTICS);
+    static const int bodyCapacity = 8192;
+    char body[bodyCapacity];
+    char response[bodyCapacity + 256];
+    char request[1024];
+
+    while (running.load()) {
+        // Wake up regularly so Stop() never waits on a blocking accept
+        fd_set readSet;
+        FD_ZERO(&readSet);
+        SocketHandle server = (SocketHandle)listenSocket;
+        FD_SET(server, &readSet);
+        timeval timeout = {0, 200000};
+        if (select((int)server + 1, &readSet, nullptr, nullptr, &timeout) <= 0) {
+            continue;
+        }
+
+        SocketHandle client = accept(server, nullptr, nullptr);
+        if (client == INVALID_SOCKET) {
+            continue;
+        }
+        // A client that connects and then stalls must not wedge this thread, or Stop()
+        // would hang the game on exit
+#if defined(_WIN32)
+        DWORD ioTimeout = clientTimeoutMs;
+#else
+        timeval ioTimeout = {0, clientTimeoutMs * 1000};
+#endif
+        setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, (const char*)&ioTimeout, sizeof(ioTimeout));
+        setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, (const char*)&ioTimeout, sizeof(ioTimeout));
+#if defined(SO_NOSIGPIPE)
+        int noSignal = 1;
+        setsockopt(client, SOL_SOCKET, SO_NOSIGPIPE, &noSignal, sizeof(noSignal));
+#endif
+
+        // Any request gets the metrics page; the request itself is read and discarded
+        recv(client, request, sizeof(request), 0);
+
+        int bodyLength = std::min(BuildResponseBody(body, bodyCapacity), bodyCapacity - 1);
+        int length = snprintf(response, sizeof(response),
+            "HTTP/1.1 200 OK\r\n"
+            "Content-Type: text/plain; version=0.0.4\r\n"
+            "Content-Length: %d\r\n"
+            "Connection: close\r\n\r\n%s", bodyLength, body);
+        for (int sent = 0; sent < length;) {
+            int count = (int)send(client, response + sent, length - sent, SEND_FLAGS);
+            if (count <= 0) {
+                break;
+            }
+            sent += count;
+        }
+        CLOSE_SOCKET(client);
+    }
+}
+
+#endif
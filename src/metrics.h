@@ -0,0 +1,76 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+#include "memorybudget.h"
+
+// Per-frame values handed from the game to the metrics server
+struct MetricsSample {
+    float frameTime;        // Seconds spent on the last frame
+    uint64_t simTicks;      // Total simulation ticks since startup
+    uint32_t drawCalls;     // Draw submissions in the last frame
+    uint64_t framesSkipped; // Presents dropped by the frame skipper since startup
+    float pipeSpeed;
+    int score;
+    int highScore;
+    bool musicPlaying;
+    float musicTempo;
+    uint64_t musicUnderruns;    // Audio callbacks the music FIFO ran dry in
+    uint64_t musicOverBudget;   // Audio callbacks the time-stretch took longer than its budget in
+    MemoryUsage memory;
+};
+
+// Opt-in localhost HTTP endpoint serving runtime counters in Prometheus text format.
+// The frame thread publishes into lock-free slots, the server thread only reads them,
+// so a slow or stuck scraper can never stall a frame.
+class MetricsServer
+{
+public:
+    MetricsServer();
+    ~MetricsServer();
+
+    // Reads HOVERCAT_METRICS_PORT; returns false when unset, unsupported or the bind failed
+    bool StartFromEnvironment();
+    bool Start(int port);
+    void Stop();
+
+    // Frame thread only
+    void Publish(const MetricsSample& sample);
+
+private:
+    void Serve();
+    int BuildResponseBody(char* out, int capacity);
+
+    static const int frameHistorySize = 512;   // Window for frame time percentiles
+    static const int clientTimeoutMs = 500;     // Per recv/send on an accepted connection
+    static const int memoryFieldCount = MEM_SUBSYSTEM_COUNT + 7;   // Heap per subsystem, GPU, audio, wasm
+
+    // Seqlock-protected scalar snapshot, single writer (frame thread)
+    std::atomic<uint32_t> sequence;
+    std::atomic<uint64_t> simTicks;
+    std::atomic<uint32_t> drawCalls;
+    std::atomic<uint64_t> framesSkipped;
+    std::atomic<float> pipeSpeed;
+    std::atomic<int> score;
+    std::atomic<int> highScore;
+    std::atomic<bool> musicPlaying;
+    std::atomic<float> musicTempo;
+    std::atomic<uint64_t> musicUnderruns;
+    std::atomic<uint64_t> musicOverBudget;
+    std::atomic<float> simTicksPerSecond;
+    std::atomic<uint64_t> memoryBytes[memoryFieldCount];
+
+    // Frame time ring, the counter tells readers how many entries are valid
+    std::atomic<float> frameTimes[frameHistorySize];
+    std::atomic<uint64_t> frameCount;
+
+    // Frame thread bookkeeping for the ticks/sec gauge
+    float rateWindow;
+    uint64_t rateWindowStartTicks;
+
+    std::atomic<bool> running;
+    std::thread serverThread;
+    intptr_t listenSocket;
+};
@@ -0,0 +1,180 @@
+#include <algorithm>
+
+#include "musicstream.h"
+// raylib compiles dr_mp3 into its audio module, the game links against that copy
+#include "dr_mp3.h"
+
+struct Mp3Decoder {
+    drmp3 mp3;
+};
+
+namespace
+{
+    // What raylib's stream callback reads from, set while a stream is loaded
+    TimeStretch* activeStretch = nullptr;
+    AudioFifo* activeFifo = nullptr;
+
+    void StretchMusic(void* buffer, unsigned int frames)
+    {
+        activeStretch->Process(*activeFifo, static_cast<float*>(buffer), frames);
+    }
+}
+
+MusicStream::MusicStream()
+    : decoder(nullptr), fileData(nullptr), stream(), fifo(nullptr), stretch(nullptr), volume(1.0f), tempo(1.0f),
+      playing(false), closedUnderruns(0), closedOverBudget(0)
+{
+}
+
+MusicStream::~MusicStream()
+{
+    Close();
+}
+
+bool MusicStream::Open(const char* path)
+{
+    Mp3Decoder* opened = new Mp3Decoder();
+    if (!drmp3_init_file(&opened->mp3, path, nullptr)) {
+        delete opened;
+        return false;
+    }
+    return Start(opened, nullptr);
+}
+
+bool MusicStream::Open(unsigned char* data, int dataSize)
+{
+    Mp3Decoder* opened = new Mp3Decoder();
+    if (data == nullptr || !drmp3_init_memory(&opened->mp3, data, (size_t)dataSize, nullptr)) {
+        delete opened;
+        UnloadFileData(data);
+        return false;
+    }
+    return Start(opened, data);
+}
+
+bool MusicStream::Start(Mp3Decoder* opened, unsigned char* data)
+{
+    bool wasPlaying = playing;
+    Close();
+    decoder = opened;
+    fileData = data;
+    uint32_t sampleRate = decoder->mp3.sampleRate;
+    fifo = new AudioFifo((uint32_t)(fifoSeconds * sampleRate));
+    stretch = new TimeStretch(sampleRate);
+    stretch->SetTempo(tempo);
+    decoded.assign(2 * (size_t)decodeChunkFrames, 0.0f);
+    Update();
+
+    activeStretch = stretch;
+    activeFifo = fifo;
+    stream = LoadAudioStream(sampleRate, 32, 2);
+    SetAudioStreamCallback(stream, StretchMusic);
+    SetAudioStreamVolume(stream, volume);
+    if (wasPlaying) {
+        Play();
+    }
+    return true;
+}
+
+void MusicStream::Close()
+{
+    if (decoder == nullptr) {
+        return;
+    }
+    // raylib unloads under the audio lock, so the callback is done with the FIFO after this
+    UnloadAudioStream(stream);
+    activeStretch = nullptr;
+    activeFifo = nullptr;
+    closedUnderruns += stretch->Underruns();
+    closedOverBudget += stretch->OverBudget();
+    delete stretch;
+    delete fifo;
+    drmp3_uninit(&decoder->mp3);
+    delete decoder;
+    UnloadFileData(fileData);
+    stretch = nullptr;
+    fifo = nullptr;
+    decoder = nullptr;
+    fileData = nullptr;
+    stream = AudioStream();
+    playing = false;
+}
+
+void MusicStream::Play()
+{
+    if (decoder == nullptr || playing) {
+        return;
+    }
+    Update();
+    PlayAudioStream(stream);
+    playing = true;
+}
+
+void MusicStream::Pause()
+{
+    if (playing) {
+        PauseAudioStream(stream);
+        playing = false;
+    }
+}
+
+void MusicStream::SetVolume(float volume)
+{
+    this->volume = volume;
+    if (decoder != nullptr) {
+        SetAudioStreamVolume(stream, volume);
+    }
+}
+
+void MusicStream::SetTempo(float tempo)
+{
+    this->tempo = tempo;
+    if (stretch != nullptr) {
+        stretch->SetTempo(tempo);
+    }
+}
+
+void MusicStream::Update()
+{
+    if (decoder == nullptr) {
+        return;
+    }
+    uint32_t channels = decoder->mp3.channels;
+    bool rewound = false;
+    for (uint32_t free = fifo->Free(); free > 0;) {
+        uint32_t count = (uint32_t)drmp3_read_pcm_frames_f32(&decoder->mp3, std::min(free, decodeChunkFrames), decoded.data());
+        if (count == 0) {
+            // Loop; a file that gives nothing right after rewinding is given up on for this frame
+            if (rewound || !drmp3_seek_to_pcm_frame(&decoder->mp3, 0)) {
+                break;
+            }
+            rewound = true;
+            continue;
+        }
+        rewound = false;
+        if (channels == 1) {
+            for (uint32_t i = count; i-- > 0;) {
+                decoded[2 * i] = decoded[2 * i + 1] = decoded[i];
+            }
+        }
+        free -= fifo->Write(decoded.data(), count);
+    }
+}
+
+uint64_t MusicStream::Underruns() const
+{
+    return closedUnderruns + (stretch != nullptr ? stretch->Underruns() : 0);
+}
+
+uint64_t MusicStream::OverBudget() const
+{
+    return closedOverBudget + (stretch != nullptr ? stretch->OverBudget() : 0);
+}
+
+uint64_t MusicStream::Bytes() const
+{
+    if (decoder == nullptr) {
+        return 0;
+    }
+    return fifo->Bytes() + stretch->Bytes() + decoded.size() * sizeof(float);
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "raylib.h"
+#include "timestretch.h"
+
+struct Mp3Decoder;
+
+// The background music, played through a TimeStretch so it can speed up with the
+// pipes without changing pitch. Like raylib's own music streams the game thread
+// decodes a little ahead every frame, here into a FIFO; raylib's stream callback
+// stretches out of it on the audio thread and resamples the result to the device.
+// Only one can be open at a time, the callback has no user pointer.
+class MusicStream
+{
+public:
+    MusicStream();
+    ~MusicStream();
+    MusicStream(const MusicStream&) = delete;
+    MusicStream& operator=(const MusicStream&) = delete;
+
+    // Game thread. Replaces the open music, which keeps playing if it was; when
+    // the new one can't be decoded the old one stays
+    bool Open(const char* path);
+    bool Open(unsigned char* data, int dataSize);   // Takes ownership of LoadFileData bytes
+    void Close();
+
+    void Play();
+    void Pause();
+    bool IsPlaying() const { return playing; }
+    void SetVolume(float volume);
+    // Decodes until the FIFO is full, looping at the end
+    void Update();
+    // 1 plays as recorded, reaches the audio thread within a window
+    void SetTempo(float tempo);
+
+    // Counters summed over everything opened so far
+    uint64_t Underruns() const;
+    uint64_t OverBudget() const;
+    uint32_t PeakProcessNs() const { return stretch != nullptr ? stretch->PeakProcessNs() : 0; }
+    uint64_t Bytes() const;
+
+private:
+    bool Start(Mp3Decoder* opened, unsigned char* data);
+
+    Mp3Decoder* decoder;        // nullptr when closed
+    unsigned char* fileData;    // Backs a decoder opened from memory
+    AudioStream stream;
+    AudioFifo* fifo;
+    TimeStretch* stretch;
+    std::vector<float> decoded; // Decoder output before mono is widened to stereo
+    float volume;
+    float tempo;
+    bool playing;
+    uint64_t closedUnderruns;
+    uint64_t closedOverBudget;
+
+    const float fifoSeconds = 0.5f;         // Rides out game thread stalls of about fifoSeconds / tempo
+    const uint32_t decodeChunkFrames = 4096;
+};
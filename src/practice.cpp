@@ -0,0 +1,30 @@
+#include <algorithm>
+
+#include "practice.h"
+
+PracticeStart StartPractice(Simulation& simulation, Autopilot& pilot, uint32_t seed, uint16_t flags,
+    float speed, uint32_t pipeIndex, uint32_t maxTicks)
+{
+    if (simulation.BuildPractice(seed, flags, speed, pipeIndex)) {
+        return PRACTICE_BUILT;
+    }
+
+    const SimConfig& config = simulation.Config();
+    speed = std::max(config.basePipeSpeed, std::min(config.maxSpeed, speed));
+    int score = pipeIndex == practiceAutoPipe ? 0 : (int)pipeIndex;
+
+    // The autopilot can still crash; a few seeds are plenty
+    const int attempts = 4;
+    for (int attempt = 0; attempt < attempts; attempt++) {
+        simulation.Reset(seed + (uint32_t)attempt, flags);
+        const SimState& state = simulation.State();
+        for (uint32_t tick = 0; tick < maxTicks && !state.gameOver; tick++) {
+            if (state.pipeSpeed >= speed && state.score >= score) {
+                return PRACTICE_FAST_FORWARDED;
+            }
+            simulation.Step(pilot.WantsFlap(state, config));
+        }
+    }
+    simulation.Reset(seed, flags);
+    return PRACTICE_FAILED;
+}
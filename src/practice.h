@@ -0,0 +1,19 @@
+#pragma once
+
+#include "autopilot.h"
+#include "simulation.h"
+
+// How StartPractice got the simulation to the requested point
+enum PracticeStart {
+    PRACTICE_BUILT = 0,         // Built directly by Simulation::BuildPractice
+    PRACTICE_FAST_FORWARDED,    // Flown there headless by the autopilot
+    PRACTICE_FAILED
+};
+
+// Puts the simulation at the requested pipe speed and upcoming pipe (practiceAutoPipe
+// for whatever that speed implies). The direct build is tried first; a pair it can't
+// build is reached by letting the autopilot fly a headless run until both are
+// reached, which lands on the nearest state a real run actually passes through.
+// maxTicks bounds each fast-forward attempt.
+PracticeStart StartPractice(Simulation& simulation, Autopilot& pilot, uint32_t seed, uint16_t flags,
+    float speed, uint32_t pipeIndex, uint32_t maxTicks = 30 * 60 * simTickRate);
@@ -0,0 +1,96 @@
+#include <algorithm>
+#include <cmath>
+
+#include "presenter.h"
+
+Presenter::Presenter()
+    : target{}, gameWidth(1), gameHeight(1), mode(PRESENT_FIT), renderScale(1.0f), dirty(true), scale(1.0f), viewport{}, recomputes(0)
+{
+}
+
+void Presenter::Init(int gameWidth, int gameHeight, PresentMode mode)
+{
+    this->gameWidth = gameWidth;
+    this->gameHeight = gameHeight;
+    this->mode = mode;
+    CreateTarget();
+    Recompute();
+}
+
+void Presenter::CreateTarget()
+{
+    target = LoadRenderTexture((int)std::lround(gameWidth * renderScale), (int)std::lround(gameHeight * renderScale));
+    SetMode(mode);
+}
+
+void Presenter::Shutdown()
+{
+    UnloadRenderTexture(target);
+    target = {};
+}
+
+void Presenter::SetMode(PresentMode mode)
+{
+    this->mode = mode;
+    // Whole-number scales map texels to exact pixel blocks, filtering would only blur them
+    SetTextureFilter(target.texture, mode == PRESENT_INTEGER ? TEXTURE_FILTER_POINT : TEXTURE_FILTER_BILINEAR);
+    dirty = true;
+}
+
+void Presenter::SetRenderScale(float renderScale)
+{
+    renderScale = std::max(0.25f, std::min(1.0f, renderScale));
+    if (renderScale == this->renderScale) {
+        return;
+    }
+    this->renderScale = renderScale;
+    if (target.id != 0) {
+        UnloadRenderTexture(target);
+        CreateTarget();
+    }
+}
+
+bool Presenter::Refresh()
+{
+    if (!dirty && !IsWindowResized()) {
+        return false;
+    }
+    Recompute();
+    return true;
+}
+
+void Presenter::Recompute()
+{
+    float screenWidth = (float)GetScreenWidth();
+    float screenHeight = (float)GetScreenHeight();
+    scale = std::min(screenWidth / gameWidth, screenHeight / gameHeight);
+    if (mode == PRESENT_INTEGER && scale >= 1.0f) {
+        scale = std::floor(scale);
+    }
+    if (scale <= 0.0f) {
+        scale = 1.0f;   // Minimized window
+    }
+
+    float width = gameWidth * scale;
+    float height = gameHeight * scale;
+    viewport = { std::floor((screenWidth - width) * 0.5f), std::floor((screenHeight - height) * 0.5f), width, height };
+    dirty = false;
+    recomputes++;
+}
+
+Vector2 Presenter::ScreenToGame(Vector2 point) const
+{
+    return { (point.x - viewport.x) / scale, (point.y - viewport.y) / scale };
+}
+
+Vector2 Presenter::GameToScreen(Vector2 point) const
+{
+    return { viewport.x + point.x * scale, viewport.y + point.y * scale };
+}
+
+void Presenter::Blit() const
+{
+    DrawTexturePro(target.texture,
+        { 0.0f, 0.0f, (float)target.texture.width, (float)-target.texture.height },
+        viewport, { 0, 0 }, 0.0f, WHITE);
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstdint>
+
+#include "raylib.h"
+
+enum PresentMode {
+    PRESENT_FIT = 0,        // Largest scale that fits, bilinear filtered
+    PRESENT_INTEGER         // Largest whole-number scale that fits, point filtered
+};
+
+// Owns the game-resolution render target and the transform that puts it on screen.
+// The scale, letterbox viewport and screen<->game mappings are cached and only
+// recomputed when the window reports a resize or the caller invalidates them (e.g.
+// after a fullscreen toggle), so input mapping, the UI pass and the final blit all
+// read the same numbers every frame.
+class Presenter
+{
+public:
+    Presenter();
+
+    // Needs the GL context
+    void Init(int gameWidth, int gameHeight, PresentMode mode);
+    void Shutdown();
+
+    // Once per frame; returns true if the transform was recomputed
+    bool Refresh();
+    void Invalidate() { dirty = true; }
+
+    void SetMode(PresentMode mode);
+    PresentMode Mode() const { return mode; }
+
+    // Resolution of the render target relative to the game resolution. Below 1 the
+    // scene is drawn through Camera() into a smaller target and upscaled by the blit.
+    void SetRenderScale(float renderScale);
+    float RenderScale() const { return renderScale; }
+    Camera2D Camera() const { return { { 0, 0 }, { 0, 0 }, 0.0f, renderScale }; }
+
+    float Scale() const { return scale; }
+    Rectangle Viewport() const { return viewport; }     // Letterboxed game area in screen pixels
+    Vector2 ScreenToGame(Vector2 point) const;
+    Vector2 GameToScreen(Vector2 point) const;
+    uint32_t Recomputes() const { return recomputes; }
+
+    RenderTexture2D Target() const { return target; }
+    // Draws the render target into the viewport, call inside BeginDrawing
+    void Blit() const;
+
+private:
+    void Recompute();
+    void CreateTarget();
+
+    RenderTexture2D target;
+    int gameWidth;
+    int gameHeight;
+    PresentMode mode;
+    float renderScale;
+    bool dirty;
+    float scale;
+    Rectangle viewport;
+    uint32_t recomputes;
+};
@@ -0,0 +1,138 @@
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <thread>
+
+#include "raylib.h"
+#include "rlgl.h"
+#include "qualitytier.h"
+#include "scenery.h"
+
+#ifndef HOVERCAT_VERSION
+#define HOVERCAT_VERSION "dev"
+#endif
+
+namespace
+{
+    const QualitySettings tiers[QUALITY_TIER_COUNT] = {
+        { 0.5f, 1u << SCENERY_HILLS, 60 },                                      // Low
+        { 1.0f, (1u << SCENERY_SKYLINE) | (1u << SCENERY_HILLS), 60 },          // Medium
+        { 1.0f, (1u << SCENERY_LAYER_COUNT) - 1, 144 },                         // High
+    };
+    const char* names[QUALITY_TIER_COUNT] = { "low", "medium", "high" };
+
+    // A high-tier frame has 6.9ms at 144 FPS; leave most of it for present,
+    // the UI pass and everything the benchmark doesn't cover
+    const float highTierMaxMs = 2.0f;
+    const float mediumTierMaxMs = 6.0f;
+
+    std::string CpuModel()
+    {
+#if defined(__linux__)
+        std::ifstream file("/proc/cpuinfo");
+        std::string line;
+        while (std::getline(file, line)) {
+            if (line.compare(0, 10, "model name") == 0) {
+                size_t colon = line.find(':');
+                return colon != std::string::npos ? line.substr(colon + 2) : line;
+            }
+        }
+#elif defined(_WIN32)
+        const char* identifier = getenv("PROCESSOR_IDENTIFIER");
+        if (identifier != nullptr) {
+            return identifier;
+        }
+#endif
+        return "unknown";
+    }
+}
+
+const QualitySettings& GetQualitySettings(QualityTier tier)
+{
+    return tiers[tier];
+}
+
+const char* QualityTierName(QualityTier tier)
+{
+    return names[tier];
+}
+
+bool ParseQualityTier(const char* name, QualityTier& tier)
+{
+    for (int i = 0; i < QUALITY_TIER_COUNT; i++) {
+        if (strcmp(name, names[i]) == 0) {
+            tier = (QualityTier)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+QualityTier PickQualityTier(float frameMs)
+{
+    if (frameMs <= highTierMaxMs) {
+        return QUALITY_HIGH;
+    }
+    return frameMs <= mediumTierMaxMs ? QUALITY_MEDIUM : QUALITY_LOW;
+}
+
+std::string QualityHardwareKey()
+{
+    // The GL renderer string isn't exposed by raylib; the GL version and the
+    // monitor catch GPU and display swaps
+    int monitor = GetCurrentMonitor();
+    return CpuModel() + "|" + std::to_string(std::thread::hardware_concurrency()) + " threads|GL "
+        + std::to_string(rlGetVersion()) + "|" + std::to_string(GetMonitorWidth(monitor)) + "x"
+        + std::to_string(GetMonitorHeight(monitor));
+}
+
+std::string QualityBuildKey()
+{
+    std::string key = HOVERCAT_VERSION;
+#ifdef HOVERCAT_EXECUTABLE
+    // Any rebuild touches the executable
+    std::string executable = std::string(GetApplicationDirectory()) + HOVERCAT_EXECUTABLE;
+    key += "|" + std::to_string(GetFileModTime(executable.c_str()));
+#endif
+    return key;
+}
+
+bool LoadQualityCache(const char* path, QualityCache& cache)
+{
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        return false;
+    }
+    std::string line;
+    bool haveTier = false;
+    cache.frameMs = 0.0f;
+    while (std::getline(file, line)) {
+        size_t equals = line.find('=');
+        if (equals == std::string::npos) {
+            continue;
+        }
+        std::string name = line.substr(0, equals);
+        std::string value = line.substr(equals + 1);
+        if (name == "hardware") {
+            cache.hardware = value;
+        } else if (name == "build") {
+            cache.build = value;
+        } else if (name == "tier") {
+            haveTier = ParseQualityTier(value.c_str(), cache.tier);
+        } else if (name == "frame_ms") {
+            cache.frameMs = (float)atof(value.c_str());
+        }
+    }
+    return haveTier;
+}
+
+void SaveQualityCache(const char* path, const QualityCache& cache)
+{
+    std::ofstream file(path);
+    if (file.is_open()) {
+        file << "hardware=" << cache.hardware << "\n";
+        file << "build=" << cache.build << "\n";
+        file << "tier=" << QualityTierName(cache.tier) << "\n";
+        file << "frame_ms=" << cache.frameMs << "\n";
+    }
+}
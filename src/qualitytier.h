@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// Quality tiers picked from a short benchmark on the first launch, instead of
+// guessing from the platform. The result is cached next to the high score and only
+// re-measured when the hardware or the executable changes.
+enum QualityTier {
+    QUALITY_LOW = 0,
+    QUALITY_MEDIUM,
+    QUALITY_HIGH,
+    QUALITY_TIER_COUNT
+};
+
+struct QualitySettings {
+    float renderScale;          // Render target size relative to the 960x540 game screen
+    uint32_t sceneryLayers;     // SceneryStreamer layer mask
+    int targetFps;
+};
+
+const QualitySettings& GetQualitySettings(QualityTier tier);
+const char* QualityTierName(QualityTier tier);
+bool ParseQualityTier(const char* name, QualityTier& tier);
+
+// frameMs is the benchmarked cost of one high-tier frame: the offscreen scene draw
+// plus the simulation ticks that fall into it
+QualityTier PickQualityTier(float frameMs);
+
+// A cached tier is trusted only while both keys still match
+std::string QualityHardwareKey();
+std::string QualityBuildKey();
+
+struct QualityCache {
+    std::string hardware;
+    std::string build;
+    QualityTier tier;
+    float frameMs;
+};
+
+bool LoadQualityCache(const char* path, QualityCache& cache);
+void SaveQualityCache(const char* path, const QualityCache& cache);
@@ -0,0 +1,387 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#include "framestepper.h"
+#include "replay.h"
+
+namespace
+{
+    template <typename T>
+    void Put(std::vector<uint8_t>& out, const T& value)
+    {
+        const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&value);
+        out.insert(out.end(), bytes, bytes + sizeof(value));
+    }
+
+    // Bounds-checked reads; ok turns false on the first overrun
+    struct Reader {
+        const uint8_t* data;
+        size_t size;
+        size_t position;
+        bool ok;
+
+        template <typename T>
+        T Get()
+        {
+            T value = T();
+            if (position + sizeof(value) > size) {
+                ok = false;
+                return value;
+            }
+            memcpy(&value, data + position, sizeof(value));
+            position += sizeof(value);
+            return value;
+        }
+    };
+
+    void PutPipe(std::vector<uint8_t>& out, const Pipe& pipe)
+    {
+        Put(out, pipe.x);
+        Put(out, pipe.gapCenter);
+        Put(out, pipe.gapDelta);
+        Put(out, (uint8_t)(pipe.scored ? 1 : 0));
+    }
+
+    Pipe GetPipe(Reader& reader)
+    {
+        Pipe pipe;
+        pipe.x = reader.Get<float>();
+        pipe.gapCenter = reader.Get<float>();
+        pipe.gapDelta = reader.Get<float>();
+        pipe.scored = reader.Get<uint8_t>() != 0;
+        return pipe;
+    }
+
+    // Every SimState field, packed: 66 bytes plus 13 per pipe
+    void EncodeState(const SimState& state, std::vector<uint8_t>& out)
+    {
+        Put(out, state.tick);
+        Put(out, state.rngState);
+        Put(out, state.playerX);
+        Put(out, state.playerY);
+        Put(out, state.playerVelocity);
+        Put(out, state.playerEyesClosedTimer);
+        Put(out, state.pipeSpeed);
+        Put(out, state.pipeSpawnTimer);
+        Put(out, state.pipeSpawnInterval);
+        Put(out, (int32_t)state.score);
+        Put(out, state.pipesSpawned);
+        Put(out, (uint8_t)(state.gameOver ? 1 : 0));
+        Put(out, (uint8_t)state.deathCause);
+        PutPipe(out, state.fatalPipe);
+        Put(out, state.nextPipeDistance);
+        Put(out, (uint8_t)(state.gapSourceEnded ? 1 : 0));
+        Put(out, (uint16_t)state.pipes.size());
+        for (const Pipe& pipe : state.pipes) {
+            PutPipe(out, pipe);
+        }
+    }
+
+    bool DecodeState(Reader& reader, SimState& state)
+    {
+        state.tick = reader.Get<uint32_t>();
+        state.rngState = reader.Get<uint32_t>();
+        state.playerX = reader.Get<float>();
+        state.playerY = reader.Get<float>();
+        state.playerVelocity = reader.Get<float>();
+        state.playerEyesClosedTimer = reader.Get<float>();
+        state.pipeSpeed = reader.Get<float>();
+        state.pipeSpawnTimer = reader.Get<float>();
+        state.pipeSpawnInterval = reader.Get<float>();
+        state.score = reader.Get<int32_t>();
+        state.pipesSpawned = reader.Get<uint32_t>();
+        state.gameOver = reader.Get<uint8_t>() != 0;
+        state.deathCause = (RunDeathCause)reader.Get<uint8_t>();
+        state.fatalPipe = GetPipe(reader);
+        state.nextPipeDistance = reader.Get<float>();
+        state.gapSourceEnded = reader.Get<uint8_t>() != 0;
+        uint16_t pipeCount = reader.Get<uint16_t>();
+        state.pipes.clear();
+        for (uint16_t i = 0; i < pipeCount && reader.ok; i++) {
+            state.pipes.push_back(GetPipe(reader));
+        }
+        return reader.ok;
+    }
+
+    // Bytes between the read position and the end of the file
+    uint64_t BytesLeft(FILE* file)
+    {
+        long position = ftell(file);
+        if (position < 0 || fseek(file, 0, SEEK_END) != 0) {
+            return 0;
+        }
+        long end = ftell(file);
+        fseek(file, position, SEEK_SET);
+        return end > position ? (uint64_t)(end - position) : 0;
+    }
+}
+
+Replay::Replay()
+    : seed(1), resetFlags(0), tickCount(0), finalHash(0), finalScore(0), keyframeInterval(replayKeyframeInterval)
+{
+}
+
+void Replay::Begin(uint32_t seed, uint16_t resetFlags)
+{
+    this->seed = seed;
+    this->resetFlags = resetFlags;
+    tickCount = 0;
+    finalHash = 0;
+    finalScore = 0;
+    flapTicks.clear();
+    keyframeInterval = replayKeyframeInterval;
+    keyframes.clear();
+    keyframeData.clear();
+}
+
+void Replay::Rewind(uint32_t tick)
+{
+    flapTicks.erase(std::upper_bound(flapTicks.begin(), flapTicks.end(), tick), flapTicks.end());
+    while (!keyframes.empty() && keyframes.back().tick > tick) {
+        keyframeData.resize(keyframes.back().offset);
+        keyframes.pop_back();
+    }
+}
+
+uint32_t Replay::RecordStep(Simulation& simulation, FrameStepper& stepper, bool flap)
+{
+    // Rewind first, it would also forget a flap recorded for the coming tick
+    if (!stepper.AtNewest()) {
+        Rewind(simulation.State().tick);
+    }
+    if (flap) {
+        RecordFlap(simulation.State().tick + 1);
+    }
+    uint32_t events = stepper.Advance(simulation, flap);
+    RecordKeyframe(simulation);
+    return events;
+}
+
+bool Replay::FlapsOn(uint32_t tick) const
+{
+    return std::binary_search(flapTicks.begin(), flapTicks.end(), tick);
+}
+
+void Replay::RecordKeyframe(const Simulation& simulation)
+{
+    uint32_t tick = simulation.State().tick;
+    if (keyframeInterval == 0 || tick == 0 || tick % keyframeInterval != 0
+        || (!keyframes.empty() && keyframes.back().tick >= tick)) {
+        return;
+    }
+    keyframes.push_back({ tick, (uint32_t)keyframeData.size(), simulation.Hash() });
+    EncodeState(simulation.State(), keyframeData);
+}
+
+void Replay::Finish(const Simulation& simulation)
+{
+    tickCount = simulation.State().tick;
+    finalHash = simulation.Hash();
+    finalScore = simulation.State().score;
+}
+
+int Replay::KeyframeAt(uint32_t tick) const
+{
+    // Keyframes sit on every interval, so the index follows from the tick
+    if (keyframeInterval == 0 || keyframes.empty()) {
+        return -1;
+    }
+    return (int)std::min((size_t)(tick / keyframeInterval), keyframes.size()) - 1;
+}
+
+bool Replay::RestoreKeyframe(size_t index, Simulation& simulation) const
+{
+    simulation.Reset(seed, resetFlags);
+    if (index >= keyframes.size()) {
+        return false;
+    }
+    const ReplayKeyframe& keyframe = keyframes[index];
+    size_t end = index + 1 < keyframes.size() ? keyframes[index + 1].offset : keyframeData.size();
+    Reader reader = { keyframeData.data(), std::min(end, keyframeData.size()), keyframe.offset, true };
+    SimState& state = simulation.MutableState();
+    if (DecodeState(reader, state) && state.tick == keyframe.tick && simulation.Hash() == keyframe.hash) {
+        return true;
+    }
+    simulation.Reset(seed, resetFlags);
+    return false;
+}
+
+void Replay::Encode(std::vector<uint8_t>& out) const
+{
+    ReplayHeader header = {};
+    header.magic = replayMagic;
+    header.version = replayVersion;
+    header.resetFlags = resetFlags;
+    header.seed = seed;
+    header.tickRate = simTickRate;
+    header.tickCount = tickCount;
+    header.flapCount = (uint32_t)flapTicks.size();
+    header.finalHash = finalHash;
+    header.finalScore = finalScore;
+    header.keyframeInterval = keyframeInterval;
+    size_t flapBytes = flapTicks.size() * sizeof(uint32_t);
+    size_t indexBytes = keyframes.size() * sizeof(ReplayKeyframe);
+    out.resize(sizeof(header) + flapBytes + sizeof(uint32_t) + indexBytes);
+    uint8_t* write = out.data();
+    memcpy(write, &header, sizeof(header));
+    write += sizeof(header);
+    if (!flapTicks.empty()) {
+        memcpy(write, flapTicks.data(), flapBytes);
+        write += flapBytes;
+    }
+    uint32_t keyframeCount = (uint32_t)keyframes.size();
+    memcpy(write, &keyframeCount, sizeof(keyframeCount));
+    write += sizeof(keyframeCount);
+    if (!keyframes.empty()) {
+        memcpy(write, keyframes.data(), indexBytes);
+    }
+    out.insert(out.end(), keyframeData.begin(), keyframeData.end());
+}
+
+bool Replay::Save(const std::string& path) const
+{
+    FILE* file = fopen(path.c_str(), "wb");
+    if (file == nullptr) {
+        return false;
+    }
+    std::vector<uint8_t> bytes;
+    Encode(bytes);
+    bool ok = fwrite(bytes.data(), 1, bytes.size(), file) == bytes.size();
+    fclose(file);
+    return ok;
+}
+
+bool Replay::Load(const std::string& path)
+{
+    FILE* file = fopen(path.c_str(), "rb");
+    if (file == nullptr) {
+        return false;
+    }
+    ReplayHeader header;
+    bool ok = fread(&header, sizeof(header), 1, file) == 1
+        && header.magic == replayMagic
+        && (header.version == 1 || header.version == replayVersion)
+        && header.tickRate == (uint32_t)simTickRate;
+    if (ok) {
+        seed = header.seed;
+        resetFlags = header.resetFlags;
+        tickCount = header.tickCount;
+        finalHash = header.finalHash;
+        finalScore = header.finalScore;
+        flapTicks.clear();
+        keyframes.clear();
+        keyframeData.clear();
+        // A corrupt count mustn't size the allocation, the file has to hold the ticks
+        ok = (uint64_t)header.flapCount * sizeof(uint32_t) <= BytesLeft(file);
+        if (ok && header.flapCount > 0) {
+            flapTicks.resize(header.flapCount);
+            ok = fread(flapTicks.data(), sizeof(uint32_t), flapTicks.size(), file) == flapTicks.size();
+        }
+        // ReplayPlayer and FlapsOn walk them in order
+        for (size_t i = 1; ok && i < flapTicks.size(); i++) {
+            ok = flapTicks[i] > flapTicks[i - 1];
+        }
+        keyframeInterval = header.version == 1 ? 0 : header.keyframeInterval;
+    }
+    if (ok && header.version >= 2) {
+        uint32_t keyframeCount = 0;
+        ok = fread(&keyframeCount, sizeof(keyframeCount), 1, file) == 1;
+        // One keyframe per interval of the run, and the file has to hold their index
+        uint32_t maxKeyframes = keyframeInterval > 0 ? tickCount / keyframeInterval : 0;
+        ok = ok && keyframeCount <= maxKeyframes && (uint64_t)keyframeCount * sizeof(ReplayKeyframe) <= BytesLeft(file);
+        if (ok && keyframeCount > 0) {
+            keyframes.resize(keyframeCount);
+            ok = fread(keyframes.data(), sizeof(ReplayKeyframe), keyframes.size(), file) == keyframes.size();
+        }
+        if (ok) {
+            // The data runs to the end of the file
+            uint8_t buffer[4096];
+            size_t read;
+            while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+                keyframeData.insert(keyframeData.end(), buffer, buffer + read);
+            }
+        }
+        // KeyframeAt relies on one keyframe per interval with ascending offsets
+        for (size_t i = 0; ok && i < keyframes.size(); i++) {
+            ok = keyframeInterval > 0
+                && keyframes[i].tick == (uint32_t)(i + 1) * keyframeInterval
+                && keyframes[i].offset < keyframeData.size()
+                && (i == 0 || keyframes[i].offset > keyframes[i - 1].offset);
+        }
+    }
+    fclose(file);
+    return ok;
+}
+
+ReplayPlayer::ReplayPlayer(const Replay& replay, Simulation& simulation)
+    : replay(replay), simulation(simulation), nextFlap(0), nextKeyframe(0), keyframeMismatches(0)
+{
+    simulation.Reset(replay.seed, replay.resetFlags);
+}
+
+uint32_t ReplayPlayer::Step()
+{
+    if (Finished()) {
+        return 0;
+    }
+    uint32_t tick = simulation.State().tick + 1;
+    bool flap = nextFlap < replay.flapTicks.size() && replay.flapTicks[nextFlap] == tick;
+    if (flap) {
+        nextFlap++;
+    }
+    uint32_t events = simulation.Step(flap);
+    if (nextKeyframe < replay.keyframes.size() && replay.keyframes[nextKeyframe].tick == tick) {
+        if (simulation.Hash() != replay.keyframes[nextKeyframe].hash) {
+            keyframeMismatches++;
+        }
+        nextKeyframe++;
+    }
+    return events;
+}
+
+bool ReplayPlayer::Finished() const
+{
+    return simulation.State().tick >= replay.tickCount || simulation.State().gameOver;
+}
+
+bool ReplayPlayer::Seek(uint32_t tick)
+{
+    tick = std::min(tick, replay.tickCount);
+    uint32_t current = simulation.State().tick;
+    int keyframe = replay.KeyframeAt(tick);
+    bool ok = true;
+    if (tick < current || (keyframe >= 0 && replay.keyframes[keyframe].tick > current)) {
+        while (keyframe >= 0 && !replay.RestoreKeyframe((size_t)keyframe, simulation)) {
+            keyframeMismatches++;
+            ok = false;
+            keyframe--;
+        }
+        if (keyframe < 0) {
+            simulation.Reset(replay.seed, replay.resetFlags);
+        }
+        SyncCursors();
+    }
+    while (simulation.State().tick < tick && !Finished()) {
+        Step();
+    }
+    return ok;
+}
+
+void ReplayPlayer::SyncCursors()
+{
+    uint32_t tick = simulation.State().tick;
+    nextFlap = std::upper_bound(replay.flapTicks.begin(), replay.flapTicks.end(), tick) - replay.flapTicks.begin();
+    nextKeyframe = 0;
+    while (nextKeyframe < replay.keyframes.size() && replay.keyframes[nextKeyframe].tick <= tick) {
+        nextKeyframe++;
+    }
+}
+
+bool ReplayPlayer::Verify() const
+{
+    return simulation.State().tick == replay.tickCount
+        && simulation.Hash() == replay.finalHash
+        && simulation.State().score == replay.finalScore
+        && keyframeMismatches == 0;
+}
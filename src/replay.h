@@ -0,0 +1,116 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "simulation.h"
+
+class FrameStepper;
+
+// Replay: the seed, reset flags and the ticks on which the player flapped. Together
+// with the deterministic Simulation this reproduces a run exactly; the final hash and
+// score let playback verify it arrived at the same state. Version 2 files also carry a
+// keyframe of the full state every keyframeInterval ticks plus a seek index, so
+// playback can start anywhere by restoring the keyframe before it and simulating at
+// most one interval forward. Version 1 files (inputs only) still load.
+
+struct ReplayHeader {
+    uint32_t magic;         // replayMagic
+    uint16_t version;
+    uint16_t resetFlags;    // SimResetFlags
+    uint32_t seed;
+    uint32_t tickRate;      // Must match simTickRate
+    uint32_t tickCount;     // Ticks simulated until the run ended
+    uint32_t flapCount;
+    uint64_t finalHash;     // Simulation::Hash() after the last tick
+    int32_t finalScore;
+    uint32_t keyframeInterval;  // Ticks between keyframes, 0 in version 1
+};
+
+static_assert(sizeof(ReplayHeader) == 40, "ReplayHeader must stay a fixed 40 bytes");
+
+// Seek index entry. The file stores the header, the flap ticks, the keyframe count,
+// the index and then the keyframe data, each keyframe being a packed SimState.
+struct ReplayKeyframe {
+    uint32_t tick;          // A multiple of keyframeInterval
+    uint32_t offset;        // Start of the state in Replay::keyframeData
+    uint64_t hash;          // Simulation::Hash() at tick
+};
+
+static_assert(sizeof(ReplayKeyframe) == 16, "ReplayKeyframe is written as is");
+
+const uint32_t replayMagic = 0x504B5248; // "HRKP"
+const uint16_t replayVersion = 2;
+const uint32_t replayKeyframeInterval = 5 * simTickRate;
+
+class Replay
+{
+public:
+    Replay();
+
+    void Begin(uint32_t seed, uint16_t resetFlags);
+    void RecordFlap(uint32_t tick) { flapTicks.push_back(tick); }
+    void Rewind(uint32_t tick);         // Forget flaps after tick, for runs stepped back in the debugger
+    // Runs and records one tick through the stepper, dropping the old future first
+    // when it was stepped back; returns the simulation events
+    uint32_t RecordStep(Simulation& simulation, FrameStepper& stepper, bool flap);
+    bool FlapsOn(uint32_t tick) const;
+    // Call after every tick; keeps the state when the tick is a keyframe's
+    void RecordKeyframe(const Simulation& simulation);
+    void Finish(const Simulation& simulation);
+
+    // Last keyframe at or before tick, -1 if there is none
+    int KeyframeAt(uint32_t tick) const;
+    // Resets simulation to the keyframe's state. Returns false, leaving the simulation
+    // reset to the run's start, when the state doesn't decode or match its hash.
+    bool RestoreKeyframe(size_t index, Simulation& simulation) const;
+
+    // The file Save writes
+    void Encode(std::vector<uint8_t>& out) const;
+    bool Save(const std::string& path) const;
+    bool Load(const std::string& path);
+
+    uint32_t seed;
+    uint16_t resetFlags;
+    uint32_t tickCount;
+    uint64_t finalHash;
+    int32_t finalScore;
+    std::vector<uint32_t> flapTicks;  // Tick numbers (Simulation tick after the step) with a flap, ascending
+    uint32_t keyframeInterval;
+    std::vector<ReplayKeyframe> keyframes;    // Ascending, one per interval from the first
+    std::vector<uint8_t> keyframeData;
+};
+
+// Feeds a replay's inputs into a Simulation one tick at a time
+class ReplayPlayer
+{
+public:
+    ReplayPlayer(const Replay& replay, Simulation& simulation);
+
+    // Steps one tick; returns the simulation events, or 0 once the replay has ended.
+    // Ticks with a keyframe check the simulation against its hash.
+    uint32_t Step();
+    bool Finished() const;
+
+    // Goes to tick (at most the replay's end): forward from the current state when no
+    // keyframe lies in between, otherwise from the last keyframe at or before tick.
+    // A keyframe that fails its hash check counts as a mismatch and the one before it
+    // is used instead, down to the start of the run; returns false if that happened.
+    bool Seek(uint32_t tick);
+
+    // True when the simulation reached the recorded end state and every keyframe
+    // passed on the way matched
+    bool Verify() const;
+    uint32_t KeyframeMismatches() const { return keyframeMismatches; }
+
+private:
+    // Points the flap and keyframe cursors past the simulation's current tick
+    void SyncCursors();
+
+    const Replay& replay;
+    Simulation& simulation;
+    size_t nextFlap;
+    size_t nextKeyframe;
+    uint32_t keyframeMismatches;
+};
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstdint>
+
+// Fixed-size record appended to runs.bin every time a run ends.
+// Kept free of raylib types so offline tools can read it without linking the game.
+struct RunRecord {
+    uint32_t magic;        // runRecordMagic, readers skip ahead to the next one past a torn or corrupt record
+    uint32_t pipeIndex;    // Pipes passed before dying (the pipe the player died at)
+    float playerY;         // Player center at the moment of death, game-space pixels
+    float pipeSpeed;       // Pipe speed at the moment of death
+    float gapDelta;        // Gap center change from the previous pipe to the fatal one
+    float gapCenter;       // Gap center of the fatal pipe
+    uint32_t cause;        // RunDeathCause
+    uint32_t reserved;
+};
+
+static_assert(sizeof(RunRecord) == 32, "RunRecord must stay a fixed 32 bytes");
+
+const uint32_t runRecordMagic = 0x4E524B48; // "HKRN"
+
+enum RunDeathCause : uint32_t {
+    DEATH_CAUSE_PIPE_TOP = 0,
+    DEATH_CAUSE_PIPE_BOTTOM = 1,
+    DEATH_CAUSE_CEILING = 2,
+    DEATH_CAUSE_FLOOR = 3,
+};
@@ -0,0 +1,281 @@
+#include "sampler.h"
+
+#if defined(__linux__) && !defined(__EMSCRIPTEN__)
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <cxxabi.h>
+#include <dlfcn.h>
+#include <execinfo.h>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+// glibc only spells the thread id field of sigevent out in newer headers
+#ifndef sigev_notify_thread_id
+#define sigev_notify_thread_id _sigev_un._tid
+#endif
+
+namespace
+{
+    const int maxDepth = 48;
+    const uint32_t maxSamples = 1 << 15;   // ~33s of CPU time at 1kHz, 12MB
+    const int skippedFrames = 2;           // Signal handler and the kernel trampoline
+
+    struct Sample {
+        int depth;
+        void* frames[maxDepth];
+    };
+
+    Sample* samples = nullptr;
+    std::atomic<uint32_t> sampleCount(0);
+    std::atomic<uint32_t> droppedSamples(0);
+    std::atomic<bool> capturing(false);
+    std::atomic<bool> gameplayActive(false);
+    std::atomic<bool> running(false);
+    pthread_t profiledThread;
+    timer_t profilingTimer;
+    struct sigaction previousAction;
+    std::string outputPath;
+
+    void OnProfilingSignal(int, siginfo_t*, void*)
+    {
+        if (!capturing.load(std::memory_order_relaxed) || !gameplayActive.load(std::memory_order_relaxed)) {
+            return;
+        }
+        // The timer is aimed at the profiled thread, but a SIGPROF sent by anything else may land anywhere
+        if (!pthread_equal(pthread_self(), profiledThread)) {
+            return;
+        }
+
+        int savedErrno = errno;
+        uint32_t slot = sampleCount.fetch_add(1, std::memory_order_relaxed);
+        if (slot < maxSamples) {
+            samples[slot].depth = backtrace(samples[slot].frames, maxDepth);
+        } else {
+            droppedSamples.fetch_add(1, std::memory_order_relaxed);
+        }
+        errno = savedErrno;
+    }
+
+    std::string Symbolise(void* address, std::map<void*, std::string>& cache)
+    {
+        auto found = cache.find(address);
+        if (found != cache.end()) {
+            return found->second;
+        }
+
+        // Return addresses point past the call, step back into the calling instruction
+        void* lookup = (char*)address - 1;
+        std::string name;
+        Dl_info info;
+        memset(&info, 0, sizeof(info));
+        bool resolved = dladdr(lookup, &info) != 0;
+        if (resolved && info.dli_sname != nullptr) {
+            int status = 0;
+            char* demangled = abi::__cxa_demangle(info.dli_sname, nullptr, nullptr, &status);
+            name = (status == 0 && demangled != nullptr) ? demangled : info.dli_sname;
+            free(demangled);
+        } else if (resolved && info.dli_fname != nullptr) {
+            // No symbol (static or stripped build): module+offset, resolvable with addr2line
+            const char* module = strrchr(info.dli_fname, '/');
+            char buffer[256];
+            snprintf(buffer, sizeof(buffer), "%s+0x%lx", module ? module + 1 : info.dli_fname,
+                (unsigned long)((char*)lookup - (char*)info.dli_fbase));
+            name = buffer;
+        } else {
+            char buffer[32];
+            snprintf(buffer, sizeof(buffer), "0x%lx", (unsigned long)lookup);
+            name = buffer;
+        }
+
+        // ';' separates frames in the folded format
+        for (char& c : name) {
+            if (c == ';') {
+                c = ':';
+            }
+        }
+        cache[address] = name;
+        return name;
+    }
+
+    void WriteFoldedStacks()
+    {
+        uint32_t count = std::min(sampleCount.load(), maxSamples);
+        std::map<void*, std::string> symbolCache;
+        std::map<std::string, uint32_t> folded;
+
+        for (uint32_t i = 0; i < count; i++) {
+            const Sample& sample = samples[i];
+            std::string stack;
+            // backtrace() is leaf first, folded stacks are root first
+            for (int frame = sample.depth - 1; frame >= skippedFrames; frame--) {
+                if (!stack.empty()) {
+                    stack += ';';
+                }
+                stack += Symbolise(sample.frames[frame], symbolCache);
+            }
+            if (!stack.empty()) {
+                folded[stack]++;
+            }
+        }
+
+        FILE* file = fopen(outputPath.c_str(), "w");
+        if (file == nullptr) {
+            fprintf(stderr, "SAMPLER: cannot write %s\n", outputPath.c_str());
+            return;
+        }
+        for (const auto& entry : folded) {
+            fprintf(file, "%s %u\n", entry.first.c_str(), entry.second);
+        }
+        fclose(file);
+    }
+}
+
+namespace SamplingProfiler
+{
+    bool StartFromEnvironment()
+    {
+        return StartFromSetting(getenv("HOVERCAT_PROFILE"));
+    }
+
+    bool StartFromSetting(const char* setting)
+    {
+        if (setting == nullptr || setting[0] == '\0') {
+            return false;
+        }
+        std::string path = setting;
+        int frequency = 997;    // Prime, so sampling doesn't lock onto the frame rate
+        size_t colon = path.rfind(':');
+        if (colon != std::string::npos && atoi(path.c_str() + colon + 1) > 0) {
+            frequency = atoi(path.c_str() + colon + 1);
+            path.resize(colon);
+        }
+        return Start(path.c_str(), frequency);
+    }
+
+    bool Start(const char* path, int frequencyHz)
+    {
+        if (running.load() || frequencyHz <= 0) {
+            return false;
+        }
+
+        if (samples == nullptr) {
+            samples = new Sample[maxSamples];
+        }
+        sampleCount.store(0);
+        droppedSamples.store(0);
+        outputPath = path;
+        profiledThread = pthread_self();
+
+        // The first backtrace() call may load libgcc, never let that happen inside the handler
+        void* warmup[4];
+        backtrace(warmup, 4);
+
+        struct sigaction action;
+        memset(&action, 0, sizeof(action));
+        action.sa_sigaction = OnProfilingSignal;
+        action.sa_flags = SA_SIGINFO | SA_RESTART;
+        sigemptyset(&action.sa_mask);
+        if (sigaction(SIGPROF, &action, &previousAction) != 0) {
+            return false;
+        }
+
+        // Counts only this thread's CPU time and signals only this thread, so the rate
+        // holds whatever the audio, worker and writer threads are doing
+        struct sigevent event;
+        memset(&event, 0, sizeof(event));
+        event.sigev_notify = SIGEV_THREAD_ID;
+        event.sigev_signo = SIGPROF;
+        event.sigev_notify_thread_id = (pid_t)syscall(SYS_gettid);
+        if (timer_create(CLOCK_THREAD_CPUTIME_ID, &event, &profilingTimer) != 0) {
+            sigaction(SIGPROF, &previousAction, nullptr);
+            return false;
+        }
+        struct itimerspec interval;
+        interval.it_interval.tv_sec = 0;
+        interval.it_interval.tv_nsec = 1000000000L / frequencyHz;
+        interval.it_value = interval.it_interval;
+        if (timer_settime(profilingTimer, 0, &interval, nullptr) != 0) {
+            timer_delete(profilingTimer);
+            sigaction(SIGPROF, &previousAction, nullptr);
+            return false;
+        }
+
+        capturing.store(true);
+        running.store(true);
+        return true;
+    }
+
+    void Stop()
+    {
+        if (!running.exchange(false)) {
+            return;
+        }
+        timer_delete(profilingTimer);
+        sigaction(SIGPROF, &previousAction, nullptr);
+        capturing.store(false);
+
+        WriteFoldedStacks();
+        fprintf(stderr, "SAMPLER: %u samples (%u dropped) written to %s\n",
+            std::min(sampleCount.load(), maxSamples), droppedSamples.load(), outputPath.c_str());
+    }
+
+    bool IsRunning()
+    {
+        return running.load(std::memory_order_relaxed);
+    }
+
+    void SetCapturing(bool value)
+    {
+        capturing.store(value && running.load(), std::memory_order_relaxed);
+    }
+
+    bool IsCapturing()
+    {
+        return capturing.load(std::memory_order_relaxed);
+    }
+
+    void SetGameplayActive(bool active)
+    {
+        gameplayActive.store(active, std::memory_order_relaxed);
+    }
+
+    uint32_t SampleCount()
+    {
+        return std::min(sampleCount.load(std::memory_order_relaxed), maxSamples);
+    }
+
+    uint32_t DroppedSamples()
+    {
+        return droppedSamples.load(std::memory_order_relaxed);
+    }
+}
+
+#else
+
+namespace SamplingProfiler
+{
+    bool StartFromEnvironment() { return false; }
+    bool StartFromSetting(const char*) { return false; }
+    bool Start(const char*, int) { return false; }
+    void Stop() {}
+    bool IsRunning() { return false; }
+    void SetCapturing(bool) {}
+    bool IsCapturing() { return false; }
+    void SetGameplayActive(bool) {}
+    uint32_t SampleCount() { return 0; }
+    uint32_t DroppedSamples() { return 0; }
+}
+
+#endif
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstdint>
+
+// Opt-in sampling profiler (Linux only, a no-op elsewhere). A timer on the profiled
+// thread's own CPU clock sends SIGPROF to that thread only, so the sample rate is the
+// requested one whatever the other threads do. The handler captures the stack into a
+// preallocated lock-free buffer; the samples are symbolised with dladdr once profiling
+// stops and written as folded stacks ("main;Game::Update;Game::Draw 42"), ready for
+// flamegraph.pl or speedscope.
+//
+// Samples are only kept while capture is enabled and the profiled thread is inside
+// a gameplay scope, so menus and pauses don't dilute the profile.
+namespace SamplingProfiler
+{
+    // Reads HOVERCAT_PROFILE=<output.folded>[:<hz>]; returns false when unset or unsupported
+    bool StartFromEnvironment();
+    // The same <output.folded>[:<hz>] setting, for the headless tools' --profile
+    bool StartFromSetting(const char* setting);
+
+    // Profiles the calling thread; must be paired with Stop() on the same thread
+    bool Start(const char* outputPath, int frequencyHz);
+
+    // Disarms the timer, symbolises the samples and writes the folded stacks
+    void Stop();
+
+    bool IsRunning();
+
+    // Hotkey-controlled master switch, on by default after Start()
+    void SetCapturing(bool capturing);
+    bool IsCapturing();
+
+    // Set by the game every frame: true while gameplay (or a headless run) is simulating
+    void SetGameplayActive(bool active);
+
+    uint32_t SampleCount();
+    uint32_t DroppedSamples();
+}
@@ -0,0 +1,217 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "scenery.h"
+
+namespace
+{
+    const SceneryLayerInfo layers[SCENERY_LAYER_COUNT] = {
+        { 0.25f, 20, 200 },     // Clouds
+        { 0.55f, 200, 260 },    // Skyline
+        { 1.00f, 330, 210 },    // Hills
+    };
+
+    uint32_t Hash(uint32_t seed, int64_t a, uint32_t b = 0)
+    {
+        uint64_t x = (uint64_t)a * 0x9E3779B97F4A7C15ull ^ ((uint64_t)seed << 32 | b);
+        x ^= x >> 30;
+        x *= 0xBF58476D1CE4E5B9ull;
+        x ^= x >> 27;
+        x *= 0x94D049BB133111EBull;
+        x ^= x >> 31;
+        return (uint32_t)x;
+    }
+
+    int64_t FloorDiv(int64_t a, int64_t b)
+    {
+        return a >= 0 ? a / b : -((-a + b - 1) / b);
+    }
+
+    void Put(uint8_t* pixel, uint8_t r, uint8_t g, uint8_t b, uint8_t a)
+    {
+        pixel[0] = r;
+        pixel[1] = g;
+        pixel[2] = b;
+        pixel[3] = a;
+    }
+
+    // Smooth 1D value noise in -1..1
+    float Noise(uint32_t seed, float x)
+    {
+        float cell = std::floor(x);
+        float t = x - cell;
+        t = t * t * (3.0f - 2.0f * t);
+        float a = (float)(Hash(seed, (int64_t)cell) & 0xFFFF) / 32767.5f - 1.0f;
+        float b = (float)(Hash(seed, (int64_t)cell + 1) & 0xFFFF) / 32767.5f - 1.0f;
+        return a + (b - a) * t;
+    }
+
+    void GenerateClouds(uint32_t seed, int64_t chunk, uint8_t* rgba, int height)
+    {
+        const int cellWidth = 160;
+        int64_t chunkX = chunk * sceneryChunkWidth;
+        int64_t firstCell = FloorDiv(chunkX - cellWidth, cellWidth);
+        int64_t lastCell = FloorDiv(chunkX + sceneryChunkWidth + cellWidth, cellWidth);
+
+        for (int64_t cell = firstCell; cell <= lastCell; cell++) {
+            uint32_t h = Hash(seed, cell, 1);
+            if (h % 10 < 3) {
+                continue;   // Gaps between clouds
+            }
+            float size = 30.0f + (float)(h >> 8 & 31) * 1.25f;
+            float cx = (float)(cell * cellWidth + (h >> 16) % cellWidth);
+            float cy = 40.0f + (float)((h >> 4) % (uint32_t)(height - 100));
+            const float puffs[4][3] = {
+                { -0.6f, 0.05f, 0.5f }, { 0.0f, -0.25f, 0.62f }, { 0.6f, 0.0f, 0.48f }, { 0.15f, 0.12f, 0.55f }
+            };
+            for (const auto& puff : puffs) {
+                float px = cx + puff[0] * size;
+                float py = cy + puff[1] * size;
+                float rx = puff[2] * size;
+                float ry = rx * 0.7f;
+                int x0 = std::max(0, (int)std::floor(px - rx - (float)chunkX));
+                int x1 = std::min(sceneryChunkWidth - 1, (int)std::ceil(px + rx - (float)chunkX));
+                int y0 = std::max(0, (int)std::floor(py - ry));
+                int y1 = std::min(height - 1, (int)std::ceil(py + ry));
+                for (int y = y0; y <= y1; y++) {
+                    float dy = ((float)y - py) / ry;
+                    for (int x = x0; x <= x1; x++) {
+                        float dx = ((float)(chunkX + x) - px) / rx;
+                        float d = dx * dx + dy * dy;
+                        if (d >= 1.0f) {
+                            continue;
+                        }
+                        // Soft edge, slightly grey towards the bottom of the cloud
+                        uint8_t alpha = (uint8_t)(std::min(1.0f, (1.0f - d) * 3.0f) * 230.0f);
+                        uint8_t* pixel = rgba + ((size_t)y * sceneryChunkWidth + x) * 4;
+                        if (alpha > pixel[3]) {
+                            uint8_t shade = (uint8_t)(255.0f - std::max(0.0f, dy) * 25.0f);
+                            Put(pixel, shade, shade, 255, alpha);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    void GenerateSkyline(uint32_t seed, int64_t chunk, uint8_t* rgba, int height)
+    {
+        const int cellWidth = 40;
+        for (int x = 0; x < sceneryChunkWidth; x++) {
+            int64_t worldX = chunk * sceneryChunkWidth + x;
+            int64_t cell = FloorDiv(worldX, cellWidth);
+            int inCell = (int)(worldX - cell * cellWidth);
+            uint32_t h = Hash(seed, cell, 2);
+            int width = 24 + (int)(h % 14);
+            int offset = (int)((h >> 8) % (uint32_t)(cellWidth - width + 1));
+            if (inCell < offset || inCell >= offset + width) {
+                continue;
+            }
+            int buildingHeight = 70 + (int)((h >> 16) % 170);
+            int bx = inCell - offset;
+            uint8_t tone = (uint8_t)(95 + (h >> 24) % 25);
+            for (int y = height - buildingHeight; y < height; y++) {
+                int by = y - (height - buildingHeight);
+                uint8_t* pixel = rgba + ((size_t)y * sceneryChunkWidth + x) * 4;
+                bool window = bx >= 3 && bx < width - 3 && by >= 6 && bx % 6 < 3 && by % 9 < 4;
+                if (window && Hash(seed, cell * 4096 + (bx / 6) * 64 + by / 9, 3) % 3 == 0) {
+                    Put(pixel, 250, 220, 130, 255);
+                } else {
+                    Put(pixel, (uint8_t)(tone - 20), (uint8_t)(tone - 5), (uint8_t)(tone + 35), 255);
+                }
+            }
+        }
+    }
+
+    void GenerateHills(uint32_t seed, int64_t chunk, uint8_t* rgba, int height)
+    {
+        for (int x = 0; x < sceneryChunkWidth; x++) {
+            float worldX = (float)(chunk * sceneryChunkWidth + x);
+            float ridge = 90.0f + 45.0f * std::sin(worldX * 0.0041f + (float)(seed & 255))
+                + 30.0f * Noise(seed ^ 0x5151u, worldX / 97.0f) + 8.0f * Noise(seed ^ 0x7777u, worldX / 23.0f);
+            float top = (float)height - ridge;
+            for (int y = std::max(0, (int)std::floor(top)); y < height; y++) {
+                float coverage = std::min(1.0f, (float)y + 1.0f - top);
+                float depth = ((float)y - top) / ridge;
+                uint8_t* pixel = rgba + ((size_t)y * sceneryChunkWidth + x) * 4;
+                Put(pixel, (uint8_t)(88 - depth * 35), (uint8_t)(168 - depth * 50), (uint8_t)(84 - depth * 20),
+                    (uint8_t)(coverage * 255.0f));
+            }
+        }
+    }
+}
+
+const SceneryLayerInfo& GetSceneryLayerInfo(int layer)
+{
+    return layers[layer];
+}
+
+void GenerateSceneryChunk(uint32_t seed, int layer, int64_t chunk, uint8_t* rgba)
+{
+    int height = layers[layer].height;
+    memset(rgba, 0, (size_t)sceneryChunkWidth * height * 4);
+    switch (layer) {
+        case SCENERY_CLOUDS: GenerateClouds(seed, chunk, rgba, height); break;
+        case SCENERY_SKYLINE: GenerateSkyline(seed, chunk, rgba, height); break;
+        default: GenerateHills(seed, chunk, rgba, height); break;
+    }
+}
+
+void GenerateSky(uint8_t* rgba)
+{
+    for (int y = 0; y < skyHeight; y++) {
+        float t = (float)y / (skyHeight - 1);
+        Put(rgba + y * 4, (uint8_t)(105 + t * 100), (uint8_t)(165 + t * 70), (uint8_t)(230 + t * 22), 255);
+    }
+}
+
+void SceneryNeededChunks(int layer, float scrollX, float screenWidth, int64_t& first, int64_t& last)
+{
+    double left = (double)scrollX * layers[layer].parallax;
+    first = (int64_t)std::floor(left / sceneryChunkWidth);
+    last = (int64_t)std::floor((left + screenWidth) / sceneryChunkWidth) + sceneryLookahead;
+}
+
+void SceneryResidency::Clear()
+{
+    for (auto& layer : chunk) {
+        for (int64_t& slot : layer) {
+            slot = -1;
+        }
+    }
+}
+
+void SceneryResidency::FillNeeded(float scrollX, float screenWidth)
+{
+    for (int layer = 0; layer < SCENERY_LAYER_COUNT; layer++) {
+        int64_t first, last;
+        SceneryNeededChunks(layer, scrollX, screenWidth, first, last);
+        for (int64_t c = first; c <= last; c++) {
+            chunk[layer][c & (sceneryPoolSlots - 1)] = c;
+        }
+    }
+}
+
+void RecordScenery(DrawList& list, const SceneryResidency& residency, float scrollX, float screenWidth, float screenHeight)
+{
+    list.AddQuad(DRAW_TEXTURE_SKY, { 0, 0, 1, (float)skyHeight }, { 0, 0, screenWidth, screenHeight });
+
+    for (int layer = 0; layer < SCENERY_LAYER_COUNT; layer++) {
+        const SceneryLayerInfo& info = layers[layer];
+        double left = (double)scrollX * info.parallax;
+        int64_t first, last;
+        SceneryNeededChunks(layer, scrollX, screenWidth, first, last);
+        last -= sceneryLookahead;
+        for (int64_t c = first; c <= last; c++) {
+            int slot = (int)(c & (sceneryPoolSlots - 1));
+            if (residency.chunk[layer][slot] != c) {
+                continue;
+            }
+            float x = (float)((double)c * sceneryChunkWidth - left);
+            list.AddQuad((DrawTexture)SceneryTextureId(layer, slot),
+                { 0, 0, (float)sceneryChunkWidth, (float)info.height },
+                { x, (float)info.top, (float)sceneryChunkWidth, (float)info.height });
+        }
+    }
+}
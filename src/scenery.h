@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+
+#include "drawlist.h"
+
+// Endless procedural parallax scenery: a sky gradient behind three layers of clouds,
+// skyline and hills. Each layer is cut into fixed-width chunks generated from the
+// world x coordinate, so any chunk can be produced on its own, in any order, on any
+// thread, and neighbouring chunks line up seamlessly. Nothing here touches raylib;
+// the SceneryStreamer in the game owns the worker thread and the textures.
+
+enum SceneryLayer {
+    SCENERY_CLOUDS = 0,
+    SCENERY_SKYLINE,
+    SCENERY_HILLS,
+    SCENERY_LAYER_COUNT
+};
+
+struct SceneryLayerInfo {
+    float parallax;     // Scroll speed relative to backgroundScrollX
+    int top;            // Band position and size in the 960x540 game screen
+    int height;
+};
+
+const int sceneryChunkWidth = 256;
+const int sceneryPoolSlots = 8;     // Chunk textures per layer; chunk n lives in slot n % 8
+const int sceneryLookahead = 1;     // Chunks generated ahead of the right screen edge
+const int skyHeight = 540;
+
+const SceneryLayerInfo& GetSceneryLayerInfo(int layer);
+
+// rgba must hold sceneryChunkWidth * layer height pixels
+void GenerateSceneryChunk(uint32_t seed, int layer, int64_t chunk, uint8_t* rgba);
+// 1 x skyHeight vertical gradient
+void GenerateSky(uint8_t* rgba);
+
+// Chunks of a layer that are on screen or within the lookahead
+void SceneryNeededChunks(int layer, float scrollX, float screenWidth, int64_t& first, int64_t& last);
+
+// Which chunk every pooled texture holds, -1 while empty
+struct SceneryResidency {
+    int64_t chunk[SCENERY_LAYER_COUNT][sceneryPoolSlots];
+
+    void Clear();
+    // Marks every needed chunk resident, for headless recording without textures
+    void FillNeeded(float scrollX, float screenWidth);
+};
+
+inline uint8_t SceneryTextureId(int layer, int slot)
+{
+    return (uint8_t)(DRAW_TEXTURE_SCENERY + layer * sceneryPoolSlots + slot);
+}
+
+// Sky plus every resident visible chunk, back to front. Chunks that aren't ready
+// yet are skipped and the sky shows through.
+void RecordScenery(DrawList& list, const SceneryResidency& residency, float scrollX, float screenWidth, float screenHeight);
@@ -0,0 +1,218 @@
+#include <algorithm>
+
+#include "scenerystreamer.h"
+#include "alloctrack.h"
+
+SceneryStreamer::SceneryStreamer()
+    : skyTexture{}, seed(1), layerMask((1u << SCENERY_LAYER_COUNT) - 1), started(false), quit(false), chunksGenerated(0)
+{
+    residency.Clear();
+    for (auto& layer : slots) {
+        for (Slot& slot : layer) {
+            slot.texture = {};
+            slot.pending = false;
+        }
+    }
+}
+
+SceneryStreamer::~SceneryStreamer()
+{
+    Stop();
+}
+
+void SceneryStreamer::Start(uint32_t seed)
+{
+    if (started) {
+        return;
+    }
+    HeapScope heapScope(MEM_SCENERY);
+    this->seed = seed;
+    residency.Clear();
+    finished.reserve(SCENERY_LAYER_COUNT * sceneryPoolSlots);
+    uploads.reserve(SCENERY_LAYER_COUNT * sceneryPoolSlots);
+
+    // The whole pool is allocated up front, streaming only ever overwrites it
+    for (int layer = 0; layer < SCENERY_LAYER_COUNT; layer++) {
+        int height = GetSceneryLayerInfo(layer).height;
+        for (Slot& slot : slots[layer]) {
+            slot.pixels.assign((size_t)sceneryChunkWidth * height * 4, 0);
+            Image image = { slot.pixels.data(), sceneryChunkWidth, height, 1, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8 };
+            slot.texture = LoadTextureFromImage(image);
+            slot.pending = false;
+        }
+    }
+
+    std::vector<uint8_t> sky((size_t)skyHeight * 4);
+    GenerateSky(sky.data());
+    Image skyImage = { sky.data(), 1, skyHeight, 1, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8 };
+    skyTexture = LoadTextureFromImage(skyImage);
+
+    quit = false;
+#ifndef __EMSCRIPTEN__
+    worker = std::thread(&SceneryStreamer::WorkerLoop, this);
+#endif
+    started = true;
+}
+
+void SceneryStreamer::Stop()
+{
+    if (!started) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        quit = true;
+        requests.clear();
+    }
+    wake.notify_all();
+    if (worker.joinable()) {
+        worker.join();
+    }
+
+    for (auto& layer : slots) {
+        for (Slot& slot : layer) {
+            UnloadTexture(slot.texture);
+            slot.texture = {};
+            slot.pending = false;
+        }
+    }
+    UnloadTexture(skyTexture);
+    skyTexture = {};
+    finished.clear();
+    uploads.clear();
+    residency.Clear();
+    started = false;
+}
+
+void SceneryStreamer::SetLayerMask(uint32_t mask)
+{
+    layerMask = mask;
+    for (int layer = 0; layer < SCENERY_LAYER_COUNT; layer++) {
+        if (!(mask & (1u << layer))) {
+            for (int64_t& chunk : residency.chunk[layer]) {
+                chunk = -1;
+            }
+        }
+    }
+}
+
+void SceneryStreamer::WorkerLoop()
+{
+    HeapScope heapScope(MEM_SCENERY);
+    for (;;) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [this] { return quit || !requests.empty(); });
+            if (quit) {
+                return;
+            }
+            job = requests.front();
+            requests.pop_front();
+        }
+
+        // Generation runs unlocked, into a buffer the main thread won't touch until it's handed back
+        GenerateSceneryChunk(seed, job.layer, job.chunk, slots[job.layer][job.slot].pixels.data());
+        chunksGenerated.fetch_add(1, std::memory_order_relaxed);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        finished.push_back(job);
+    }
+}
+
+void SceneryStreamer::Upload(const Job& job)
+{
+    Slot& slot = slots[job.layer][job.slot];
+    slot.pending = false;
+    if (!(layerMask & (1u << job.layer))) {
+        return;     // Disabled while it was being generated
+    }
+    UpdateTexture(slot.texture, slot.pixels.data());
+    residency.chunk[job.layer][job.slot] = job.chunk;
+}
+
+bool SceneryStreamer::UploadNext()
+{
+    if (uploads.empty()) {
+        return false;
+    }
+    HeapScope heapScope(MEM_SCENERY);
+    Upload(uploads.front());
+    uploads.erase(uploads.begin());
+    return !uploads.empty();
+}
+
+void SceneryStreamer::Update(float scrollX, float screenWidth)
+{
+    if (!started) {
+        return;
+    }
+    HeapScope heapScope(MEM_SCENERY);
+
+#ifdef __EMSCRIPTEN__
+    // No worker thread: generate the oldest request here, one per frame
+    if (!requests.empty()) {
+        Job job = requests.front();
+        requests.pop_front();
+        GenerateSceneryChunk(seed, job.layer, job.chunk, slots[job.layer][job.slot].pixels.data());
+        chunksGenerated.fetch_add(1, std::memory_order_relaxed);
+        uploads.push_back(job);
+    }
+#else
+    {
+        // Never wait on the worker; whatever isn't finished now is picked up next frame
+        std::unique_lock<std::mutex> lock(mutex, std::try_to_lock);
+        if (lock.owns_lock() && !finished.empty()) {
+            uploads.insert(uploads.end(), finished.begin(), finished.end());
+            finished.clear();
+        }
+    }
+#endif
+
+    // Request missing chunks, nearest the left edge first. A slot still being
+    // generated for an older chunk is re-requested once it has been uploaded.
+    bool requested = false;
+    for (int layer = 0; layer < SCENERY_LAYER_COUNT; layer++) {
+        if (!(layerMask & (1u << layer))) {
+            continue;
+        }
+        int64_t first, last;
+        SceneryNeededChunks(layer, scrollX, screenWidth, first, last);
+        for (int64_t chunk = first; chunk <= last; chunk++) {
+            int index = (int)(chunk & (sceneryPoolSlots - 1));
+            Slot& slot = slots[layer][index];
+            if (residency.chunk[layer][index] == chunk || slot.pending) {
+                continue;
+            }
+            slot.pending = true;
+#ifndef __EMSCRIPTEN__
+            std::lock_guard<std::mutex> lock(mutex);
+#endif
+            requests.push_back({layer, index, chunk});
+            requested = true;
+        }
+    }
+    if (requested) {
+        wake.notify_one();
+    }
+}
+
+uint64_t SceneryStreamer::GpuBytes() const
+{
+    uint64_t bytes = (uint64_t)GetPixelDataSize(skyTexture.width, skyTexture.height, skyTexture.format);
+    for (const auto& layer : slots) {
+        for (const Slot& slot : layer) {
+            bytes += (uint64_t)GetPixelDataSize(slot.texture.width, slot.texture.height, slot.texture.format);
+        }
+    }
+    return bytes;
+}
+
+Texture2D SceneryStreamer::Texture(uint8_t id) const
+{
+    int index = id - DRAW_TEXTURE_SCENERY;
+    if (index < 0 || index >= SCENERY_LAYER_COUNT * sceneryPoolSlots) {
+        return skyTexture;
+    }
+    return slots[index / sceneryPoolSlots][index % sceneryPoolSlots].texture;
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "raylib.h"
+#include "scenery.h"
+
+// Streams procedural scenery chunks into a fixed pool of textures. A worker thread
+// generates the chunks ahead of the scroll position into per-slot staging buffers;
+// the main thread only queues requests and uploads finished chunks one at a time
+// with UpdateTexture when the frame has time left, so generation never stalls a
+// frame. A chunk that isn't ready yet is simply not drawn. Web builds have no worker
+// and generate one chunk per frame on the main thread instead.
+class SceneryStreamer
+{
+public:
+    SceneryStreamer();
+    ~SceneryStreamer();
+
+    // Creates the textures (needs the GL context) and starts the worker
+    void Start(uint32_t seed);
+    void Stop();
+
+    // Main thread, once per frame: collects finished chunks and requests missing ones
+    void Update(float scrollX, float screenWidth);
+    // Main thread: uploads the oldest finished chunk; true while more are waiting
+    bool UploadNext();
+    size_t PendingUploads() const { return uploads.size(); }
+
+    // Layers that are streamed and drawn, bit n = SceneryLayer n. Disabled layers
+    // drop out of the residency, so RecordScenery skips them.
+    void SetLayerMask(uint32_t mask);
+
+    const SceneryResidency& Residency() const { return residency; }
+    Texture2D Texture(uint8_t id) const;
+    Texture2D SkyTexture() const { return skyTexture; }
+    uint32_t ChunksGenerated() const { return chunksGenerated.load(std::memory_order_relaxed); }
+    // Texture memory of the pool and the sky, the pool's size doesn't change while streaming
+    uint64_t GpuBytes() const;
+
+private:
+    struct Job {
+        int layer;
+        int slot;
+        int64_t chunk;
+    };
+
+    struct Slot {
+        Texture2D texture;
+        std::vector<uint8_t> pixels;    // Staging buffer, owned by the worker while pending
+        bool pending;                   // Requested, not uploaded yet
+    };
+
+    void WorkerLoop();
+    void Upload(const Job& job);
+
+    Slot slots[SCENERY_LAYER_COUNT][sceneryPoolSlots];
+    SceneryResidency residency;
+    Texture2D skyTexture;
+    uint32_t seed;
+    uint32_t layerMask;
+    bool started;
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::deque<Job> requests;
+    std::vector<Job> finished;      // Filled by the worker
+    std::vector<Job> uploads;       // Taken from finished, waiting for UploadNext
+    bool quit;
+    std::thread worker;
+    std::atomic<uint32_t> chunksGenerated;
+};
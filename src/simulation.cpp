@@ -0,0 +1,343 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#include "simulation.h"
+
+namespace
+{
+    uint64_t NowNs()
+    {
+        return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    int RandomRange(uint32_t& rngState, int min, int max)
+    {
+        // xorshift32, inclusive range like raylib's GetRandomValue
+        uint32_t x = rngState;
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        rngState = x;
+        if (max <= min) {
+            return min;
+        }
+        return min + (int)(x % (uint32_t)(max - min + 1));
+    }
+}
+
+bool RandomGapSource::NextPipe(uint32_t, SimState& state, const SimConfig& config, PipeSpec& spec)
+{
+    if (state.pipes.empty()) {
+        // First pipe - place it in the middle
+        spec.gapCenter = (float)((int)config.height / 2);
+    } else {
+        // Calculate the target gap center based on the previous pipe
+        float prevGapCenter = state.pipes.back().gapCenter;
+        float minGapCenter = std::max(config.pipeGap / 2, prevGapCenter - config.maxGapHeightDifference);
+        float maxGapCenter = std::min(config.height - config.pipeGap / 2, prevGapCenter + config.maxGapHeightDifference);
+        spec.gapCenter = (float)RandomRange(state.rngState, (int)minGapCenter, (int)maxGapCenter);
+    }
+    spec.speed = 0.0f;
+    spec.spacing = config.basePipeSpeed * config.initialSpawnInterval;
+    return true;
+}
+
+Simulation::Simulation(const SimConfig& config)
+    : config(config), profile(nullptr), gapSource(&randomSource), eyesOpenMask(nullptr), eyesClosedMask(nullptr), pixelCollision(false)
+{
+    state.pipes.reserve(16);
+    Reset(1, 0);
+}
+
+void Simulation::Reset(uint32_t seed, uint16_t flags)
+{
+    state.tick = 0;
+    state.rngState = seed ? seed : 1;   // xorshift must never be seeded with zero
+    state.playerX = (float)((int)config.width / 4);
+    state.playerY = (float)((int)config.height / 2);
+    state.playerVelocity = 0.0f;
+    state.playerEyesClosedTimer = 0.0f;
+    state.pipeSpeed = config.basePipeSpeed;
+    state.pipeSpawnInterval = config.initialSpawnInterval;
+    state.pipeSpawnTimer = (flags & SIM_RESET_SPAWN_IMMEDIATELY) ? state.pipeSpawnInterval : 0.0f;
+    state.score = 0;
+    state.pipesSpawned = 0;
+    state.gameOver = false;
+    state.deathCause = DEATH_CAUSE_FLOOR;
+    state.fatalPipe = {0.0f, config.height / 2.0f, false, 0.0f};
+    state.pipes.clear();
+    state.nextPipeDistance = InitialPipeDistance();
+    state.gapSourceEnded = false;
+    pixelCollision = (flags & SIM_RESET_PIXEL_COLLISION) && HasPlayerMasks();
+}
+
+uint32_t Simulation::PracticePipeAt(float speed) const
+{
+    // The first pipe spawns one interval in, after that there is one pipe per
+    // InitialPipeDistance of travel; while ramping, travel is (v^2 - v0^2) / 2a
+    float base = config.basePipeSpeed;
+    float travel = config.pipeSpeedIncrease > 0.0f ? (speed * speed - base * base) / (2.0f * config.pipeSpeedIncrease) : 0.0f;
+    return (uint32_t)(std::max(0.0f, travel - InitialPipeDistance()) / InitialPipeDistance()) + 1;
+}
+
+bool Simulation::BuildPractice(uint32_t seed, uint16_t flags, float speed, uint32_t pipeIndex)
+{
+    Reset(seed, flags & ~SIM_RESET_SPAWN_IMMEDIATELY);
+    speed = std::max(config.basePipeSpeed, std::min(config.maxSpeed, speed));
+    uint32_t rampPipe = PracticePipeAt(speed);
+    if (pipeIndex == practiceAutoPipe) {
+        pipeIndex = rampPipe;
+    }
+    // Below max speed the pipe count follows from the speed; at max speed any later pipe works
+    bool atMaxSpeed = speed >= config.maxSpeed;
+    if (HasCourse() || pipeIndex + 1 < rampPipe || (!atMaxSpeed && pipeIndex > rampPipe + 1)) {
+        return false;
+    }
+
+    float rampPerTick = config.pipeSpeedIncrease * simTickDt;
+    state.tick = rampPerTick > 0.0f ? (uint32_t)std::ceil((speed - config.basePipeSpeed) / rampPerTick) : 0;
+    state.pipeSpeed = speed;
+    state.pipeSpawnInterval = InitialPipeDistance() / speed;
+
+    // Same RNG draws as the real spawns, keeping only the two newest pipes
+    for (uint32_t i = 0; i <= pipeIndex; i++) {
+        SpawnPipe();
+        if (state.pipes.size() > 2) {
+            state.pipes.erase(state.pipes.begin());
+        }
+    }
+
+    // Spawns land on whole ticks, so pipes sit a whole number of ticks of travel apart.
+    // The passed pipe clears the player's sprite by a few pixels; the upcoming one sits
+    // where it would be `ticksSinceSpawn` ticks after spawning.
+    float tickTravel = speed * simTickDt;
+    float spacing = std::ceil(state.pipeSpawnInterval / simTickDt) * tickTravel;
+    float passedX = state.playerX - config.playerSize / 2 - 4.0f - config.pipeWidth;
+    uint32_t ticksSinceSpawn = (uint32_t)std::max(0.0f, std::round((config.width - passedX - spacing) / tickTravel) - 1.0f);
+    Pipe& upcoming = state.pipes.back();
+    upcoming.x = config.width - (float)(ticksSinceSpawn + 1) * tickTravel;
+    state.pipeSpawnTimer = (float)ticksSinceSpawn * simTickDt;
+    if (state.pipes.size() == 2) {
+        Pipe& passed = state.pipes.front();
+        passed.x = upcoming.x - spacing;
+        passed.scored = true;
+    }
+
+    state.score = (int)pipeIndex;
+    state.playerY = upcoming.gapCenter;
+    return true;
+}
+
+void Simulation::SetPlayerMasks(const CollisionMask* eyesOpen, const CollisionMask* eyesClosed)
+{
+    eyesOpenMask = eyesOpen;
+    eyesClosedMask = eyesClosed;
+}
+
+void Simulation::UpdatePipeSpeed()
+{
+    state.pipeSpeed += config.pipeSpeedIncrease * simTickDt;  // Smooth speed increase over time
+    if (state.pipeSpeed > config.maxSpeed) {
+        state.pipeSpeed = config.maxSpeed;
+    }
+    state.pipeSpawnInterval = state.nextPipeDistance / state.pipeSpeed; // Keep the distance between pipes
+}
+
+bool Simulation::SpawnPipe()
+{
+    PipeSpec spec;
+    if (state.gapSourceEnded || !gapSource->NextPipe(state.pipesSpawned, state, config, spec)) {
+        state.gapSourceEnded = true;
+        return false;
+    }
+
+    // Authored gaps still have to fit on screen
+    float gapCenter = std::max(config.pipeGap / 2, std::min(config.height - config.pipeGap / 2, spec.gapCenter));
+    float gapDelta = state.pipes.empty() ? 0.0f : gapCenter - state.pipes.back().gapCenter;
+    if (spec.speed > 0.0f) {
+        state.pipeSpeed = std::min(spec.speed, config.maxSpeed);
+    }
+    state.nextPipeDistance = spec.spacing > 0.0f ? spec.spacing : InitialPipeDistance();
+
+    state.pipes.push_back({config.width, gapCenter, false, gapDelta});
+    state.pipesSpawned++;
+    return true;
+}
+
+void Simulation::Die(RunDeathCause cause, const Pipe* fatalPipe)
+{
+    state.gameOver = true;
+    state.deathCause = cause;
+
+    // Wall deaths are attributed to the next pipe the player was heading for
+    if (fatalPipe == nullptr) {
+        for (const auto& pipe : state.pipes) {
+            if (!pipe.scored) {
+                fatalPipe = &pipe;
+                break;
+            }
+        }
+    }
+    state.fatalPipe = fatalPipe ? *fatalPipe : Pipe{0.0f, config.height / 2.0f, false, 0.0f};
+}
+
+void Simulation::EndSection(SimSection section, uint64_t& mark)
+{
+    if (profile != nullptr) {
+        uint64_t now = NowNs();
+        profile->sectionNs[section] = (uint32_t)(now - mark);
+        mark = now;
+    }
+}
+
+void Simulation::CollidePipe(const Pipe& pipe, float halfWidth, float halfHeight)
+{
+    float gapTop = pipe.gapCenter - config.pipeGap / 2;
+    float gapBottom = pipe.gapCenter + config.pipeGap / 2;
+
+    if (pixelCollision) {
+        // Pipe rectangles in the coordinates of the sprite mask drawn around the player
+        const CollisionMask* mask = state.playerEyesClosedTimer > 0.0f ? eyesClosedMask : eyesOpenMask;
+        float originX = state.playerX - config.playerSize / 2;
+        float originY = state.playerY - config.playerSize / 2;
+        float left = pipe.x - originX;
+        float right = left + config.pipeWidth;
+        float size = (float)mask->Size();
+        if (mask->OverlapsRect(left, -1.0f, right, gapTop - originY)) {
+            Die(DEATH_CAUSE_PIPE_TOP, &pipe);
+        } else if (mask->OverlapsRect(left, gapBottom - originY, right, size + 1.0f)) {
+            Die(DEATH_CAUSE_PIPE_BOTTOM, &pipe);
+        }
+        return;
+    }
+
+    // Check if player is within pipe's x range and outside the gap
+    if (state.playerX + halfWidth > pipe.x && state.playerX - halfWidth < pipe.x + config.pipeWidth) {
+        if (state.playerY - halfHeight < gapTop) {
+            Die(DEATH_CAUSE_PIPE_TOP, &pipe);
+        } else if (state.playerY + halfHeight > gapBottom) {
+            Die(DEATH_CAUSE_PIPE_BOTTOM, &pipe);
+        }
+    }
+}
+
+uint32_t Simulation::Step(bool flap)
+{
+    if (state.gameOver) {
+        return 0;
+    }
+
+    uint32_t events = 0;
+    const float dt = simTickDt;
+    uint64_t mark = profile != nullptr ? NowNs() : 0;
+    state.tick++;
+
+    if (flap) {
+        state.playerVelocity = config.jumpForce;
+        state.playerEyesClosedTimer = config.playerEyesClosedDuration;
+        events |= SIM_EVENT_FLAP;
+    }
+    EndSection(SIM_SECTION_INPUT, mark);
+
+    UpdatePipeSpeed();
+    EndSection(SIM_SECTION_SPEED, mark);
+
+    // Update player physics
+    state.playerVelocity += config.gravity * dt;
+    state.playerY += state.playerVelocity * dt;
+
+    // Check for collisions with screen boundaries using collision box
+    float collisionBoxWidth = config.playerSize * config.playerCollisionWidthRatio;
+    float collisionBoxHeight = config.playerSize * config.playerCollisionHeightRatio;
+    if (state.playerY - collisionBoxHeight / 2 < 0) {
+        Die(DEATH_CAUSE_CEILING, nullptr);
+    } else if (state.playerY + collisionBoxHeight / 2 > config.height) {
+        Die(DEATH_CAUSE_FLOOR, nullptr);
+    }
+    EndSection(SIM_SECTION_PHYSICS, mark);
+
+    // Spawn pipes
+    state.pipeSpawnTimer += dt;
+    if (state.pipeSpawnTimer >= state.pipeSpawnInterval && !state.gapSourceEnded) {
+        state.pipeSpawnTimer = 0.0f;
+        events |= SpawnPipe() ? SIM_EVENT_PIPE_SPAWNED : SIM_EVENT_COURSE_END;
+    }
+    EndSection(SIM_SECTION_SPAWN, mark);
+
+    // Move pipes and check collisions
+    for (auto& pipe : state.pipes) {
+        pipe.x -= state.pipeSpeed * dt;
+        // Check if player has passed the pipe
+        if (state.playerX > pipe.x + config.pipeWidth && !pipe.scored) {
+            state.score++;
+            pipe.scored = true;
+            events |= SIM_EVENT_SCORE;
+        }
+
+        if (!state.gameOver) {
+            CollidePipe(pipe, collisionBoxWidth / 2, collisionBoxHeight / 2);
+        }
+    }
+    EndSection(SIM_SECTION_PIPES, mark);
+
+    // Remove pipes that are off screen
+    const float pipeWidth = config.pipeWidth;
+    state.pipes.erase(std::remove_if(state.pipes.begin(), state.pipes.end(),
+        [pipeWidth](const Pipe& pipe) { return pipe.x < -pipeWidth; }),
+        state.pipes.end());
+
+    if (state.playerEyesClosedTimer > 0.0f) {
+        state.playerEyesClosedTimer -= dt;
+        if (state.playerEyesClosedTimer < 0.0f) state.playerEyesClosedTimer = 0.0f;
+    }
+    EndSection(SIM_SECTION_CLEANUP, mark);
+
+    if (state.gameOver) {
+        events |= SIM_EVENT_DEATH;
+    }
+    return events;
+}
+
+namespace
+{
+    void HashBytes(uint64_t& hash, const void* data, size_t size)
+    {
+        // FNV-1a
+        const unsigned char* bytes = static_cast<const unsigned char*>(data);
+        for (size_t i = 0; i < size; i++) {
+            hash ^= bytes[i];
+            hash *= 1099511628211ull;
+        }
+    }
+
+    template <typename T>
+    void HashValue(uint64_t& hash, const T& value)
+    {
+        HashBytes(hash, &value, sizeof(value));
+    }
+}
+
+uint64_t Simulation::Hash() const
+{
+    uint64_t hash = 14695981039346656037ull;
+    HashValue(hash, state.tick);
+    HashValue(hash, state.rngState);
+    HashValue(hash, state.playerY);
+    HashValue(hash, state.playerVelocity);
+    HashValue(hash, state.playerEyesClosedTimer);
+    HashValue(hash, state.pipeSpeed);
+    HashValue(hash, state.pipeSpawnTimer);
+    HashValue(hash, state.score);
+    HashValue(hash, state.pipesSpawned);
+    uint8_t gameOver = state.gameOver ? 1 : 0;
+    HashValue(hash, gameOver);
+    for (const Pipe& pipe : state.pipes) {
+        uint8_t scored = pipe.scored ? 1 : 0;
+        HashValue(hash, pipe.x);
+        HashValue(hash, pipe.gapCenter);
+        HashValue(hash, scored);
+    }
+    return hash;
+}
@@ -0,0 +1,174 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "runrecord.h"
+#include "collisionmask.h"
+
+// Deterministic gameplay simulation, free of raylib so it can run headless in tools.
+// The game advances it with fixed ticks; the same seed and flap inputs always
+// produce the same state, which is what replays and the golden-replay gate rely on.
+
+const int simTickRate = 240;
+const float simTickDt = 1.0f / simTickRate;
+const uint32_t practiceAutoPipe = 0xFFFFFFFF;
+
+struct Pipe {
+    float x;
+    float gapCenter;
+    bool scored;
+    float gapDelta;  // Gap center change relative to the previous pipe
+};
+
+struct SimConfig {
+    float width = 960.0f;
+    float height = 540.0f;
+    float playerSize = 80.0f;
+    float gravity = 1200.0f;
+    float jumpForce = -400.0f;
+    float basePipeSpeed = 300.0f;
+    float pipeWidth = 80.0f;
+    float pipeGap = 230.0f;
+    float pipeSpeedIncrease = 10.0f;        // Speed increase per second
+    float maxGapHeightDifference = 100.0f;  // Maximum allowed vertical distance between consecutive pipe gaps
+    float maxSpeed = 1200.0f;
+    float initialSpawnInterval = 2.0f;      // Seconds between pipes at base speed
+    float playerCollisionWidthRatio = 0.70f;
+    float playerCollisionHeightRatio = 0.55f;
+    float playerEyesClosedDuration = 0.33f;
+};
+
+struct SimState {
+    uint32_t tick;
+    uint32_t rngState;
+    float playerX;
+    float playerY;
+    float playerVelocity;
+    float playerEyesClosedTimer;
+    float pipeSpeed;
+    float pipeSpawnTimer;
+    float pipeSpawnInterval;
+    int score;
+    uint32_t pipesSpawned;
+    bool gameOver;
+    RunDeathCause deathCause;
+    Pipe fatalPipe;             // Valid once gameOver is set
+    std::vector<Pipe> pipes;
+    // Follow from the gap source's pipes, so they stay out of Hash()
+    float nextPipeDistance;     // Travel from the newest pipe to the next spawn
+    bool gapSourceEnded;        // The gap source ran out, no more pipes spawn
+};
+
+// What the spawner needs for the next pipe
+struct PipeSpec {
+    float gapCenter;
+    float speed;        // Pipe speed from this pipe on, 0 keeps the ramp
+    float spacing;      // Travel to the next pipe
+};
+
+// Where the spawner gets its pipes from. The default draws random gaps from the
+// simulation's RNG; CourseFile streams authored ones.
+class GapSource
+{
+public:
+    virtual ~GapSource() {}
+    // Pipe number index (0 for a run's first), called right before it spawns with the
+    // newest pipe still at state.pipes.back(). Returns false once the source has run out.
+    virtual bool NextPipe(uint32_t index, SimState& state, const SimConfig& config, PipeSpec& spec) = 0;
+};
+
+// Random walk of gap centers within maxGapHeightDifference, at the default spacing
+class RandomGapSource : public GapSource
+{
+public:
+    bool NextPipe(uint32_t index, SimState& state, const SimConfig& config, PipeSpec& spec) override;
+};
+
+// Bits returned by Simulation::Step
+enum SimEvent : uint32_t {
+    SIM_EVENT_FLAP = 1 << 0,
+    SIM_EVENT_SCORE = 1 << 1,
+    SIM_EVENT_DEATH = 1 << 2,
+    SIM_EVENT_PIPE_SPAWNED = 1 << 3,
+    SIM_EVENT_COURSE_END = 1 << 4,      // The gap source ran out
+};
+
+// Reset flags, stored in replays so playback starts from the same layout
+enum SimResetFlags : uint16_t {
+    SIM_RESET_SPAWN_IMMEDIATELY = 1 << 0,   // First pipe spawns on the first tick (first run after launch)
+    SIM_RESET_PIXEL_COLLISION = 1 << 1,     // Pipes collide with the player masks instead of the box
+};
+
+// Sections of Simulation::Step, timed only while a SimTickProfile is attached
+enum SimSection {
+    SIM_SECTION_INPUT = 0,
+    SIM_SECTION_SPEED,
+    SIM_SECTION_PHYSICS,
+    SIM_SECTION_SPAWN,
+    SIM_SECTION_PIPES,      // Move, score and collide
+    SIM_SECTION_CLEANUP,    // Off-screen pipes and timers
+    SIM_SECTION_COUNT
+};
+
+struct SimTickProfile {
+    uint32_t sectionNs[SIM_SECTION_COUNT];
+};
+
+class Simulation
+{
+public:
+    explicit Simulation(const SimConfig& config = SimConfig());
+
+    void Reset(uint32_t seed, uint16_t flags);
+    uint32_t Step(bool flap);
+
+    // Builds the state of a run of this seed whose pipes have reached speed, without
+    // simulating up to it: tick and speed from the linear ramp, the gap sequence
+    // replayed from the RNG, and the last passed pipe plus the upcoming one laid out
+    // one spawn apart with the spawn timer phase to match. The player waits at the
+    // upcoming gap. pipeIndex is the upcoming pipe (the score so far), or
+    // practiceAutoPipe for what a run at that speed would have reached. Returns false
+    // for a speed/pipe pair no run can be in, or when a course is set since its speeds
+    // and spacings don't follow the ramp; the state is then left reset.
+    bool BuildPractice(uint32_t seed, uint16_t flags, float speed, uint32_t pipeIndex);
+    // Upcoming pipe index of a run whose pipes just reached speed
+    uint32_t PracticePipeAt(float speed) const;
+
+    const SimState& State() const { return state; }
+    SimState& MutableState() { return state; }
+    const SimConfig& Config() const { return config; }
+    float InitialPipeDistance() const { return config.basePipeSpeed * config.initialSpawnInterval; }
+
+    // Order-sensitive hash of the full gameplay state, for replay verification
+    uint64_t Hash() const;
+
+    // Sprite masks for SIM_RESET_PIXEL_COLLISION, sized to playerSize. The
+    // simulation keeps the pointers, the caller owns the masks.
+    void SetPlayerMasks(const CollisionMask* eyesOpen, const CollisionMask* eyesClosed);
+    bool HasPlayerMasks() const { return eyesOpenMask != nullptr && eyesClosedMask != nullptr; }
+
+    // Source of the following spawns, nullptr for the random one. Courses are not part
+    // of Reset's seed and flags, so their runs can't be replayed from those alone.
+    void SetGapSource(GapSource* source) { gapSource = source != nullptr ? source : &randomSource; }
+    bool HasCourse() const { return gapSource != &randomSource; }
+
+    // Per-section timing of the following Step() calls, nullptr to stop
+    void SetProfile(SimTickProfile* profile) { this->profile = profile; }
+
+private:
+    void UpdatePipeSpeed();
+    bool SpawnPipe();
+    void Die(RunDeathCause cause, const Pipe* fatalPipe);
+    void EndSection(SimSection section, uint64_t& mark);
+    void CollidePipe(const Pipe& pipe, float halfWidth, float halfHeight);
+
+    SimConfig config;
+    SimState state;
+    SimTickProfile* profile;
+    RandomGapSource randomSource;
+    GapSource* gapSource;
+    const CollisionMask* eyesOpenMask;
+    const CollisionMask* eyesClosedMask;
+    bool pixelCollision;    // Set by Reset from SIM_RESET_PIXEL_COLLISION
+};
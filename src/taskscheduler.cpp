@@ -0,0 +1,105 @@
+#include "taskscheduler.h"
+
+namespace
+{
+    // Frames a task may go without a step before it gets one regardless of the budget
+    const uint32_t maxWaitFrames[TASK_PRIORITY_COUNT] = { 0, 8, 30 };
+}
+
+TaskScheduler::TaskScheduler()
+    : frame(0), stepsRun(0), forcedSteps(0)
+{
+}
+
+void TaskScheduler::Post(const char* name, TaskPriority priority, TaskStep step, uint32_t key)
+{
+    std::deque<Task>& queue = queues[priority];
+    if (key != 0) {
+        for (Task& task : queue) {
+            if (task.key == key && !task.started) {
+                task.name = name;
+                task.step = std::move(step);
+                return;
+            }
+        }
+    }
+    Task task = { name, std::move(step), key, frame, 0.0f, false };
+    queue.push_back(std::move(task));
+}
+
+void TaskScheduler::StepFront(std::deque<Task>& queue)
+{
+    Task& task = queue.front();
+    task.started = true;
+    Clock::time_point start = Clock::now();
+    bool finished = task.step();
+    float cost = std::chrono::duration<float>(Clock::now() - start).count();
+    stepsRun++;
+    if (finished) {
+        queue.pop_front();
+        return;
+    }
+    task.stepCost += (cost - task.stepCost) * costSmoothing;
+    task.lastStepFrame = frame;
+}
+
+void TaskScheduler::Run(double budgetSeconds)
+{
+    frame++;
+    Clock::time_point deadline = Clock::now() + std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(budgetSeconds > 0.0 ? budgetSeconds : 0.0));
+
+    // Starved tasks first, one step each, whatever the budget says
+    for (int priority = 0; priority < TASK_PRIORITY_COUNT; priority++) {
+        std::deque<Task>& queue = queues[priority];
+        if (!queue.empty() && frame - queue.front().lastStepFrame > maxWaitFrames[priority]) {
+            StepFront(queue);
+            forcedSteps++;
+        }
+    }
+
+    // Then the highest priority work that still fits before the deadline. Queues are
+    // FIFO, so the oldest task of a priority finishes before the next one starts.
+    for (int priority = 0; priority < TASK_PRIORITY_COUNT;) {
+        std::deque<Task>& queue = queues[priority];
+        if (queue.empty()) {
+            priority++;
+            continue;
+        }
+        Clock::time_point now = Clock::now();
+        if (now + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<float>(queue.front().stepCost)) > deadline) {
+            return;
+        }
+        StepFront(queue);
+    }
+}
+
+void TaskScheduler::Flush()
+{
+    for (int priority = 0; priority < TASK_PRIORITY_COUNT; priority++) {
+        while (!queues[priority].empty()) {
+            StepFront(queues[priority]);
+        }
+    }
+}
+
+bool TaskScheduler::Has(uint32_t key) const
+{
+    for (const std::deque<Task>& queue : queues) {
+        for (const Task& task : queue) {
+            if (task.key == key) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+size_t TaskScheduler::Pending() const
+{
+    size_t pending = 0;
+    for (const std::deque<Task>& queue : queues) {
+        pending += queue.size();
+    }
+    return pending;
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+
+// Queues are served highest first
+enum TaskPriority {
+    TASK_HIGH,      // Shows up on screen soon: texture uploads
+    TASK_NORMAL,    // Asset reloads, font baking
+    TASK_LOW,       // Save flushes
+    TASK_PRIORITY_COUNT
+};
+
+// One slice of a resumable task: does a short, bounded piece of work and returns true
+// once the task is finished. A task keeps its progress in its own state (an explicit
+// state machine), so a long job is posted as a sequence of short steps.
+typedef std::function<bool()> TaskStep;
+
+// Main-thread work that has to run on the GL thread but not in any particular frame.
+// The game runs it after drawing with whatever time is left before the frame deadline,
+// so a one-off burst of work is spread over several frames instead of becoming a
+// hitch. A task that has waited longer than its priority allows gets a step even in a
+// frame with no time to spare, so a busy stretch can't starve it.
+class TaskScheduler
+{
+public:
+    TaskScheduler();
+
+    // Queues a task. A nonzero key replaces the step of a queued task with the same key
+    // that hasn't started yet, so repeated requests (the high score rising every pipe)
+    // coalesce into one; a started task is left to finish and the new one queues.
+    void Post(const char* name, TaskPriority priority, TaskStep step, uint32_t key = 0);
+
+    // Once per frame: steps tasks until budgetSeconds is used up. A step is only started
+    // when the task's typical step cost still fits.
+    void Run(double budgetSeconds);
+    // Runs everything to completion, for shutdown
+    void Flush();
+
+    bool Has(uint32_t key) const;
+    size_t Pending() const;
+    uint64_t StepsRun() const { return stepsRun; }
+    uint64_t ForcedSteps() const { return forcedSteps; }   // Starvation steps past the budget
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    struct Task {
+        const char* name;
+        TaskStep step;
+        uint32_t key;
+        uint32_t lastStepFrame;     // Frame it was posted or last stepped
+        float stepCost;             // Moving average, seconds
+        bool started;
+    };
+
+    // Steps the front task of a queue, retiring it when it finishes
+    void StepFront(std::deque<Task>& queue);
+
+    std::deque<Task> queues[TASK_PRIORITY_COUNT];
+    uint32_t frame;
+    uint64_t stepsRun;
+    uint64_t forcedSteps;
+
+    const float costSmoothing = 0.25f;
+};
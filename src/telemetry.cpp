@@ -0,0 +1,254 @@
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "telemetry.h"
+#include "alloctrack.h"
+
+namespace
+{
+    const size_t ringCapacity = 8192;          // Records per thread, power of two
+    const size_t flushBatch = 4096;            // Records per fwrite
+    const int flushIntervalMs = 250;
+    const size_t maxFileBytes = 8 * 1024 * 1024;   // Rotate after this much, about 90 minutes of frames at 60 fps
+    const int keptFiles = 3;                        // telemetry.bin, .1 and .2; a new session rotates too
+
+    // Single-producer single-consumer ring, the owning thread writes and the flush thread reads
+    struct TelemetryRing {
+        TelemetryRecord records[ringCapacity];
+        std::atomic<uint64_t> head{0};   // Next slot the producer writes
+        char padding[64];                // Keeps producer and consumer indices on separate cache lines
+        std::atomic<uint64_t> tail{0};   // Next slot the consumer reads
+    };
+
+    std::atomic<bool> enabled(false);
+    std::atomic<uint32_t> currentFrame(0);
+    std::atomic<uint64_t> droppedRecords(0);
+    std::chrono::steady_clock::time_point startTime;
+
+    // Rings are registered once per thread and live until Stop()
+    std::mutex ringsMutex;
+    std::vector<TelemetryRing*> rings;
+    std::atomic<uint32_t> generation(0);
+    thread_local TelemetryRing* threadRing = nullptr;
+    thread_local uint32_t threadRingGeneration = 0;
+
+    FILE* outputFile = nullptr;
+    std::string outputPath;
+    size_t fileBytes = 0;
+    std::thread flushThread;
+    std::mutex wakeMutex;
+    std::condition_variable wakeCondition;
+    bool stopRequested = false;
+
+    TelemetryRing* AcquireRing()
+    {
+        uint32_t gen = generation.load(std::memory_order_acquire);
+        if (threadRing == nullptr || threadRingGeneration != gen) {
+            HeapScope heapScope(MEM_DIAGNOSTICS);
+            TelemetryRing* ring = new TelemetryRing();
+            std::lock_guard<std::mutex> lock(ringsMutex);
+            rings.push_back(ring);
+            threadRing = ring;
+            threadRingGeneration = gen;
+        }
+        return threadRing;
+    }
+
+    // Keeps the previous files, the one before a crash included, as .1, .2 ...
+    void ShiftFiles()
+    {
+        for (int i = keptFiles - 1; i > 0; i--) {
+            std::string from = i > 1 ? outputPath + "." + std::to_string(i - 1) : outputPath;
+            std::string to = outputPath + "." + std::to_string(i);
+            remove(to.c_str());     // rename doesn't replace on Windows
+            rename(from.c_str(), to.c_str());
+        }
+    }
+
+    // Every file starts with its own header, so each one decodes on its own
+    bool OpenFile()
+    {
+        outputFile = fopen(outputPath.c_str(), "wb");
+        if (outputFile == nullptr) {
+            return false;
+        }
+        TelemetryFileHeader header = { telemetryMagic, telemetryVersion, (uint16_t)sizeof(TelemetryRecord) };
+        fwrite(&header, sizeof(header), 1, outputFile);
+        fileBytes = sizeof(header);
+        return true;
+    }
+
+    size_t WriteBatch(const std::vector<TelemetryRecord>& batch)
+    {
+        if (outputFile == nullptr) {
+            return 0;   // Reopening after a rotation failed
+        }
+        size_t written = fwrite(batch.data(), sizeof(TelemetryRecord), batch.size(), outputFile);
+        fileBytes += written * sizeof(TelemetryRecord);
+        if (fileBytes >= maxFileBytes) {
+            fclose(outputFile);
+            ShiftFiles();
+            OpenFile();
+        }
+        return written;
+    }
+
+    // Drains every ring into the file; returns the number of records written. Only the
+    // ring list is copied under the lock, so a thread registering its first ring never
+    // waits on disk I/O; rings stay alive until Stop() joins this thread.
+    size_t Drain(std::vector<TelemetryRing*>& drained, std::vector<TelemetryRecord>& batch)
+    {
+        {
+            std::lock_guard<std::mutex> lock(ringsMutex);
+            drained.assign(rings.begin(), rings.end());
+        }
+        size_t written = 0;
+        for (TelemetryRing* ring : drained) {
+            uint64_t tail = ring->tail.load(std::memory_order_relaxed);
+            uint64_t head = ring->head.load(std::memory_order_acquire);
+            while (tail != head) {
+                batch.push_back(ring->records[tail & (ringCapacity - 1)]);
+                tail++;
+                if (batch.size() == flushBatch) {
+                    written += WriteBatch(batch);
+                    batch.clear();
+                }
+            }
+            ring->tail.store(tail, std::memory_order_release);
+        }
+        if (!batch.empty()) {
+            written += WriteBatch(batch);
+            batch.clear();
+        }
+        return written;
+    }
+
+    void FlushLoop()
+    {
+        std::vector<TelemetryRing*> drained;
+        std::vector<TelemetryRecord> batch;
+        batch.reserve(flushBatch);
+        std::unique_lock<std::mutex> lock(wakeMutex);
+        while (!stopRequested) {
+            wakeCondition.wait_for(lock, std::chrono::milliseconds(flushIntervalMs));
+            lock.unlock();
+            if (Drain(drained, batch) > 0 && outputFile != nullptr) {
+                fflush(outputFile);
+            }
+            lock.lock();
+        }
+        lock.unlock();
+        Drain(drained, batch);
+        if (outputFile != nullptr) {
+            fflush(outputFile);
+        }
+    }
+}
+
+namespace Telemetry
+{
+    bool StartFromEnvironment()
+    {
+#ifdef __EMSCRIPTEN__
+        return false;
+#else
+        const char* setting = getenv("HOVERCAT_TELEMETRY");
+        if (setting != nullptr && strcmp(setting, "0") == 0) {
+            return false;
+        }
+        return Start(setting != nullptr && setting[0] != '\0' ? setting : "telemetry.bin");
+#endif
+    }
+
+    bool Start(const char* path)
+    {
+        if (enabled.load()) {
+            return true;
+        }
+
+        outputPath = path;
+        ShiftFiles();
+        if (!OpenFile()) {
+            return false;
+        }
+
+        startTime = std::chrono::steady_clock::now();
+        droppedRecords.store(0);
+        stopRequested = false;
+        flushThread = std::thread(FlushLoop);
+        enabled.store(true, std::memory_order_release);
+        return true;
+    }
+
+    void Stop()
+    {
+        if (!enabled.exchange(false)) {
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(wakeMutex);
+            stopRequested = true;
+        }
+        wakeCondition.notify_one();
+        flushThread.join();
+        if (outputFile != nullptr) {
+            fclose(outputFile);
+        }
+        outputFile = nullptr;
+
+        // Threads holding a ring from this session will allocate a fresh one next time
+        std::lock_guard<std::mutex> lock(ringsMutex);
+        for (TelemetryRing* ring : rings) {
+            delete ring;
+        }
+        rings.clear();
+        generation.fetch_add(1, std::memory_order_release);
+    }
+
+    bool IsEnabled()
+    {
+        return enabled.load(std::memory_order_relaxed);
+    }
+
+    void SetFrame(uint32_t frame)
+    {
+        currentFrame.store(frame, std::memory_order_relaxed);
+    }
+
+    void Write(TelemetryType type, uint16_t code, float value0, float value1)
+    {
+        if (!enabled.load(std::memory_order_acquire)) {
+            return;
+        }
+
+        TelemetryRing* ring = AcquireRing();
+        uint64_t head = ring->head.load(std::memory_order_relaxed);
+        if (head - ring->tail.load(std::memory_order_acquire) >= ringCapacity) {
+            droppedRecords.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        TelemetryRecord& record = ring->records[head & (ringCapacity - 1)];
+        record.timeNs = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - startTime).count();
+        record.type = type;
+        record.code = code;
+        record.frame = currentFrame.load(std::memory_order_relaxed);
+        record.value0 = value0;
+        record.value1 = value1;
+        ring->head.store(head + 1, std::memory_order_release);
+    }
+
+    uint64_t DroppedRecords()
+    {
+        return droppedRecords.load(std::memory_order_relaxed);
+    }
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstdint>
+
+// Structured binary telemetry. Records are fixed-size and written into a lock-free
+// per-thread ring; a background thread drains all rings and appends them to disk in
+// large batches. Writing a record is a handful of stores, cheap enough to leave on.
+
+enum TelemetryType : uint16_t {
+    TELEMETRY_FRAME = 1,    // value0 = frame time, value1 = CPU time spent in Update+Draw
+    TELEMETRY_INPUT = 2,    // code = TelemetryInput
+    TELEMETRY_STATE = 3,    // code = TelemetryState, value0 = score, value1 = pipe speed
+    TELEMETRY_HITCH = 4,    // code = offending FramePhase, value0 = frame time, value1 = frame budget
+};
+
+enum TelemetryInput : uint16_t {
+    INPUT_FLAP = 1,
+    INPUT_MUSIC_TOGGLE = 2,
+    INPUT_FULLSCREEN_TOGGLE = 3,
+    INPUT_PAUSE_TOGGLE = 4,
+};
+
+enum TelemetryState : uint16_t {
+    STATE_GAME_START = 1,
+    STATE_PAUSED = 2,
+    STATE_RESUMED = 3,
+    STATE_FOCUS_LOST = 4,
+    STATE_FOCUS_GAINED = 5,
+    STATE_GAME_OVER = 6,
+    STATE_RESET = 7,
+    STATE_EXIT_MENU_OPEN = 8,
+    STATE_EXIT_MENU_CLOSE = 9,
+};
+
+struct TelemetryRecord {
+    uint64_t timeNs;    // Nanoseconds since Telemetry::Start
+    uint16_t type;      // TelemetryType
+    uint16_t code;      // Type specific code
+    uint32_t frame;     // Frame index at the time of writing
+    float value0;
+    float value1;
+};
+
+static_assert(sizeof(TelemetryRecord) == 24, "TelemetryRecord must stay a fixed 24 bytes");
+
+// File layout: TelemetryFileHeader followed by TelemetryRecord[]
+struct TelemetryFileHeader {
+    uint32_t magic;         // telemetryMagic
+    uint16_t version;
+    uint16_t recordSize;
+};
+
+const uint32_t telemetryMagic = 0x4C544B48; // "HKTL"
+const uint16_t telemetryVersion = 1;
+
+namespace Telemetry
+{
+    // Reads HOVERCAT_TELEMETRY: unset writes telemetry.bin, "0" disables, anything else is the path.
+    // The file rotates at 8 MB and on every start, keeping the last two as <path>.1 and .2
+    bool StartFromEnvironment();
+    bool Start(const char* path);
+    void Stop();    // Flushes everything; call once no other thread is writing
+    bool IsEnabled();
+
+    void SetFrame(uint32_t frame);
+    void Write(TelemetryType type, uint16_t code, float value0 = 0.0f, float value1 = 0.0f);
+
+    // Records lost because a ring was full when the writer fell behind
+    uint64_t DroppedRecords();
+}
@@ -0,0 +1,309 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+#include "timestretch.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define TIME_STRETCH_SSE2
+#endif
+
+namespace
+{
+    const float hopSeconds = 0.0125f;       // Windows of 25 ms overlapping by half
+    const float searchSeconds = 0.008f;
+
+    uint32_t RoundDown(uint32_t value, uint32_t multiple)
+    {
+        return value / multiple * multiple;
+    }
+
+    // The similarity search is nearly all of the cost
+    float Dot(const float* a, const float* b, uint32_t count)
+    {
+        float sum = 0.0f;
+        uint32_t i = 0;
+#ifdef TIME_STRETCH_SSE2
+        __m128 low = _mm_setzero_ps();
+        __m128 high = _mm_setzero_ps();
+        for (; i + 8 <= count; i += 8) {
+            low = _mm_add_ps(low, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+            high = _mm_add_ps(high, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+        }
+        float lanes[4];
+        _mm_storeu_ps(lanes, _mm_add_ps(low, high));
+        sum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+#endif
+        for (; i < count; i++) {
+            sum += a[i] * b[i];
+        }
+        return sum;
+    }
+}
+
+constexpr float TimeStretch::minTempo;
+constexpr float TimeStretch::maxTempo;
+constexpr float TimeStretch::budgetShare;
+
+AudioFifo::AudioFifo(uint32_t capacityFrames)
+    : samples(static_cast<float*>(calloc(capacityFrames > 0 ? capacityFrames : 1, 2 * sizeof(float)))),
+      capacity(samples != nullptr ? capacityFrames : 0), head(0), tail(0)
+{
+}
+
+AudioFifo::~AudioFifo()
+{
+    free(samples);
+}
+
+uint32_t AudioFifo::Free() const
+{
+    return capacity - (uint32_t)(head.load(std::memory_order_relaxed) - tail.load(std::memory_order_acquire));
+}
+
+uint32_t AudioFifo::Available() const
+{
+    return (uint32_t)(head.load(std::memory_order_acquire) - tail.load(std::memory_order_relaxed));
+}
+
+uint32_t AudioFifo::Write(const float* frames, uint32_t count)
+{
+    uint64_t position = head.load(std::memory_order_relaxed);
+    count = std::min(count, Free());
+    // At most two copies, the second one after wrapping around
+    uint32_t start = (uint32_t)(position % capacity);
+    uint32_t first = std::min(count, capacity - start);
+    memcpy(samples + 2 * start, frames, (size_t)first * 2 * sizeof(float));
+    memcpy(samples, frames + 2 * first, (size_t)(count - first) * 2 * sizeof(float));
+    head.store(position + count, std::memory_order_release);
+    return count;
+}
+
+uint32_t AudioFifo::Read(float* frames, uint32_t count)
+{
+    uint64_t position = tail.load(std::memory_order_relaxed);
+    count = std::min(count, Available());
+    uint32_t start = (uint32_t)(position % capacity);
+    uint32_t first = std::min(count, capacity - start);
+    memcpy(frames, samples + 2 * start, (size_t)first * 2 * sizeof(float));
+    memcpy(frames + 2 * first, samples, (size_t)(count - first) * 2 * sizeof(float));
+    tail.store(position + count, std::memory_order_release);
+    return count;
+}
+
+void AudioFifo::Clear()
+{
+    head.store(0, std::memory_order_relaxed);
+    tail.store(0, std::memory_order_relaxed);
+}
+
+TimeStretch::TimeStretch(uint32_t sampleRate)
+    : sampleRate(sampleRate), input(nullptr), inputFrames(0), analysisPosition(0.0), continuation(-1), hann(nullptr),
+      overlap(nullptr), ready(nullptr), readyOffset(0), continuationMono(nullptr), regionMono(nullptr),
+      continuationCoarse(nullptr), regionCoarse(nullptr), tempo(1.0f), underruns(0), silentFrames(0), buffersProcessed(0),
+      overBudget(0), peakProcessNs(0), framesConsumed(0)
+{
+    hop = std::max(16 * decimation, RoundDown((uint32_t)(sampleRate * hopSeconds), decimation));
+    window = 2 * hop;
+    search = RoundDown((uint32_t)(sampleRate * searchSeconds), decimation);
+    // The next window can start up to a search range before where the last one
+    // continues and end a search range past a whole window at maxTempo hops ahead
+    inputCapacity = 2 * search + window + hop + decimation;
+
+    // One block for every buffer, carved up below
+    uint32_t regionFrames = 2 * search + hop;
+    size_t floats = 2 * (size_t)inputCapacity + window + 2 * (size_t)window + 2 * (size_t)hop
+        + hop + regionFrames + hop / decimation + regionFrames / decimation;
+    float* block = static_cast<float*>(calloc(floats, sizeof(float)));
+    if (block == nullptr) {
+        hop = window = search = inputCapacity = 0;
+        return;
+    }
+    input = block;
+    hann = input + 2 * inputCapacity;
+    overlap = hann + window;
+    ready = overlap + 2 * window;
+    continuationMono = ready + 2 * hop;
+    regionMono = continuationMono + hop;
+    continuationCoarse = regionMono + regionFrames;
+    regionCoarse = continuationCoarse + hop / decimation;
+
+    // Periodic Hann: windows a hop apart sum to exactly one
+    for (uint32_t i = 0; i < window; i++) {
+        hann[i] = 0.5f - 0.5f * std::cos(2.0f * 3.14159265f * (float)i / (float)window);
+    }
+    Reset();
+}
+
+TimeStretch::~TimeStretch()
+{
+    free(input);
+}
+
+uint64_t TimeStretch::Bytes() const
+{
+    uint64_t regionFrames = 2 * search + hop;
+    return input == nullptr ? 0 : (2 * (uint64_t)inputCapacity + 3 * (uint64_t)window + 3 * (uint64_t)hop
+        + regionFrames + (hop + regionFrames) / decimation) * sizeof(float);
+}
+
+void TimeStretch::SetTempo(float tempo)
+{
+    this->tempo.store(std::max(minTempo, std::min(tempo, maxTempo)), std::memory_order_relaxed);
+}
+
+void TimeStretch::Reset()
+{
+    if (input == nullptr) {
+        return;
+    }
+    // A search range of silence ahead of the input, so the first window can move back too
+    inputFrames = search;
+    memset(input, 0, (size_t)search * 2 * sizeof(float));
+    memset(overlap, 0, (size_t)window * 2 * sizeof(float));
+    analysisPosition = search;
+    continuation = -1;
+    readyOffset = hop;
+}
+
+bool TimeStretch::Fill(AudioFifo& source, uint32_t end)
+{
+    end = std::min(end, inputCapacity);
+    if (inputFrames < end) {
+        uint32_t count = source.Read(input + 2 * inputFrames, end - inputFrames);
+        inputFrames += count;
+        framesConsumed.fetch_add(count, std::memory_order_relaxed);
+    }
+    return inputFrames >= end;
+}
+
+uint32_t TimeStretch::BestWindow(uint32_t nominal)
+{
+    uint32_t low = nominal - search;
+    uint32_t regionFrames = 2 * search + hop;
+    uint32_t natural = (uint32_t)continuation;
+    for (uint32_t i = 0; i < hop; i++) {
+        continuationMono[i] = input[2 * (natural + i)] + input[2 * (natural + i) + 1];
+    }
+    for (uint32_t i = 0; i < regionFrames; i++) {
+        regionMono[i] = input[2 * (low + i)] + input[2 * (low + i) + 1];
+    }
+
+    // Coarse pass: every decimation-th offset against decimated mono, with the
+    // candidate's energy slid along instead of summed again
+    uint32_t coarseLength = hop / decimation;
+    uint32_t coarseRegion = regionFrames / decimation;
+    for (uint32_t i = 0; i < coarseLength; i++) {
+        const float* frames = continuationMono + i * decimation;
+        continuationCoarse[i] = frames[0] + frames[1] + frames[2] + frames[3];
+    }
+    for (uint32_t i = 0; i < coarseRegion; i++) {
+        const float* frames = regionMono + i * decimation;
+        regionCoarse[i] = frames[0] + frames[1] + frames[2] + frames[3];
+    }
+    float energy = Dot(regionCoarse, regionCoarse, coarseLength);
+    uint32_t coarseBest = 0;
+    float coarseScore = -1e30f;
+    uint32_t lastOffset = 2 * search / decimation;
+    for (uint32_t offset = 0; offset <= lastOffset; offset++) {
+        float score = Dot(continuationCoarse, regionCoarse + offset, coarseLength) / std::sqrt(std::max(energy, 0.0f) + 1e-9f);
+        if (score > coarseScore) {
+            coarseScore = score;
+            coarseBest = offset * decimation;
+        }
+        if (offset < lastOffset) {
+            float leaving = regionCoarse[offset];
+            float entering = regionCoarse[offset + coarseLength];
+            energy += entering * entering - leaving * leaving;
+        }
+    }
+
+    // Fine pass around the coarse pick at full rate. The natural continuation starts
+    // as the best, so a steady tempo of 1 passes the input through unchanged.
+    uint32_t best = coarseBest;
+    float bestScore = -1e30f;
+    if (natural >= low && natural - low <= 2 * search) {
+        best = natural - low;
+        bestScore = Dot(continuationMono, regionMono + best, hop) / std::sqrt(Dot(regionMono + best, regionMono + best, hop) + 1e-9f);
+    }
+    uint32_t first = coarseBest >= decimation - 1 ? coarseBest - (decimation - 1) : 0;
+    uint32_t last = std::min(coarseBest + decimation - 1, 2 * search);
+    for (uint32_t offset = first; offset <= last; offset++) {
+        const float* candidate = regionMono + offset;
+        float score = Dot(continuationMono, candidate, hop) / std::sqrt(Dot(candidate, candidate, hop) + 1e-9f);
+        if (score > bestScore) {
+            bestScore = score;
+            best = offset;
+        }
+    }
+    return low + best;
+}
+
+bool TimeStretch::SynthesizeHop(AudioFifo& source)
+{
+    uint32_t nominal = (uint32_t)analysisPosition;
+    if (!Fill(source, nominal + search + window)) {
+        return false;
+    }
+    uint32_t start = continuation < 0 ? nominal : BestWindow(nominal);
+
+    const float* frames = input + 2 * start;
+    for (uint32_t i = 0; i < window; i++) {
+        overlap[2 * i] += hann[i] * frames[2 * i];
+        overlap[2 * i + 1] += hann[i] * frames[2 * i + 1];
+    }
+    // The first hop has had both of its windows added, the second waits for the next
+    memcpy(ready, overlap, (size_t)hop * 2 * sizeof(float));
+    memmove(overlap, overlap + 2 * hop, (size_t)(window - hop) * 2 * sizeof(float));
+    memset(overlap + 2 * (window - hop), 0, (size_t)hop * 2 * sizeof(float));
+    readyOffset = 0;
+
+    continuation = start + hop;
+    analysisPosition += hop * (double)tempo.load(std::memory_order_relaxed);
+    Compact();
+    return true;
+}
+
+void TimeStretch::Compact()
+{
+    // Neither the next search range nor the continuation it is matched against reach
+    // back past this
+    uint32_t keep = std::min((uint32_t)analysisPosition - search, (uint32_t)continuation);
+    keep = std::min(keep, inputFrames);
+    memmove(input, input + 2 * keep, (size_t)(inputFrames - keep) * 2 * sizeof(float));
+    inputFrames -= keep;
+    analysisPosition -= keep;
+    continuation -= keep;
+}
+
+void TimeStretch::Process(AudioFifo& source, float* out, uint32_t frames)
+{
+    auto start = std::chrono::steady_clock::now();
+    uint32_t written = 0;
+    while (written < frames && input != nullptr) {
+        if (readyOffset == hop && !SynthesizeHop(source)) {
+            break;
+        }
+        uint32_t count = std::min(frames - written, hop - readyOffset);
+        memcpy(out + 2 * written, ready + 2 * readyOffset, (size_t)count * 2 * sizeof(float));
+        readyOffset += count;
+        written += count;
+    }
+    if (written < frames) {
+        memset(out + 2 * written, 0, (size_t)(frames - written) * 2 * sizeof(float));
+        underruns.fetch_add(1, std::memory_order_relaxed);
+        silentFrames.fetch_add(frames - written, std::memory_order_relaxed);
+    }
+
+    uint32_t ns = (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    if (ns > peakProcessNs.load(std::memory_order_relaxed)) {
+        peakProcessNs.store(ns, std::memory_order_relaxed);
+    }
+    if (ns > budgetShare * 1e9f * (float)frames / (float)sampleRate) {
+        overBudget.fetch_add(1, std::memory_order_relaxed);
+    }
+    buffersProcessed.fetch_add(1, std::memory_order_relaxed);
+}
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+// Interleaved stereo float frames handed from one producer thread to one consumer
+// thread, lock-free. The samples are malloc'd like raylib's audio data, so they
+// count toward the audio budget instead of the heap.
+class AudioFifo
+{
+public:
+    explicit AudioFifo(uint32_t capacityFrames);
+    ~AudioFifo();
+    AudioFifo(const AudioFifo&) = delete;
+    AudioFifo& operator=(const AudioFifo&) = delete;
+
+    // Producer thread, returns the frames that fit
+    uint32_t Write(const float* frames, uint32_t count);
+    uint32_t Free() const;
+
+    // Consumer thread, returns the frames there were
+    uint32_t Read(float* frames, uint32_t count);
+    uint32_t Available() const;
+
+    // Only while neither thread is using it
+    void Clear();
+
+    uint32_t Capacity() const { return capacity; }
+    uint64_t Bytes() const { return (uint64_t)capacity * 2 * sizeof(float); }
+
+private:
+    float* samples;
+    uint32_t capacity;
+    std::atomic<uint64_t> head;     // Frames written
+    char padding[64];               // Keeps producer and consumer indices on separate cache lines
+    std::atomic<uint64_t> tail;     // Frames read
+};
+
+// Real-time WSOLA (waveform similarity overlap-add) on interleaved stereo: plays
+// the input faster or slower without changing its pitch. Every hop it takes the
+// next Hann window from about tempo hops further into the input, nudged within a
+// small search range to where it best continues the previous window, and
+// overlap-adds it. The similarity search runs on a decimated mono mix and is
+// refined at full rate, so a hop costs a few tens of thousands of multiply-adds.
+// Process runs on the audio thread and never allocates or locks.
+class TimeStretch
+{
+public:
+    static constexpr float minTempo = 0.5f;
+    static constexpr float maxTempo = 2.0f;
+    // Share of a buffer's playback time Process may take before it counts as over budget
+    static constexpr float budgetShare = 0.02f;
+
+    explicit TimeStretch(uint32_t sampleRate);
+    ~TimeStretch();
+    TimeStretch(const TimeStretch&) = delete;
+    TimeStretch& operator=(const TimeStretch&) = delete;
+
+    // Any thread. 1 plays as recorded, clamped to minTempo..maxTempo
+    void SetTempo(float tempo);
+    float Tempo() const { return tempo.load(std::memory_order_relaxed); }
+
+    // Audio thread. Writes frames of stretched stereo pulled from input; when input
+    // runs dry the rest of the buffer is silence and an underrun is counted
+    void Process(AudioFifo& input, float* out, uint32_t frames);
+
+    // Only while Process isn't running: drops the buffered input and output
+    void Reset();
+
+    uint32_t SampleRate() const { return sampleRate; }
+    uint64_t Bytes() const;
+    // Output frames produced before the first input frame comes out at full level
+    uint32_t LatencyFrames() const { return hop; }
+
+    // Any thread
+    uint64_t Underruns() const { return underruns.load(std::memory_order_relaxed); }
+    uint64_t SilentFrames() const { return silentFrames.load(std::memory_order_relaxed); }
+    uint64_t BuffersProcessed() const { return buffersProcessed.load(std::memory_order_relaxed); }
+    uint64_t OverBudget() const { return overBudget.load(std::memory_order_relaxed); }
+    uint32_t PeakProcessNs() const { return peakProcessNs.load(std::memory_order_relaxed); }
+    uint64_t FramesConsumed() const { return framesConsumed.load(std::memory_order_relaxed); }
+
+private:
+    static const uint32_t decimation = 4;      // Frames per sample of the coarse search
+
+    bool Fill(AudioFifo& input, uint32_t end);
+    uint32_t BestWindow(uint32_t nominal);
+    bool SynthesizeHop(AudioFifo& input);
+    void Compact();
+
+    uint32_t sampleRate;
+    uint32_t hop;               // Output frames per window, half the window
+    uint32_t window;
+    uint32_t search;            // Frames the window may move either way, a multiple of decimation
+
+    // Audio thread state. Positions are frames into the input buffer.
+    float* input;               // Stereo input still needed, compacted as it is consumed
+    uint32_t inputCapacity;
+    uint32_t inputFrames;
+    double analysisPosition;    // Where the next window nominally starts
+    int64_t continuation;       // Where the last window naturally continues, -1 before the first
+    float* hann;
+    float* overlap;             // Stereo overlap-add accumulator, one window long
+    float* ready;               // Stereo output of the last hop
+    uint32_t readyOffset;
+    float* continuationMono;    // Search scratch: mono mixes and their decimations
+    float* regionMono;
+    float* continuationCoarse;
+    float* regionCoarse;
+
+    std::atomic<float> tempo;
+    std::atomic<uint64_t> underruns;
+    std::atomic<uint64_t> silentFrames;
+    std::atomic<uint64_t> buffersProcessed;
+    std::atomic<uint64_t> overBudget;
+    std::atomic<uint32_t> peakProcessNs;
+    std::atomic<uint64_t> framesConsumed;
+};
@@ -0,0 +1,125 @@
+#include <algorithm>
+#include <cmath>
+
+#include "uicanvas.h"
+
+UiCanvas::UiCanvas()
+    : scale(1.0f), offsetX(0.0f), offsetY(0.0f), frame(0), drawCalls(0)
+{
+}
+
+void UiCanvas::Begin(float scale, float offsetX, float offsetY)
+{
+    if (scale != this->scale) {
+        cache.clear();      // Every native size changes with the scale
+    }
+    this->scale = scale;
+    this->offsetX = offsetX;
+    this->offsetY = offsetY;
+    frame++;
+    drawCalls = 0;
+
+    // Changing texts like the score would grow the cache forever, drop whatever
+    // wasn't drawn last frame once it gets large
+    if (cache.size() > maxCachedTexts) {
+        for (auto it = cache.begin(); it != cache.end();) {
+            if (frame - it->second.lastUsed > 1) {
+                it = cache.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+}
+
+Rectangle UiCanvas::ToScreen(float x, float y, float width, float height) const
+{
+    // Snap to whole screen pixels so edges and glyphs stay crisp
+    float left = std::round(offsetX + x * scale);
+    float top = std::round(offsetY + y * scale);
+    return { left, top, std::round(offsetX + (x + width) * scale) - left, std::round(offsetY + (y + height) * scale) - top };
+}
+
+const UiCanvas::CachedText& UiCanvas::Lookup(const char* text, int fontSize)
+{
+    // FNV-1a over the text and size
+    uint64_t key = 14695981039346656037ull ^ (uint64_t)fontSize;
+    for (const char* c = text; *c != '\0'; c++) {
+        key = (key ^ (uint8_t)*c) * 1099511628211ull;
+    }
+
+    CachedText& entry = cache[key];
+    if (entry.fontSize != fontSize || entry.text != text || entry.nativeSize == 0) {
+        entry.text = text;
+        entry.fontSize = fontSize;
+        entry.nativeSize = std::max(1, (int)std::lround(fontSize * scale));
+        entry.nativeWidth = MeasureText(text, entry.nativeSize);
+        Layout(GetFontDefault(), text, entry.nativeSize, entry.glyphs);
+    }
+    entry.lastUsed = frame;
+    return entry;
+}
+
+void UiCanvas::Layout(const Font& font, const char* text, int nativeSize, std::vector<Glyph>& glyphs)
+{
+    // DrawText's rules: at least size 10, spacing of a pixel per 10, and raylib's
+    // default line spacing of 2 pixels
+    int size = std::max(nativeSize, 10);
+    float spacing = (float)(size / 10);
+    float scaleFactor = (float)size / font.baseSize;
+    float padding = (float)font.glyphPadding;
+    float penX = 0.0f;
+    float penY = 0.0f;
+    glyphs.clear();
+    while (*text != '\0') {
+        int bytes = 0;
+        int codepoint = GetCodepointNext(text, &bytes);
+        text += bytes;
+        if (codepoint == '\n') {
+            penX = 0.0f;
+            penY += (float)(size + 2);
+            continue;
+        }
+        int index = GetGlyphIndex(font, codepoint);
+        const Rectangle& rec = font.recs[index];
+        if (codepoint != ' ' && codepoint != '\t') {
+            Glyph glyph;
+            glyph.source = { rec.x - padding, rec.y - padding, rec.width + 2.0f * padding, rec.height + 2.0f * padding };
+            glyph.dest = { penX + (font.glyphs[index].offsetX - padding) * scaleFactor, penY + (font.glyphs[index].offsetY - padding) * scaleFactor,
+                glyph.source.width * scaleFactor, glyph.source.height * scaleFactor };
+            glyphs.push_back(glyph);
+        }
+        int advance = font.glyphs[index].advanceX;
+        penX += (advance != 0 ? (float)advance : rec.width) * scaleFactor + spacing;
+    }
+}
+
+void UiCanvas::FillRect(float x, float y, float width, float height, Color color)
+{
+    DrawRectangleRec(ToScreen(x, y, width, height), color);
+    drawCalls++;
+}
+
+void UiCanvas::FillRoundedRect(Rectangle rect, float roundness, int segments, Color color)
+{
+    DrawRectangleRounded(ToScreen(rect.x, rect.y, rect.width, rect.height), roundness, segments, color);
+    drawCalls++;
+}
+
+void UiCanvas::Text(const char* text, float x, float y, int fontSize, Color color)
+{
+    const CachedText& entry = Lookup(text, fontSize);
+    Texture2D atlas = GetFontDefault().texture;
+    float left = (float)std::lround(offsetX + x * scale);
+    float top = (float)std::lround(offsetY + y * scale);
+    for (const Glyph& glyph : entry.glyphs) {
+        Rectangle dest = { left + glyph.dest.x, top + glyph.dest.y, glyph.dest.width, glyph.dest.height };
+        DrawTexturePro(atlas, glyph.source, dest, { 0.0f, 0.0f }, 0.0f, color);
+    }
+    drawCalls++;
+}
+
+float UiCanvas::TextWidth(const char* text, int fontSize)
+{
+    return (float)Lookup(text, fontSize).nativeWidth / scale;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "raylib.h"
+
+// HUD and menus drawn at native screen resolution, on top of the scaled game frame.
+// Callers lay out in game coordinates (960x540) and every call is mapped through the
+// same scale and letterbox offset as the frame blit, so the play field can stay low
+// resolution while text is rasterized sharp at the final size. Text is measured and
+// laid out into glyph quads once per string and size until the scale changes, so an
+// unchanged HUD only submits its cached quads.
+class UiCanvas
+{
+public:
+    UiCanvas();
+
+    // Sets the game-to-screen transform for this frame; call inside BeginDrawing
+    void Begin(float scale, float offsetX, float offsetY);
+
+    void FillRect(float x, float y, float width, float height, Color color);
+    void FillRoundedRect(Rectangle rect, float roundness, int segments, Color color);
+    void Text(const char* text, float x, float y, int fontSize, Color color);
+    // Width in game units of text drawn at fontSize, as it will appear on screen
+    float TextWidth(const char* text, int fontSize);
+
+    uint32_t DrawCalls() const { return drawCalls; }
+    size_t CachedTexts() const { return cache.size(); }
+
+private:
+    struct Glyph {
+        Rectangle source;       // In the default font's atlas
+        Rectangle dest;         // Screen pixels from the text's origin
+    };
+
+    struct CachedText {
+        std::string text;
+        int fontSize;
+        int nativeSize;         // Font size in screen pixels
+        int nativeWidth;        // MeasureText at nativeSize
+        std::vector<Glyph> glyphs;
+        uint32_t lastUsed;
+    };
+
+    const CachedText& Lookup(const char* text, int fontSize);
+    // Places glyphs the way DrawText does with raylib's default font
+    static void Layout(const Font& font, const char* text, int nativeSize, std::vector<Glyph>& glyphs);
+    Rectangle ToScreen(float x, float y, float width, float height) const;
+
+    float scale;
+    float offsetX;
+    float offsetY;
+    uint32_t frame;
+    uint32_t drawCalls;
+    std::unordered_map<uint64_t, CachedText> cache;
+
+    static const size_t maxCachedTexts = 128;
+};
@@ -0,0 +1,204 @@
+// coursegen: writes course files for the game (HOVERCAT_COURSE=<file>).
+//
+// Usage: coursegen [--pipes N] [--seed S] [--shape walk|wave|stairs] [--speed start:end]
+//                  [--spacing px] out.hkrc
+//        coursegen --info course.hkrc
+//
+// Shapes: walk is the game's random walk of gaps, wave a slow sine through the
+// playable band, stairs climbs and drops in steps of maxGapHeightDifference. --speed
+// ramps the per-pipe speed override linearly over the course (0:0 leaves the game's
+// own ramp alone); --spacing sets the distance between pipes (0 for the default).
+// Records are written in fixed blocks, so a marathon of millions of pipes needs no
+// more memory than a short course. --info prints a course's header and first pipes
+// through the same streaming reader the game uses.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "../src/course.h"
+#include "../src/simulation.h"
+
+namespace {
+
+enum CourseShape {
+    SHAPE_WALK,
+    SHAPE_WAVE,
+    SHAPE_STAIRS,
+};
+
+struct Options {
+    uint64_t pipes = 1000;
+    uint32_t seed = 1;
+    CourseShape shape = SHAPE_WALK;
+    float startSpeed = 0.0f;
+    float endSpeed = 0.0f;
+    float spacing = 0.0f;
+};
+
+uint32_t NextRandom(uint32_t& state)
+{
+    // xorshift32, same generator as the simulation
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+bool WriteCourse(const char* path, const Options& options)
+{
+    FILE* file = fopen(path, "wb");
+    if (file == nullptr) {
+        fprintf(stderr, "coursegen: can't write %s\n", path);
+        return false;
+    }
+    CourseHeader header = {};
+    header.magic = courseMagic;
+    header.version = courseVersion;
+    header.recordSize = sizeof(CoursePipe);
+    header.pipeCount = options.pipes;
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+
+    const SimConfig config;
+    const float minGap = config.pipeGap / 2;
+    const float maxGap = config.height - config.pipeGap / 2;
+    const float step = config.maxGapHeightDifference;
+    uint32_t rng = options.seed ? options.seed : 1;
+    float gap = (float)((int)config.height / 2);
+    float stairDirection = 1.0f;
+
+    std::vector<CoursePipe> block;
+    block.reserve(4096);
+    for (uint64_t i = 0; i < options.pipes && ok; i++) {
+        if (i > 0) {
+            switch (options.shape) {
+                case SHAPE_WALK: {
+                    int low = (int)std::max(minGap, gap - step);
+                    int high = (int)std::min(maxGap, gap + step);
+                    gap = (float)(low + (int)(NextRandom(rng) % (uint32_t)(high - low + 1)));
+                    break;
+                }
+                case SHAPE_WAVE:
+                    gap = (minGap + maxGap) / 2 + (maxGap - minGap) / 2 * std::sin((float)i * 0.35f);
+                    break;
+                case SHAPE_STAIRS:
+                    if (gap + stairDirection * step > maxGap || gap + stairDirection * step < minGap) {
+                        stairDirection = -stairDirection;
+                    }
+                    gap += stairDirection * step;
+                    break;
+            }
+        }
+        float t = options.pipes > 1 ? (float)i / (float)(options.pipes - 1) : 0.0f;
+        float speed = options.startSpeed + (options.endSpeed - options.startSpeed) * t;
+        CoursePipe pipe = {};
+        pipe.gapCenter = (uint16_t)std::lround(gap);
+        pipe.speed = (uint16_t)std::lround(std::max(0.0f, std::min(65535.0f, speed)));
+        pipe.spacing = (uint16_t)std::lround(std::max(0.0f, std::min(65535.0f, options.spacing)));
+        block.push_back(pipe);
+        if (block.size() == block.capacity() || i + 1 == options.pipes) {
+            ok = fwrite(block.data(), sizeof(CoursePipe), block.size(), file) == block.size();
+            block.clear();
+        }
+    }
+    ok = fclose(file) == 0 && ok;
+    if (!ok) {
+        fprintf(stderr, "coursegen: writing %s failed\n", path);
+        return false;
+    }
+    printf("%s: %llu pipes, %llu bytes\n", path, (unsigned long long)options.pipes,
+        (unsigned long long)(sizeof(CourseHeader) + options.pipes * sizeof(CoursePipe)));
+    return true;
+}
+
+bool PrintCourse(const char* path)
+{
+    CourseFile course;
+    if (!course.Open(path)) {
+        fprintf(stderr, "coursegen: %s\n", course.Error().c_str());
+        return false;
+    }
+    printf("%s: %llu pipes, %zu byte window\n", path, (unsigned long long)course.PipeCount(), course.WindowBytes());
+    for (uint64_t i = 0; i < course.PipeCount() && i < 16; i++) {
+        const CoursePipe* pipe = course.Pipe(i);
+        printf("  %6llu gap %4u speed %4u spacing %4u\n", (unsigned long long)i,
+            pipe->gapCenter, pipe->speed, pipe->spacing);
+    }
+    // Walk the rest so truncation or mapping errors show up here rather than mid-run
+    uint64_t gapSum = 0;
+    for (uint64_t i = 0; i < course.PipeCount(); i++) {
+        const CoursePipe* pipe = course.Pipe(i);
+        if (pipe == nullptr) {
+            fprintf(stderr, "coursegen: pipe %llu unreadable\n", (unsigned long long)i);
+            return false;
+        }
+        gapSum += pipe->gapCenter;
+    }
+    printf("mean gap %.1f, %llu window moves\n", (double)gapSum / (double)course.PipeCount(),
+        (unsigned long long)course.WindowMoves());
+    return true;
+}
+
+void Usage()
+{
+    fprintf(stderr,
+        "usage: coursegen [--pipes N] [--seed S] [--shape walk|wave|stairs] [--speed start:end]\n"
+        "                 [--spacing px] out.hkrc\n"
+        "       coursegen --info course.hkrc\n");
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    Options options;
+    const char* info = nullptr;
+    const char* output = nullptr;
+    for (int i = 1; i < argc; i++) {
+        bool hasValue = i + 1 < argc;
+        if (strcmp(argv[i], "--pipes") == 0 && hasValue) {
+            options.pipes = strtoull(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--seed") == 0 && hasValue) {
+            options.seed = (uint32_t)strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--shape") == 0 && hasValue) {
+            const char* shape = argv[++i];
+            if (strcmp(shape, "walk") == 0) {
+                options.shape = SHAPE_WALK;
+            } else if (strcmp(shape, "wave") == 0) {
+                options.shape = SHAPE_WAVE;
+            } else if (strcmp(shape, "stairs") == 0) {
+                options.shape = SHAPE_STAIRS;
+            } else {
+                Usage();
+                return 2;
+            }
+        } else if (strcmp(argv[i], "--speed") == 0 && hasValue) {
+            const char* range = argv[++i];
+            options.startSpeed = (float)atof(range);
+            const char* colon = strchr(range, ':');
+            options.endSpeed = colon != nullptr ? (float)atof(colon + 1) : options.startSpeed;
+        } else if (strcmp(argv[i], "--spacing") == 0 && hasValue) {
+            options.spacing = (float)atof(argv[++i]);
+        } else if (strcmp(argv[i], "--info") == 0 && hasValue) {
+            info = argv[++i];
+        } else if (argv[i][0] != '-' && output == nullptr) {
+            output = argv[i];
+        } else {
+            Usage();
+            return 2;
+        }
+    }
+
+    if (info != nullptr) {
+        return PrintCourse(info) ? 0 : 1;
+    }
+    if (output == nullptr || options.pipes == 0) {
+        Usage();
+        return 2;
+    }
+    return WriteCourse(output, options) ? 0 : 1;
+}
@@ -0,0 +1,324 @@
+// deathmap: aggregates run records (runs.bin) into death heatmaps.
+//
+// Usage: deathmap [-o prefix] [-j threads] runs.bin [more.bin ...]
+//
+// Every input file is split into ranges of a million records' bytes that the job
+// system's threads take and steal from each other, so files of any size mix keep every thread
+// busy. Each thread fills its own histogram and the partial histograms are summed in
+// parallel at the end, so the threads never share a cache line while streaming. The
+// CSV and the heatmaps are then written as a task graph, the images in parallel.
+// A torn append or other damage is skipped a byte at a time until a record's magic
+// turns up again, so it only costs the records it overlaps.
+// Outputs:
+//   <prefix>.csv               non-empty buckets of the full 4D histogram
+//   <prefix>_y_by_pipe.ppm     playerY (rows) x pipe index (columns)
+//   <prefix>_speed_by_gap.ppm  pipeSpeed band (rows) x gap-height change (columns)
+//   <prefix>_y_by_gap.ppm      playerY (rows) x gap-height change (columns)
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../src/jobsystem.h"
+#include "../src/runrecord.h"
+
+namespace {
+
+// Bucket layout, matching the game's constants (540px play field, speed 300..1200,
+// maxGapHeightDifference 100)
+const int yBins = 27;           // 20px bands over 540px
+const float yBinSize = 20.0f;
+const int pipeBins = 64;        // Pipe index, last bin collects everything beyond
+const int speedBins = 18;       // 50px/s bands over 300..1200
+const float speedMin = 300.0f;
+const float speedBinSize = 50.0f;
+const int gapBins = 21;         // 10px bands over -100..100
+const float gapMin = -105.0f;
+const float gapBinSize = 10.0f;
+
+const size_t bucketCount = (size_t)yBins * pipeBins * speedBins * gapBins;
+const size_t blockRecords = 1 << 16;
+const uint64_t rangeRecords = 16 * blockRecords;   // Records per job
+
+int Clamp(int value, int lo, int hi)
+{
+    return value < lo ? lo : (value > hi ? hi : value);
+}
+
+size_t BucketIndex(const RunRecord& r)
+{
+    int y = Clamp((int)(r.playerY / yBinSize), 0, yBins - 1);
+    int p = Clamp((int)r.pipeIndex, 0, pipeBins - 1);
+    int s = Clamp((int)((r.pipeSpeed - speedMin) / speedBinSize), 0, speedBins - 1);
+    int g = Clamp((int)((r.gapDelta - gapMin) / gapBinSize), 0, gapBins - 1);
+    return (((size_t)y * pipeBins + p) * speedBins + s) * gapBins + g;
+}
+
+// Byte offsets, the range takes the records that start inside it
+struct Range {
+    const char* path;
+    uint64_t begin;
+    uint64_t end;
+    uint64_t fileSize;
+};
+
+// One per job system thread, allocated by the first range it takes
+struct Partial {
+    std::vector<uint32_t> buckets;
+    std::vector<char> block;
+    uint64_t records = 0;
+    uint64_t corruptSpans = 0;
+    uint64_t skippedBytes = 0;
+};
+
+// A range after a file's first one scans for the magic without counting: the range
+// before it counts everything it skips until it is back in sync, even past its end
+void Accumulate(const Range& range, Partial& out)
+{
+    if (out.buckets.empty()) {
+        out.buckets.assign(bucketCount, 0);
+        out.block.resize(blockRecords * sizeof(RunRecord));
+    }
+    std::ifstream file(range.path, std::ios::binary);
+    if (!file.is_open()) {
+        return;
+    }
+
+    uint64_t blockStart = range.begin;
+    uint64_t blockSize = 0;
+    uint64_t position = range.begin;
+    bool counting = range.begin == 0;
+    bool skipping = false;
+    while (position < range.end || skipping) {
+        if (position + sizeof(RunRecord) > blockStart + blockSize) {
+            if (position + sizeof(RunRecord) > range.fileSize) {
+                // A torn last record
+                if (counting && !skipping && position < range.fileSize) {
+                    out.corruptSpans++;
+                    out.skippedBytes += range.fileSize - position;
+                }
+                break;
+            }
+            file.clear();
+            file.seekg((std::streamoff)position);
+            file.read(out.block.data(), (std::streamsize)out.block.size());
+            blockStart = position;
+            blockSize = (uint64_t)file.gcount();
+            if (blockSize < sizeof(RunRecord)) {
+                break;
+            }
+        }
+        RunRecord record;
+        memcpy(&record, out.block.data() + (position - blockStart), sizeof(RunRecord));
+        if (record.magic == runRecordMagic) {
+            if (position >= range.end) {
+                break;      // Back in sync in the next range, which counts from here
+            }
+            counting = true;
+            skipping = false;
+            out.buckets[BucketIndex(record)]++;
+            out.records++;
+            position += sizeof(RunRecord);
+            continue;
+        }
+        if (counting) {
+            if (!skipping) {
+                out.corruptSpans++;
+            }
+            skipping = true;
+            out.skippedBytes++;
+        }
+        position++;
+    }
+}
+
+// Black -> red -> yellow -> white ramp on a sqrt scale so sparse regions stay visible
+void WriteHeatmap(const std::string& path, const std::vector<uint64_t>& cells, int rows, int cols)
+{
+    const int cellPixels = 8;
+    uint64_t peak = 1;
+    for (uint64_t c : cells) {
+        peak = std::max(peak, c);
+    }
+
+    FILE* f = fopen(path.c_str(), "wb");
+    if (!f) {
+        fprintf(stderr, "deathmap: cannot write %s\n", path.c_str());
+        return;
+    }
+    fprintf(f, "P6\n%d %d\n255\n", cols * cellPixels, rows * cellPixels);
+    std::vector<unsigned char> line((size_t)cols * cellPixels * 3);
+    for (int row = 0; row < rows; row++) {
+        for (int col = 0; col < cols; col++) {
+            float t = std::sqrt((float)cells[(size_t)row * cols + col] / (float)peak);
+            float r = std::min(1.0f, t * 3.0f);
+            float g = std::min(1.0f, std::max(0.0f, t * 3.0f - 1.0f));
+            float b = std::min(1.0f, std::max(0.0f, t * 3.0f - 2.0f));
+            for (int px = 0; px < cellPixels; px++) {
+                unsigned char* dst = &line[((size_t)col * cellPixels + px) * 3];
+                dst[0] = (unsigned char)(r * 255.0f);
+                dst[1] = (unsigned char)(g * 255.0f);
+                dst[2] = (unsigned char)(b * 255.0f);
+            }
+        }
+        for (int py = 0; py < cellPixels; py++) {
+            fwrite(line.data(), 1, line.size(), f);
+        }
+    }
+    fclose(f);
+}
+
+// Non-empty buckets of the full histogram
+bool WriteCsv(const std::string& path, const std::vector<uint64_t>& merged)
+{
+    FILE* csv = fopen(path.c_str(), "w");
+    if (!csv) {
+        fprintf(stderr, "deathmap: cannot write %s\n", path.c_str());
+        return false;
+    }
+    fprintf(csv, "player_y_min,pipe_index,speed_min,gap_delta_min,deaths\n");
+    for (int y = 0; y < yBins; y++) {
+        for (int p = 0; p < pipeBins; p++) {
+            for (int s = 0; s < speedBins; s++) {
+                for (int g = 0; g < gapBins; g++) {
+                    uint64_t count = merged[(((size_t)y * pipeBins + p) * speedBins + s) * gapBins + g];
+                    if (count == 0) {
+                        continue;
+                    }
+                    fprintf(csv, "%d,%d,%d,%d,%llu\n", (int)(y * yBinSize), p,
+                        (int)(speedMin + s * speedBinSize), (int)(gapMin + g * gapBinSize),
+                        (unsigned long long)count);
+                }
+            }
+        }
+    }
+    fclose(csv);
+    return true;
+}
+
+uint64_t FileBytes(const char* path)
+{
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file.is_open()) {
+        return 0;
+    }
+    return (uint64_t)file.tellg();
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    std::string prefix = "deathmap";
+    unsigned threadCount = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<const char*> inputs;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            prefix = argv[++i];
+        } else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+            threadCount = (unsigned)std::max(1, atoi(argv[++i]));
+        } else {
+            inputs.push_back(argv[i]);
+        }
+    }
+    if (inputs.empty()) {
+        fprintf(stderr, "usage: deathmap [-o prefix] [-j threads] runs.bin [more.bin ...]\n");
+        return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+
+    JobSystem jobs(threadCount);
+
+    // Split every file into fixed ranges, the threads balance them by stealing
+    std::vector<Range> work;
+    for (const char* path : inputs) {
+        uint64_t total = FileBytes(path);
+        if (total == 0) {
+            fprintf(stderr, "deathmap: skipping empty or missing %s\n", path);
+            continue;
+        }
+        const uint64_t rangeBytes = rangeRecords * sizeof(RunRecord);
+        for (uint64_t begin = 0; begin < total; begin += rangeBytes) {
+            work.push_back({path, begin, std::min(begin + rangeBytes, total), total});
+        }
+    }
+
+    std::vector<Partial> partials(jobs.ThreadCount());
+    jobs.ParallelFor(work.size(), 1, [&](size_t begin, size_t end) {
+        Partial& partial = partials[jobs.CurrentThread()];
+        for (size_t i = begin; i < end; i++) {
+            Accumulate(work[i], partial);
+        }
+    });
+
+    // Merge the per-thread partial histograms, each thread summing its own slice of buckets
+    std::vector<uint64_t> merged(bucketCount, 0);
+    uint64_t records = 0;
+    uint64_t corruptSpans = 0;
+    uint64_t skippedBytes = 0;
+    for (const Partial& partial : partials) {
+        records += partial.records;
+        corruptSpans += partial.corruptSpans;
+        skippedBytes += partial.skippedBytes;
+    }
+    jobs.ParallelFor(bucketCount, 16384, [&](size_t begin, size_t end) {
+        for (const Partial& partial : partials) {
+            if (partial.buckets.empty()) {
+                continue;
+            }
+            for (size_t i = begin; i < end; i++) {
+                merged[i] += partial.buckets[i];
+            }
+        }
+    });
+
+    std::vector<uint64_t> yByPipe((size_t)yBins * pipeBins, 0);
+    std::vector<uint64_t> speedByGap((size_t)speedBins * gapBins, 0);
+    std::vector<uint64_t> yByGap((size_t)yBins * gapBins, 0);
+    bool csvWritten = false;
+
+    // The CSV and the projections only read the merged histogram; each heatmap
+    // renders once the projections are done
+    TaskGraph output;
+    output.Add([&]() { csvWritten = WriteCsv(prefix + ".csv", merged); });
+    TaskGraph::Node project = output.Add([&]() {
+        for (int y = 0; y < yBins; y++) {
+            for (int p = 0; p < pipeBins; p++) {
+                for (int s = 0; s < speedBins; s++) {
+                    for (int g = 0; g < gapBins; g++) {
+                        uint64_t count = merged[(((size_t)y * pipeBins + p) * speedBins + s) * gapBins + g];
+                        yByPipe[(size_t)y * pipeBins + p] += count;
+                        speedByGap[(size_t)s * gapBins + g] += count;
+                        yByGap[(size_t)y * gapBins + g] += count;
+                    }
+                }
+            }
+        }
+    });
+    output.Precede(project, output.Add([&]() { WriteHeatmap(prefix + "_y_by_pipe.ppm", yByPipe, yBins, pipeBins); }));
+    output.Precede(project, output.Add([&]() { WriteHeatmap(prefix + "_speed_by_gap.ppm", speedByGap, speedBins, gapBins); }));
+    output.Precede(project, output.Add([&]() { WriteHeatmap(prefix + "_y_by_gap.ppm", yByGap, yBins, gapBins); }));
+    output.Run(jobs);
+    if (!csvWritten) {
+        return 1;
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("deathmap: %llu runs in %.3fs on %u threads, %.1fM runs/min\n",
+        (unsigned long long)records, seconds, jobs.ThreadCount(), seconds > 0.0 ? records / seconds * 60.0 / 1e6 : 0.0);
+    if (corruptSpans > 0) {
+        printf("deathmap: skipped %llu corrupt spans, %llu bytes\n", (unsigned long long)corruptSpans,
+            (unsigned long long)skippedBytes);
+    }
+    return 0;
+}
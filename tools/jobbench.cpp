@@ -0,0 +1,248 @@
+// jobbench: scaling and overhead benchmark for the job system.
+//
+// Usage: jobbench [--threads n] [--runs n] [--seconds s] [--golden dir] [--data dir]
+//
+// Batched simulation: --runs autopilot runs of --seconds simulated time each (a run
+// that dies restarts), spread over 1, 2, 4 ... --threads threads (default: every
+// hardware thread) with ParallelFor. Prints wall time, speedup and parallel
+// efficiency, and fails if any thread count ends on a different combined state hash.
+// Tiny jobs: a ParallelFor over 4M items with an almost empty body at grain 1, and a
+// task graph of 64 layers of 64 empty nodes, each layer waiting on the one before.
+// Prints the cost per item and per node, which is the job system's own overhead.
+// Replay verification (with --golden): every replay in the corpus is loaded and
+// verified against its final hash as a task graph, like replaygate without timing.
+// --data points at the game's Data/ directory for the player masks (default ./Data).
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../src/autopilot.h"
+#include "../src/jobsystem.h"
+#include "../src/replay.h"
+#include "../src/simulation.h"
+#include "spritemasks.h"
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+PlayerMasks playerMasks;
+
+double SecondsSince(Clock::time_point start)
+{
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// One autopilot run, restarted after every death; returns the hashes it ended runs on
+uint64_t SimulateRun(uint32_t seed, uint32_t ticks)
+{
+    Simulation simulation;
+    Autopilot autopilot(seed, 0.9f);
+    simulation.Reset(seed, SIM_RESET_SPAWN_IMMEDIATELY);
+    uint64_t hash = 0;
+    for (uint32_t tick = 0; tick < ticks; tick++) {
+        simulation.Step(autopilot.WantsFlap(simulation.State(), simulation.Config()));
+        if (simulation.State().gameOver) {
+            hash = hash * 31 + simulation.Hash();
+            simulation.Reset(seed + tick, SIM_RESET_SPAWN_IMMEDIATELY);
+        }
+    }
+    return hash * 31 + simulation.Hash();
+}
+
+// Returns false when the thread counts disagree on the result
+bool BenchBatchedSim(unsigned maxThreads, uint32_t runs, uint32_t ticks)
+{
+    printf("batched sim: %u runs x %u ticks\n", runs, ticks);
+    printf("%8s %10s %9s %11s %10s\n", "threads", "ms", "speedup", "efficiency", "stolen");
+    std::vector<uint64_t> hashes(runs);
+    double baseSeconds = 0.0;
+    uint64_t expected = 0;
+    bool consistent = true;
+    // Powers of two, then the full count
+    std::vector<unsigned> counts;
+    for (unsigned threads = 1; threads < maxThreads; threads *= 2) {
+        counts.push_back(threads);
+    }
+    counts.push_back(maxThreads);
+
+    for (unsigned threads : counts) {
+        JobSystem jobs(threads);
+        Clock::time_point start = Clock::now();
+        jobs.ParallelFor(runs, 1, [&](size_t begin, size_t end) {
+            for (size_t run = begin; run < end; run++) {
+                hashes[run] = SimulateRun((uint32_t)run + 1, ticks);
+            }
+        });
+        double seconds = SecondsSince(start);
+
+        uint64_t combined = 0;
+        for (uint64_t hash : hashes) {
+            combined = combined * 31 + hash;
+        }
+        if (threads == 1) {
+            baseSeconds = seconds;
+            expected = combined;
+        }
+        consistent &= combined == expected;
+        double speedup = baseSeconds / seconds;
+        printf("%8u %10.1f %8.2fx %10.0f%% %10llu%s\n", threads, seconds * 1000.0, speedup, speedup / threads * 100.0,
+            (unsigned long long)jobs.JobsStolen(), combined == expected ? "" : "  hash mismatch");
+    }
+    return consistent;
+}
+
+void BenchTinyJobs(unsigned threads)
+{
+    JobSystem jobs(threads);
+    const size_t items = 1 << 22;
+    std::vector<uint64_t> perThread(jobs.ThreadCount() * 8, 0);    // A cache line apart
+
+    Clock::time_point start = Clock::now();
+    jobs.ParallelFor(items, 1, [&](size_t begin, size_t end) {
+        perThread[jobs.CurrentThread() * 8] += end - begin;
+    });
+    double forSeconds = SecondsSince(start);
+    uint64_t covered = 0;
+    for (uint64_t count : perThread) {
+        covered += count;
+    }
+
+    const int layers = 64;
+    const int width = 64;
+    TaskGraph graph;
+    std::atomic<uint32_t> ran(0);
+    std::vector<TaskGraph::Node> previous;
+    for (int layer = 0; layer < layers; layer++) {
+        std::vector<TaskGraph::Node> current;
+        for (int i = 0; i < width; i++) {
+            TaskGraph::Node node = graph.Add([&ran]() { ran.fetch_add(1, std::memory_order_relaxed); });
+            for (TaskGraph::Node before : previous) {
+                if (before % width == (TaskGraph::Node)i || before % width == (TaskGraph::Node)((i + 1) % width)) {
+                    graph.Precede(before, node);
+                }
+            }
+            current.push_back(node);
+        }
+        previous.swap(current);
+    }
+    start = Clock::now();
+    graph.Run(jobs);
+    double graphSeconds = SecondsSince(start);
+
+    printf("tiny jobs on %u threads:\n", jobs.ThreadCount());
+    printf("  parallel for  %zu items  %8.2f ms  %6.2f ns/item%s\n", items, forSeconds * 1000.0,
+        forSeconds * 1e9 / items, covered == items ? "" : "  MISSED ITEMS");
+    printf("  task graph    %zu nodes  %8.2f ms  %6.0f ns/node%s\n", graph.Size(), graphSeconds * 1000.0,
+        graphSeconds * 1e9 / graph.Size(), ran.load() == graph.Size() ? "" : "  MISSED NODES");
+}
+
+// Returns the number of replays that failed to load or verify
+int VerifyCorpus(unsigned threads, const std::string& dir)
+{
+    std::vector<std::string> names;
+    std::ifstream corpus(dir + "/corpus.txt");
+    std::string line;
+    while (std::getline(corpus, line)) {
+        if (!line.empty() && line[0] != '#') {
+            names.push_back(line);
+        }
+    }
+
+    JobSystem jobs(threads);
+    std::vector<Replay> replays(names.size());
+    std::vector<int> results(names.size(), 0);     // 1 verified, -1 failed to load
+    std::vector<uint32_t> ticks(names.size(), 0);
+    std::atomic<int> failures(0);
+
+    TaskGraph graph;
+    TaskGraph::Node summary = graph.Add([&]() {
+        for (size_t i = 0; i < names.size(); i++) {
+            printf("  %-14s %7u ticks  %s\n", names[i].c_str(), ticks[i],
+                results[i] > 0 ? "ok" : (results[i] < 0 ? "FAIL cannot load" : "FAIL hash mismatch"));
+        }
+    });
+    for (size_t i = 0; i < names.size(); i++) {
+        TaskGraph::Node load = graph.Add([&, i]() {
+            if (!replays[i].Load(dir + "/" + names[i])) {
+                results[i] = -1;
+            }
+        });
+        TaskGraph::Node verify = graph.Add([&, i]() {
+            if (results[i] < 0) {
+                failures++;
+                return;
+            }
+            Simulation simulation;
+            simulation.SetPlayerMasks(&playerMasks.eyesOpen, &playerMasks.eyesClosed);
+            ReplayPlayer player(replays[i], simulation);
+            while (!player.Finished()) {
+                player.Step();
+            }
+            ticks[i] = simulation.State().tick;
+            results[i] = player.Verify() ? 1 : 0;
+            if (results[i] == 0) {
+                failures++;
+            }
+        });
+        graph.Precede(load, verify);
+        graph.Precede(verify, summary);
+    }
+
+    printf("replay verification, %zu replays on %u threads:\n", names.size(), jobs.ThreadCount());
+    Clock::time_point start = Clock::now();
+    graph.Run(jobs);
+    printf("  %.1f ms, %d failure(s)\n", SecondsSince(start) * 1000.0, failures.load());
+    return names.empty() ? 1 : failures.load();
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+    uint32_t runs = 64;
+    float seconds = 60.0f;
+    std::string golden;
+    std::string dataDir = "Data";
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            threads = (unsigned)std::max(1, atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--runs") == 0 && i + 1 < argc) {
+            runs = (uint32_t)std::max(1, atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc) {
+            seconds = std::max(0.1f, (float)atof(argv[++i]));
+        } else if (strcmp(argv[i], "--golden") == 0 && i + 1 < argc) {
+            golden = argv[++i];
+        } else if (strcmp(argv[i], "--data") == 0 && i + 1 < argc) {
+            dataDir = argv[++i];
+        } else {
+            fprintf(stderr, "usage: jobbench [--threads n] [--runs n] [--seconds s] [--golden dir] [--data dir]\n");
+            return 2;
+        }
+    }
+
+    int failures = 0;
+    if (!BenchBatchedSim(threads, runs, (uint32_t)(seconds * simTickRate))) {
+        failures++;
+    }
+    BenchTinyJobs(threads);
+    if (!golden.empty()) {
+        if (!LoadPlayerMasks(dataDir, (int)SimConfig().playerSize, playerMasks)) {
+            fprintf(stderr, "cannot build player masks from %s, use --data\n", dataDir.c_str());
+            return 2;
+        }
+        failures += VerifyCorpus(threads, golden);
+    }
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,389 @@
+// mixbench: cost of the audio thread's work per device buffer.
+//
+// Usage: mixbench [--rate hz] [--frames n] [--buffers n]
+//
+// First checks that the SIMD kernels give bit-identical results to the plain loops,
+// then times each kernel on its own and the whole AudioMixer::Mix with 0 to 16 busy
+// voices, with the music ducked and with the low-pass gliding and fully closed.
+// Times are per buffer of --frames frames (default 512) at --rate (default 48000),
+// over --buffers buffers (default 20000): the mean, the 99th percentile and the worst
+// buffer, and the share of the buffer's playback time the mean mix takes.
+//
+// The music time-stretch is checked too: a tempo of 1 must pass the input through,
+// a stretched tone must keep its pitch and the input must be consumed at the tempo.
+// It is then timed at steady and gliding tempos against TimeStretch::budgetShare of
+// the buffer, failing when the 99th percentile is over, and fed by a simulated game
+// thread that stalls, to show which hitches the music FIFO rides out.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "../src/audiomixer.h"
+#include "../src/timestretch.h"
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+uint32_t noiseState = 0x9E3779B9u;
+
+float Noise()
+{
+    noiseState ^= noiseState << 13;
+    noiseState ^= noiseState >> 17;
+    noiseState ^= noiseState << 5;
+    return (float)(noiseState & 0xFFFF) / 32768.0f - 1.0f;
+}
+
+void FillNoise(float* samples, size_t count, float level)
+{
+    for (size_t i = 0; i < count; i++) {
+        samples[i] = Noise() * level;
+    }
+}
+
+// Odd lengths and offsets so the scalar tails and unaligned loads are covered
+bool CheckKernels()
+{
+    bool ok = true;
+    const uint32_t lengths[] = { 0, 1, 3, 4, 5, 127, 512, 1021 };
+    for (uint32_t frames : lengths) {
+        std::vector<float> in(frames + 1);
+        std::vector<float> simd(2 * frames + 2);
+        FillNoise(in.data(), in.size(), 1.0f);
+        FillNoise(simd.data(), simd.size(), 0.5f);
+        std::vector<float> scalar = simd;
+
+        MixMonoToStereo(simd.data() + 1, in.data() + 1, frames, 0.8f, 0.3f);
+        MixMonoToStereoScalar(scalar.data() + 1, in.data() + 1, frames, 0.8f, 0.3f);
+        ok &= memcmp(simd.data(), scalar.data(), simd.size() * sizeof(float)) == 0;
+
+        ScaleStereo(simd.data() + 1, frames, 0.9f, 0.25f);
+        ScaleStereoScalar(scalar.data() + 1, frames, 0.9f, 0.25f);
+        ok &= memcmp(simd.data(), scalar.data(), simd.size() * sizeof(float)) == 0;
+    }
+    printf("kernels: SIMD and scalar results %s\n", ok ? "identical" : "DIFFER");
+    return ok;
+}
+
+template <typename Body>
+double NsPerCall(uint32_t calls, const Body& body)
+{
+    Clock::time_point start = Clock::now();
+    for (uint32_t i = 0; i < calls; i++) {
+        body();
+    }
+    return std::chrono::duration<double, std::nano>(Clock::now() - start).count() / calls;
+}
+
+void BenchKernels(uint32_t frames, uint32_t buffers)
+{
+    std::vector<float> in(frames);
+    std::vector<float> out(2 * frames);
+    FillNoise(in.data(), in.size(), 1.0f);
+    FillNoise(out.data(), out.size(), 0.1f);
+    double mixSimd = NsPerCall(buffers, [&]() { MixMonoToStereo(out.data(), in.data(), frames, 0.5f, -0.5f); });
+    double mixScalar = NsPerCall(buffers, [&]() { MixMonoToStereoScalar(out.data(), in.data(), frames, 0.5f, -0.5f); });
+    // Ramps around 1, so scaling the same buffer over and over doesn't decay it to denormals
+    double scaleSimd = NsPerCall(buffers, [&]() { ScaleStereo(out.data(), frames, 1.0001f, 0.9999f); });
+    double scaleScalar = NsPerCall(buffers, [&]() { ScaleStereoScalar(out.data(), frames, 1.0001f, 0.9999f); });
+    printf("%-24s %10s %10s %8s\n", "kernel, ns per buffer", "simd", "scalar", "speedup");
+    printf("%-24s %10.0f %10.0f %7.2fx\n", "voice mono to stereo", mixSimd, mixScalar, mixScalar / mixSimd);
+    printf("%-24s %10.0f %10.0f %7.2fx\n", "gain ramp", scaleSimd, scaleScalar, scaleScalar / scaleSimd);
+}
+
+struct Scenario {
+    const char* name;
+    uint32_t voices;
+    bool ducked;
+    int muffle;         // 0 open, 1 gliding (toggled every few buffers), 2 closed
+};
+
+void BenchMixer(uint32_t rate, uint32_t frames, uint32_t buffers)
+{
+    const Scenario scenarios[] = {
+        { "music only", 0, false, 0 },
+        { "1 voice", 1, false, 0 },
+        { "4 voices", 4, false, 0 },
+        { "16 voices", 16, false, 0 },
+        { "16 voices, ducked", 16, true, 0 },
+        { "16 voices, low-pass glide", 16, true, 1 },
+        { "16 voices, low-pass", 16, true, 2 },
+    };
+    double bufferNs = 1e9 * frames / rate;
+    printf("mixer at %u Hz, %u frames per buffer (%.2f ms):\n", rate, frames, bufferNs / 1e6);
+    printf("%-28s %10s %10s %10s %9s\n", "", "mean ns", "p99 ns", "worst ns", "of buffer");
+
+    std::vector<float> music(2 * frames);
+    FillNoise(music.data(), music.size(), 0.1f);
+    std::vector<float> buffer(2 * frames);
+
+    for (const Scenario& scenario : scenarios) {
+        AudioMixer mixer(rate);
+        // Clips a second long, so a voice restarts about once a second like real effects
+        for (uint32_t slot = 0; slot < 4; slot++) {
+            AudioClip* clip = new AudioClip(rate);
+            FillNoise(clip->samples, clip->frames, 0.2f);
+            mixer.SetClip(slot, clip);
+        }
+        if (scenario.ducked) {
+            mixer.Duck(0.25f);
+        }
+        if (scenario.muffle == 2) {
+            mixer.SetMuffled(true);
+        }
+        uint32_t restartEvery = std::max(1u, rate / frames);
+        std::vector<double> times(buffers);
+        double total = 0.0;
+        for (uint32_t i = 0; i < buffers; i++) {
+            if (i % restartEvery == 0) {
+                for (uint32_t voice = 0; voice < scenario.voices; voice++) {
+                    mixer.Play(voice % 4, 0.5f, (float)voice / AudioMixer::maxVoices * 2.0f - 1.0f);
+                }
+            }
+            if (scenario.muffle == 1 && i % 8 == 0) {
+                mixer.SetMuffled((i / 8) % 2 == 0);
+            }
+            memcpy(buffer.data(), music.data(), music.size() * sizeof(float));
+            Clock::time_point start = Clock::now();
+            mixer.Mix(buffer.data(), frames);
+            double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+            times[i] = ns;
+            total += ns;
+        }
+        std::sort(times.begin(), times.end());
+        double mean = total / buffers;
+        printf("%-28s %10.0f %10.0f %10.0f %8.3f%%\n", scenario.name, mean, times[(size_t)(buffers * 0.99)],
+            times.back(), mean / bufferNs * 100.0);
+    }
+}
+
+// Tones and a little noise, so the similarity search has something to lock onto
+std::vector<float> MusicLike(uint32_t rate, uint32_t frames)
+{
+    std::vector<float> samples(2 * (size_t)frames);
+    const double pi = 3.14159265358979;
+    for (uint32_t i = 0; i < frames; i++) {
+        double t = (double)i / rate;
+        double beat = 0.5 + 0.5 * std::cos(2.0 * pi * 2.0 * t);
+        float tone = (float)(0.3 * std::sin(2.0 * pi * 220.0 * t) + 0.2 * beat * std::sin(2.0 * pi * 330.0 * t)
+            + 0.1 * std::sin(2.0 * pi * 554.37 * t));
+        samples[2 * i] = tone + Noise() * 0.05f;
+        samples[2 * i + 1] = tone * 0.8f + Noise() * 0.05f;
+    }
+    return samples;
+}
+
+std::vector<float> Tone(uint32_t rate, uint32_t frames, double hz)
+{
+    std::vector<float> samples(2 * (size_t)frames);
+    for (uint32_t i = 0; i < frames; i++) {
+        samples[2 * i] = samples[2 * i + 1] = (float)(0.5 * std::sin(2.0 * 3.14159265358979 * hz * i / rate));
+    }
+    return samples;
+}
+
+// Runs the stretcher over the whole input, returning its stereo output
+std::vector<float> Stretch(TimeStretch& stretch, const std::vector<float>& samples, uint32_t frames)
+{
+    uint32_t inputFrames = (uint32_t)(samples.size() / 2);
+    AudioFifo fifo(inputFrames);
+    fifo.Write(samples.data(), inputFrames);
+    std::vector<float> out;
+    std::vector<float> buffer(2 * frames);
+    uint64_t underruns = stretch.Underruns();
+    while (stretch.Underruns() == underruns) {
+        stretch.Process(fifo, buffer.data(), frames);
+        out.insert(out.end(), buffer.begin(), buffer.end());
+    }
+    return out;
+}
+
+double ZeroCrossingHz(const std::vector<float>& samples, uint32_t rate, uint32_t from, uint32_t to)
+{
+    uint32_t crossings = 0;
+    for (uint32_t i = from + 1; i < to; i++) {
+        crossings += (samples[2 * (i - 1)] < 0.0f) != (samples[2 * i] < 0.0f);
+    }
+    return crossings / 2.0 / ((double)(to - from) / rate);
+}
+
+bool CheckStretch(uint32_t rate, uint32_t frames)
+{
+    bool ok = true;
+    uint32_t seconds = 4;
+
+    {
+        std::vector<float> in = MusicLike(rate, seconds * rate);
+        TimeStretch stretch(rate);
+        std::vector<float> out = Stretch(stretch, in, frames);
+        // Up to the hop the output fades in, past the input's end it runs dry
+        float worst = 0.0f;
+        uint32_t from = stretch.LatencyFrames();
+        uint32_t to = (uint32_t)std::min(out.size(), in.size()) / 2 - 2 * stretch.LatencyFrames();
+        for (uint32_t i = 2 * from; i < 2 * to; i++) {
+            worst = std::max(worst, std::fabs(out[i] - in[i]));
+        }
+        bool passed = worst < 1e-4f;
+        printf("stretch: tempo 1 passes the input through, worst difference %.2g %s\n", worst, passed ? "ok" : "FAILED");
+        ok &= passed;
+    }
+
+    const float tempos[] = { 0.8f, 1.15f, 1.3f, 2.0f };
+    for (float tempo : tempos) {
+        std::vector<float> in = Tone(rate, seconds * rate, 440.0);
+        TimeStretch stretch(rate);
+        stretch.SetTempo(tempo);
+        std::vector<float> out = Stretch(stretch, in, frames);
+        uint32_t produced = (uint32_t)(out.size() / 2) - (uint32_t)(stretch.SilentFrames());
+        double hz = ZeroCrossingHz(out, rate, rate / 10, produced - rate / 10);
+        double speed = (double)stretch.FramesConsumed() / produced;
+        bool passed = std::fabs(hz / 440.0 - 1.0) < 0.01 && std::fabs(speed / tempo - 1.0) < 0.02;
+        printf("stretch: tempo %.2f keeps 440 Hz at %.1f Hz, consumes input at %.3fx %s\n", tempo, hz, speed,
+            passed ? "ok" : "FAILED");
+        ok &= passed;
+    }
+
+    {
+        TimeStretch stretch(rate);
+        AudioFifo empty(frames);
+        std::vector<float> buffer(2 * frames, 1.0f);
+        stretch.Process(empty, buffer.data(), frames);
+        bool silent = std::all_of(buffer.begin(), buffer.end(), [](float sample) { return sample == 0.0f; });
+        bool passed = silent && stretch.Underruns() == 1 && stretch.SilentFrames() == frames;
+        printf("stretch: a dry FIFO gives silence and counts an underrun %s\n", passed ? "ok" : "FAILED");
+        ok &= passed;
+    }
+    return ok;
+}
+
+bool BenchStretch(uint32_t rate, uint32_t frames, uint32_t buffers)
+{
+    struct StretchScenario {
+        const char* name;
+        float from;
+        float to;       // Tempo glides from one to the other over the run
+    };
+    const StretchScenario scenarios[] = {
+        { "tempo 1", 1.0f, 1.0f },
+        { "tempo 1.15", 1.15f, 1.15f },
+        { "tempo 1.3", 1.3f, 1.3f },
+        { "tempo 2", 2.0f, 2.0f },
+        { "gliding 1 to 1.3", 1.0f, 1.3f },
+    };
+    double bufferNs = 1e9 * frames / rate;
+    double budgetNs = bufferNs * TimeStretch::budgetShare;
+    printf("music time-stretch at %u Hz, %u frames per buffer, budget %.0f ns (%.0f%%):\n", rate, frames, budgetNs,
+        TimeStretch::budgetShare * 100.0f);
+    printf("%-28s %10s %10s %10s %9s\n", "", "mean ns", "p99 ns", "worst ns", "of buffer");
+
+    // A few seconds looped, topped up before every buffer like the game does each frame
+    std::vector<float> music = MusicLike(rate, 4 * rate);
+    uint32_t musicFrames = (uint32_t)(music.size() / 2);
+    bool ok = true;
+    for (const StretchScenario& scenario : scenarios) {
+        TimeStretch stretch(rate);
+        AudioFifo fifo(rate);
+        uint32_t position = 0;
+        std::vector<float> buffer(2 * frames);
+        std::vector<double> times(buffers);
+        double total = 0.0;
+        for (uint32_t i = 0; i < buffers; i++) {
+            stretch.SetTempo(scenario.from + (scenario.to - scenario.from) * i / buffers);
+            while (fifo.Free() > 0) {
+                uint32_t count = std::min(fifo.Free(), musicFrames - position);
+                fifo.Write(music.data() + 2 * position, count);
+                position = (position + count) % musicFrames;
+            }
+            Clock::time_point start = Clock::now();
+            stretch.Process(fifo, buffer.data(), frames);
+            double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+            times[i] = ns;
+            total += ns;
+        }
+        std::sort(times.begin(), times.end());
+        double mean = total / buffers;
+        double p99 = times[(size_t)(buffers * 0.99)];
+        printf("%-28s %10.0f %10.0f %10.0f %8.3f%%%s\n", scenario.name, mean, p99, times.back(), mean / bufferNs * 100.0,
+            p99 > budgetNs ? "  OVER BUDGET" : "");
+        ok &= p99 <= budgetNs && stretch.Underruns() == 0;
+    }
+    return ok;
+}
+
+// Game frames top the FIFO up at 60 Hz while the audio thread pulls buffers; one
+// frame stalls. Runs in simulated time, so only the underrun counts matter.
+void BenchStalls(uint32_t rate, uint32_t frames)
+{
+    const float fifoSeconds = 0.5f;     // Like the game's music FIFO
+    const float tempo = 1.3f;
+    const double stalls[] = { 0.1, 0.25, 0.35, 0.5, 1.0 };
+    std::vector<float> music = MusicLike(rate, 2 * rate);
+    uint32_t musicFrames = (uint32_t)(music.size() / 2);
+    printf("music FIFO of %.1f s at tempo %.1f, one game frame stalls:\n", fifoSeconds, tempo);
+    printf("%-28s %10s %13s\n", "", "underruns", "silent frames");
+    for (double stall : stalls) {
+        TimeStretch stretch(rate);
+        stretch.SetTempo(tempo);
+        AudioFifo fifo((uint32_t)(fifoSeconds * rate));
+        std::vector<float> buffer(2 * frames);
+        uint32_t position = 0;
+        double gameTime = 0.0;
+        double audioTime = 0.0;
+        for (int frame = 0; frame < 300; frame++) {
+            while (fifo.Free() > 0) {
+                uint32_t count = std::min(fifo.Free(), musicFrames - position);
+                fifo.Write(music.data() + 2 * position, count);
+                position = (position + count) % musicFrames;
+            }
+            gameTime += frame == 150 ? stall : 1.0 / 60.0;
+            for (; audioTime < gameTime; audioTime += (double)frames / rate) {
+                stretch.Process(fifo, buffer.data(), frames);
+            }
+        }
+        char name[32];
+        snprintf(name, sizeof(name), "%.0f ms stall", stall * 1000.0);
+        printf("%-28s %10llu %13llu\n", name, (unsigned long long)stretch.Underruns(),
+            (unsigned long long)stretch.SilentFrames());
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    uint32_t rate = 48000;
+    uint32_t frames = 512;
+    uint32_t buffers = 20000;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--rate") == 0 && i + 1 < argc) {
+            rate = (uint32_t)std::max(8000, atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+            frames = (uint32_t)std::max(1, atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--buffers") == 0 && i + 1 < argc) {
+            buffers = (uint32_t)std::max(1, atoi(argv[++i]));
+        } else {
+            fprintf(stderr, "usage: mixbench [--rate hz] [--frames n] [--buffers n]\n");
+            return 2;
+        }
+    }
+
+    if (!CheckKernels()) {
+        return 1;
+    }
+    BenchKernels(frames, buffers);
+    BenchMixer(rate, frames, buffers);
+    if (!CheckStretch(rate, frames)) {
+        return 1;
+    }
+    bool withinBudget = BenchStretch(rate, frames, buffers);
+    BenchStalls(rate, frames);
+    return withinBudget ? 0 : 1;
+}
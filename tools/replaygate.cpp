@@ -0,0 +1,516 @@
+// replaygate: golden-replay performance regression gate.
+//
+// Usage: replaygate [--update] [--tolerance percent] [--repeat n] [--data dir]
+//                   [--profile out.folded[:hz]] golden_dir
+//        replaygate --generate [--data dir] golden_dir
+//
+// golden_dir holds a corpus.txt listing replay files (one per line) and a
+// baseline.txt with the reference cost of each replay. Every replay is played
+// through the Simulation and the draw-recording path exactly as the game runs them.
+// The gate fails when
+//   - a replay no longer reaches its recorded final state hash or one of its
+//     keyframes' hashes (behaviour change),
+//   - seeking to a tick lands on a different state than playing up to it,
+//   - a run recorded the way the game's step mode records it (stepped back, then
+//     flapped) doesn't play back from its saved file to the state it ended in,
+//   - ns/tick exceeds the baseline by more than the tolerance (default 25%),
+//   - heap allocations per replay exceed the baseline (allocations are deterministic),
+//   - peak heap over the corpus exceeds the low quality tier's heap budget.
+// --update rewrites baseline.txt from the current build instead of comparing.
+// --generate records a fresh corpus with the autopilot; run it only when the
+// simulation changes on purpose, then --update the baseline.
+// --data points at the game's Data/ directory, whose player sprites provide the
+// pixel collision masks (default: ./Data).
+// --profile samples the timed rounds with the sampling profiler (Linux) and writes
+// folded stacks for flamegraph.pl, like HOVERCAT_PROFILE does for the game.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "../src/alloctrack.h"
+#include "../src/autopilot.h"
+#include "../src/drawlist.h"
+#include "../src/framestepper.h"
+#include "../src/memorybudget.h"
+#include "../src/replay.h"
+#include "../src/sampler.h"
+#include "../src/scenery.h"
+#include "../src/simulation.h"
+#include "spritemasks.h"
+
+namespace {
+
+// Texture sizes of the shipped Data/ assets, so the recorded quads match the game
+SceneTextureSizes GoldenTextureSizes()
+{
+    SceneTextureSizes sizes;
+    sizes.width[DRAW_TEXTURE_SKY] = 1;
+    sizes.height[DRAW_TEXTURE_SKY] = skyHeight;
+    sizes.width[DRAW_TEXTURE_PIPE] = 52;
+    sizes.height[DRAW_TEXTURE_PIPE] = 320;
+    sizes.width[DRAW_TEXTURE_PLAYER] = 640;
+    sizes.height[DRAW_TEXTURE_PLAYER] = 640;
+    sizes.width[DRAW_TEXTURE_PLAYER_EYES_CLOSED] = 640;
+    sizes.height[DRAW_TEXTURE_PLAYER_EYES_CLOSED] = 640;
+    return sizes;
+}
+
+PlayerMasks playerMasks;
+
+void AttachMasks(Simulation& simulation)
+{
+    simulation.SetPlayerMasks(&playerMasks.eyesOpen, &playerMasks.eyesClosed);
+}
+
+struct GoldenRun {
+    uint32_t seed;
+    uint16_t resetFlags;
+    float skill;
+    uint32_t maxTicks;      // Runs that survive this long are cut off here
+};
+
+// Early deaths, mid-game runs and runs that reach the max-speed phase (~90s in)
+const GoldenRun goldenRuns[] = {
+    { 101, SIM_RESET_SPAWN_IMMEDIATELY | SIM_RESET_PIXEL_COLLISION, 0.2f, 120 * simTickRate },
+    { 202, SIM_RESET_PIXEL_COLLISION, 0.35f, 120 * simTickRate },
+    { 303, SIM_RESET_PIXEL_COLLISION, 0.6f, 120 * simTickRate },
+    { 404, SIM_RESET_SPAWN_IMMEDIATELY | SIM_RESET_PIXEL_COLLISION, 0.8f, 120 * simTickRate },
+    { 505, SIM_RESET_PIXEL_COLLISION, 1.0f, 120 * simTickRate },
+    { 606, SIM_RESET_PIXEL_COLLISION, 1.0f, 120 * simTickRate },
+    { 707, SIM_RESET_SPAWN_IMMEDIATELY | SIM_RESET_PIXEL_COLLISION, 1.0f, 120 * simTickRate },
+    { 808, 0, 0.9f, 120 * simTickRate },    // Collision box, for builds without sprites
+};
+
+struct Measurement {
+    bool verified = false;
+    uint32_t ticks = 0;
+    double nsPerTick = 0.0;
+    uint64_t allocations = 0;
+    uint64_t frameHash = 0;
+};
+
+struct Baseline {
+    double nsPerTick;
+    uint64_t allocations;
+};
+
+// Plays one replay through simulation + scene recording, as the game does every frame
+Measurement PlayOnce(const Replay& replay, Simulation& simulation, DrawList& list, const SceneTextureSizes& sizes)
+{
+    Measurement result;
+    float backgroundScrollX = 0.0f;
+    SceneryResidency scenery;       // Every needed chunk counts as streamed in
+    scenery.Clear();
+    uint64_t frameHash = 0;
+
+    uint64_t allocationsBefore = GetAllocationCount();
+    auto start = std::chrono::steady_clock::now();
+
+    ReplayPlayer player(replay, simulation);
+    while (!player.Finished()) {
+        player.Step();
+        const SimState& state = simulation.State();
+        backgroundScrollX += state.pipeSpeed * 0.2f * simTickDt;
+        scenery.FillNeeded(backgroundScrollX, simulation.Config().width);
+        RecordScene(list, state, simulation.Config(), sizes, scenery, backgroundScrollX,
+            simulation.Config().width, simulation.Config().height);
+        frameHash ^= HashDrawList(list) + state.tick;
+    }
+
+    auto end = std::chrono::steady_clock::now();
+    result.allocations = GetAllocationCount() - allocationsBefore;
+    result.verified = player.Verify();
+    result.ticks = simulation.State().tick;
+    result.frameHash = frameHash;
+    double ns = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+    result.nsPerTick = result.ticks > 0 ? ns / result.ticks : 0.0;
+    return result;
+}
+
+// Times the whole corpus round-robin and keeps each replay's best round, so a
+// noisy stretch on the machine can't hit the same replay every time. Every round
+// gets freshly allocated state at a different heap offset, because an unlucky
+// placement of the hot data alone can cost a third more per tick.
+std::vector<Measurement> MeasureCorpus(const std::vector<Replay>& replays, int rounds)
+{
+    SceneTextureSizes sizes = GoldenTextureSizes();
+    std::vector<Measurement> best;
+    for (int round = 0; round <= rounds; round++) {
+        std::vector<char> shift(64 + (size_t)round * 272);
+        Simulation simulation;
+        DrawList list;
+        AttachMasks(simulation);
+        for (size_t i = 0; i < replays.size(); i++) {
+            // Untimed pass first so the containers are warm
+            if (round == 0) {
+                best.push_back(PlayOnce(replays[i], simulation, list, sizes));
+                continue;
+            }
+            Measurement run = PlayOnce(replays[i], simulation, list, sizes);
+            if (run.frameHash != best[i].frameHash || !run.verified) {
+                best[i].verified = false;
+            }
+            best[i].nsPerTick = round == 1 ? run.nsPerTick : std::min(best[i].nsPerTick, run.nsPerTick);
+            best[i].allocations = run.allocations;
+        }
+    }
+    return best;
+}
+
+// Seeks backwards through every replay, to just before and halfway past each
+// keyframe, and checks each lands on the state linear playback reaches there.
+// Returns the number of seeks that didn't.
+int CheckSeeks(const std::vector<Replay>& replays, const std::vector<std::string>& names)
+{
+    int failures = 0;
+    size_t seeks = 0;
+    double seconds = 0.0;
+    for (size_t i = 0; i < replays.size(); i++) {
+        const Replay& replay = replays[i];
+        std::vector<uint32_t> targets;
+        for (const ReplayKeyframe& keyframe : replay.keyframes) {
+            targets.push_back(keyframe.tick - 1);
+            targets.push_back(keyframe.tick + replay.keyframeInterval / 2);
+        }
+        targets.push_back(replay.tickCount);
+        std::sort(targets.begin(), targets.end());
+        targets.erase(std::unique(targets.begin(), targets.end()), targets.end());
+
+        Simulation linear;
+        AttachMasks(linear);
+        ReplayPlayer linearPlayer(replay, linear);
+        std::vector<uint64_t> expected;
+        for (uint32_t target : targets) {
+            while (linear.State().tick < target && !linearPlayer.Finished()) {
+                linearPlayer.Step();
+            }
+            expected.push_back(linear.Hash());
+        }
+
+        Simulation simulation;
+        AttachMasks(simulation);
+        ReplayPlayer player(replay, simulation);
+        player.Seek(replay.tickCount);
+        auto start = std::chrono::steady_clock::now();
+        for (size_t t = targets.size(); t-- > 0;) {
+            if (!player.Seek(targets[t]) || simulation.Hash() != expected[t]) {
+                printf("%-14s FAIL seek to tick %u\n", names[i].c_str(), targets[t]);
+                failures++;
+            }
+        }
+        seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        seeks += targets.size();
+    }
+    printf("%zu backward seeks, %.1f us each%s\n", seeks, seeks > 0 ? seconds * 1e6 / seeks : 0.0,
+        failures > 0 ? "  FAIL seek mismatch" : "");
+    return failures;
+}
+
+// Re-records every replay through Replay::RecordStep as the game's step mode does:
+// follows it to halfway, steps back, flaps on the first tick after and carries on
+// with its inputs. The saved file has to play back to the state the recording ended
+// in. Returns the number of replays that didn't.
+int CheckStepBack(const std::vector<Replay>& replays, const std::vector<std::string>& names, const std::string& dir)
+{
+    const int backTicks = 60;
+    const std::string path = dir + "/stepback.tmp";
+    int failures = 0;
+    for (size_t i = 0; i < replays.size(); i++) {
+        const Replay& golden = replays[i];
+        Simulation simulation;
+        AttachMasks(simulation);
+        FrameStepper stepper;
+        Replay recorded;
+        simulation.Reset(golden.seed, golden.resetFlags);
+        recorded.Begin(golden.seed, golden.resetFlags);
+        stepper.Reset(simulation);
+
+        while (simulation.State().tick < golden.tickCount / 2) {
+            recorded.RecordStep(simulation, stepper, golden.FlapsOn(simulation.State().tick + 1));
+        }
+        for (int back = 0; back < backTicks && stepper.StepBack(simulation); back++) {
+        }
+        recorded.RecordStep(simulation, stepper, true);
+        while (!simulation.State().gameOver && simulation.State().tick < golden.tickCount) {
+            recorded.RecordStep(simulation, stepper, golden.FlapsOn(simulation.State().tick + 1));
+        }
+        recorded.Finish(simulation);
+
+        Replay saved;
+        bool ok = recorded.Save(path) && saved.Load(path);
+        if (ok) {
+            Simulation playback;
+            AttachMasks(playback);
+            ReplayPlayer player(saved, playback);
+            while (!player.Finished()) {
+                player.Step();
+            }
+            ok = player.Verify();
+        }
+        if (!ok) {
+            printf("%-14s FAIL stepped-back recording doesn't play back\n", names[i].c_str());
+            failures++;
+        }
+    }
+    remove(path.c_str());
+    printf("%zu stepped-back recordings replayed%s\n", replays.size(), failures > 0 ? "  FAIL step back" : "");
+    return failures;
+}
+
+std::vector<std::string> ReadCorpus(const std::string& dir)
+{
+    std::vector<std::string> names;
+    std::ifstream file(dir + "/corpus.txt");
+    std::string line;
+    while (std::getline(file, line)) {
+        if (!line.empty() && line[0] != '#') {
+            names.push_back(line);
+        }
+    }
+    return names;
+}
+
+std::map<std::string, Baseline> ReadBaseline(const std::string& dir)
+{
+    std::map<std::string, Baseline> baseline;
+    std::ifstream file(dir + "/baseline.txt");
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        char name[256];
+        double nsPerTick;
+        unsigned long long allocations;
+        if (sscanf(line.c_str(), "%255s %lf %llu", name, &nsPerTick, &allocations) == 3) {
+            baseline[name] = { nsPerTick, (uint64_t)allocations };
+        }
+    }
+    return baseline;
+}
+
+int Generate(const std::string& dir)
+{
+    FILE* corpus = fopen((dir + "/corpus.txt").c_str(), "w");
+    if (corpus == nullptr) {
+        fprintf(stderr, "cannot write %s/corpus.txt\n", dir.c_str());
+        return 1;
+    }
+    fprintf(corpus, "# Golden replays, regenerate with: replaygate --generate <dir>\n");
+
+    for (const GoldenRun& run : goldenRuns) {
+        Simulation simulation;
+        AttachMasks(simulation);
+        Autopilot autopilot(run.seed * 7919u, run.skill);
+        if (run.resetFlags & SIM_RESET_PIXEL_COLLISION) {
+            // Aim with the sprite's solid bounds instead of the collision box
+            const CollisionMask& mask = playerMasks.eyesOpen;
+            float half = mask.Size() / 2.0f;
+            autopilot.SetPlayerExtent(half - mask.MinX(), half - mask.MinY(), mask.MaxX() + 1 - half, mask.MaxY() + 1 - half);
+        }
+        Replay replay;
+        simulation.Reset(run.seed, run.resetFlags);
+        replay.Begin(run.seed, run.resetFlags);
+        while (!simulation.State().gameOver && simulation.State().tick < run.maxTicks) {
+            bool flap = autopilot.WantsFlap(simulation.State(), simulation.Config());
+            if (flap) {
+                replay.RecordFlap(simulation.State().tick + 1);
+            }
+            simulation.Step(flap);
+            replay.RecordKeyframe(simulation);
+        }
+        replay.Finish(simulation);
+
+        char name[64];
+        snprintf(name, sizeof(name), "seed%u.hkrp", run.seed);
+        if (!replay.Save(dir + "/" + name)) {
+            fprintf(stderr, "cannot write %s/%s\n", dir.c_str(), name);
+            fclose(corpus);
+            return 1;
+        }
+        fprintf(corpus, "%s\n", name);
+        printf("%-14s %6u ticks  score %3d  speed %6.1f  %s\n", name, replay.tickCount, replay.finalScore,
+            simulation.State().pipeSpeed, simulation.State().gameOver ? "died" : "survived");
+    }
+    fclose(corpus);
+    return 0;
+}
+
+void PrintUsage()
+{
+    fprintf(stderr, "Usage: replaygate [--update] [--tolerance percent] [--repeat n] [--data dir]\n"
+                    "                  [--profile out.folded[:hz]] golden_dir\n"
+                    "       replaygate --generate [--data dir] golden_dir\n");
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    bool update = false;
+    bool generate = false;
+    double tolerance = 25.0;
+    int repeat = 15;
+    std::string dir;
+    std::string dataDir = "Data";
+    const char* profile = nullptr;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--update") == 0) {
+            update = true;
+        } else if (strcmp(argv[i], "--generate") == 0) {
+            generate = true;
+        } else if (strcmp(argv[i], "--tolerance") == 0 && i + 1 < argc) {
+            tolerance = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--repeat") == 0 && i + 1 < argc) {
+            repeat = std::max(1, atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--data") == 0 && i + 1 < argc) {
+            dataDir = argv[++i];
+        } else if (strcmp(argv[i], "--profile") == 0 && i + 1 < argc) {
+            profile = argv[++i];
+        } else if (argv[i][0] == '-') {
+            PrintUsage();
+            return 2;
+        } else {
+            dir = argv[i];
+        }
+    }
+    if (dir.empty()) {
+        PrintUsage();
+        return 2;
+    }
+    if (!LoadPlayerMasks(dataDir, (int)SimConfig().playerSize, playerMasks)) {
+        fprintf(stderr, "cannot build player masks from %s, use --data\n", dataDir.c_str());
+        return 2;
+    }
+    if (generate) {
+        return Generate(dir);
+    }
+    // The sample buffer stays live until Stop, so it comes straight off the peak below
+    uint64_t heapBeforeProfiler = GetHeapBytesTotal();
+    if (profile != nullptr && !SamplingProfiler::StartFromSetting(profile)) {
+        fprintf(stderr, "cannot start the sampling profiler with %s\n", profile);
+        return 2;
+    }
+    uint64_t profilerHeap = GetHeapBytesTotal() - heapBeforeProfiler;
+
+    std::vector<std::string> corpus = ReadCorpus(dir);
+    if (corpus.empty()) {
+        fprintf(stderr, "no replays listed in %s/corpus.txt\n", dir.c_str());
+        return 2;
+    }
+    std::map<std::string, Baseline> baseline = ReadBaseline(dir);
+    std::map<std::string, Measurement> results;
+
+    int failures = 0;
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<Replay> replays;
+    std::vector<std::string> names;
+    for (const std::string& name : corpus) {
+        Replay replay;
+        if (!replay.Load(dir + "/" + name)) {
+            printf("%-14s cannot load\n", name.c_str());
+            failures++;
+            continue;
+        }
+        replays.push_back(replay);
+        names.push_back(name);
+    }
+
+    // Let the CPU clock up before the timed rounds
+    while (!replays.empty() && std::chrono::steady_clock::now() - start < std::chrono::milliseconds(100)) {
+        MeasureCorpus(replays, 0);
+    }
+    SamplingProfiler::SetGameplayActive(true);
+    std::vector<Measurement> measurements = MeasureCorpus(replays, repeat);
+
+    // A slow result is only trusted once it reproduces: re-measure and keep the best
+    for (int retry = 0; retry < 2 && !update; retry++) {
+        bool slow = false;
+        for (size_t i = 0; i < names.size(); i++) {
+            auto found = baseline.find(names[i]);
+            slow |= found != baseline.end() && measurements[i].nsPerTick > found->second.nsPerTick * (1.0 + tolerance / 100.0);
+        }
+        if (!slow) {
+            break;
+        }
+        std::vector<Measurement> again = MeasureCorpus(replays, repeat);
+        for (size_t i = 0; i < names.size(); i++) {
+            measurements[i].nsPerTick = std::min(measurements[i].nsPerTick, again[i].nsPerTick);
+            measurements[i].verified = measurements[i].verified && again[i].verified;
+        }
+    }
+
+    SamplingProfiler::SetGameplayActive(false);
+
+    printf("%-14s %7s %10s %10s %7s %7s  %s\n", "replay", "ticks", "ns/tick", "baseline", "allocs", "base", "result");
+    for (size_t i = 0; i < names.size(); i++) {
+        const std::string& name = names[i];
+        const Measurement& m = measurements[i];
+        results[name] = m;
+
+        const char* verdict = "ok";
+        auto found = baseline.find(name);
+        if (!m.verified) {
+            verdict = "FAIL hash mismatch";
+        } else if (update) {
+            verdict = "updated";
+        } else if (found == baseline.end()) {
+            verdict = "FAIL no baseline";
+        } else if (m.allocations > found->second.allocations) {
+            verdict = "FAIL allocations";
+        } else if (m.nsPerTick > found->second.nsPerTick * (1.0 + tolerance / 100.0)) {
+            verdict = "FAIL slower";
+        }
+        if (strncmp(verdict, "FAIL", 4) == 0) {
+            failures++;
+        }
+
+        bool known = found != baseline.end();
+        printf("%-14s %7u %10.1f %10.1f %7llu %7llu  %s\n", name.c_str(), m.ticks, m.nsPerTick,
+            known ? found->second.nsPerTick : 0.0, (unsigned long long)m.allocations,
+            known ? (unsigned long long)found->second.allocations : 0ull, verdict);
+    }
+
+    failures += CheckSeeks(replays, names);
+
+    // The low tier budget is the one the mobile web build has to live within
+    uint64_t heapBudget = GetMemoryBudget(QUALITY_LOW).heap;
+    uint64_t peakHeap = GetPeakHeapBytes() - profilerHeap;
+    bool overBudget = peakHeap > heapBudget;
+    printf("peak heap %.1f KB of %.1f KB low tier budget%s\n", peakHeap / 1024.0, heapBudget / 1024.0,
+        overBudget ? "  FAIL heap budget" : "");
+    if (overBudget) {
+        failures++;
+    }
+    SamplingProfiler::Stop();
+    // After the heap check: the stepper's snapshot ring is the debugger's, not playback's
+    failures += CheckStepBack(replays, names, dir);
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("%zu replays in %.2fs, tolerance %.0f%%, %d failure(s)\n", corpus.size(), seconds, tolerance, failures);
+
+    if (update && failures == 0) {
+        FILE* file = fopen((dir + "/baseline.txt").c_str(), "w");
+        if (file == nullptr) {
+            fprintf(stderr, "cannot write %s/baseline.txt\n", dir.c_str());
+            return 1;
+        }
+        fprintf(file, "# replay ns_per_tick allocations, rewrite with: replaygate --update <dir>\n");
+        for (const auto& entry : results) {
+            fprintf(file, "%s %.1f %llu\n", entry.first.c_str(), entry.second.nsPerTick,
+                (unsigned long long)entry.second.allocations);
+        }
+        fclose(file);
+    }
+    return failures == 0 ? 0 : 1;
+}
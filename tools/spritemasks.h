@@ -0,0 +1,39 @@
+#pragma once
+
+// Player collision masks for the headless tools, built from the same Data/ sprites
+// the game uses. The PNGs are decoded with the stb_image copy bundled in raylib's
+// sources, so the tools still don't link raylib. Include from one file per tool.
+
+#include <string>
+
+#define STB_IMAGE_IMPLEMENTATION
+#define STBI_ONLY_PNG
+#include "stb_image.h"
+
+#include "../src/collisionmask.h"
+
+struct PlayerMasks {
+    CollisionMask eyesOpen;
+    CollisionMask eyesClosed;
+};
+
+inline bool LoadSpriteMask(const std::string& path, int size, CollisionMask& mask)
+{
+    int width = 0;
+    int height = 0;
+    int channels = 0;
+    unsigned char* pixels = stbi_load(path.c_str(), &width, &height, &channels, 4);
+    if (pixels == nullptr) {
+        return false;
+    }
+    bool ok = mask.Build(pixels, width, height, size);
+    stbi_image_free(pixels);
+    return ok && !mask.Empty();
+}
+
+// Both player masks at the given size; false if a sprite is missing
+inline bool LoadPlayerMasks(const std::string& dataDir, int size, PlayerMasks& masks)
+{
+    return LoadSpriteMask(dataDir + "/redkat_eyes_open.png", size, masks.eyesOpen)
+        && LoadSpriteMask(dataDir + "/redkat_eyes_closed.png", size, masks.eyesClosed);
+}
@@ -0,0 +1,149 @@
+// teledump: decodes a telemetry.bin file written by the game.
+//
+// Usage: teledump [--csv] [--type frame|input|state|hitch] telemetry.bin
+//
+// Default output is one human readable line per record; --csv writes
+// time_ns,frame,type,code,value0,value1 for spreadsheets and plotting scripts.
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "../src/telemetry.h"
+
+namespace {
+
+const char* TypeName(uint16_t type)
+{
+    switch (type) {
+        case TELEMETRY_FRAME: return "frame";
+        case TELEMETRY_INPUT: return "input";
+        case TELEMETRY_STATE: return "state";
+        case TELEMETRY_HITCH: return "hitch";
+        default: return "unknown";
+    }
+}
+
+const char* CodeName(uint16_t type, uint16_t code)
+{
+    if (type == TELEMETRY_INPUT) {
+        switch (code) {
+            case INPUT_FLAP: return "flap";
+            case INPUT_MUSIC_TOGGLE: return "music_toggle";
+            case INPUT_FULLSCREEN_TOGGLE: return "fullscreen_toggle";
+            case INPUT_PAUSE_TOGGLE: return "pause_toggle";
+        }
+    } else if (type == TELEMETRY_STATE) {
+        switch (code) {
+            case STATE_GAME_START: return "game_start";
+            case STATE_PAUSED: return "paused";
+            case STATE_RESUMED: return "resumed";
+            case STATE_FOCUS_LOST: return "focus_lost";
+            case STATE_FOCUS_GAINED: return "focus_gained";
+            case STATE_GAME_OVER: return "game_over";
+            case STATE_RESET: return "reset";
+            case STATE_EXIT_MENU_OPEN: return "exit_menu_open";
+            case STATE_EXIT_MENU_CLOSE: return "exit_menu_close";
+        }
+    }
+    return "-";
+}
+
+// Mirrors FramePhase in hitchdetector.h
+const char* PhaseName(uint16_t phase)
+{
+    static const char* names[] = {
+        "other", "input/ui", "music streaming", "simulation", "save I/O",
+        "texture upload", "draw scene", "draw ui", "present"
+    };
+    return phase < sizeof(names) / sizeof(names[0]) ? names[phase] : "unknown";
+}
+
+int TypeFromName(const char* name)
+{
+    for (uint16_t type = TELEMETRY_FRAME; type <= TELEMETRY_HITCH; type++) {
+        if (strcmp(name, TypeName(type)) == 0) {
+            return type;
+        }
+    }
+    return -1;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    bool csv = false;
+    int typeFilter = 0;
+    const char* path = nullptr;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--csv") == 0) {
+            csv = true;
+        } else if (strcmp(argv[i], "--type") == 0 && i + 1 < argc) {
+            typeFilter = TypeFromName(argv[++i]);
+            if (typeFilter < 0) {
+                fprintf(stderr, "teledump: unknown record type %s\n", argv[i]);
+                return 1;
+            }
+        } else {
+            path = argv[i];
+        }
+    }
+    if (path == nullptr) {
+        fprintf(stderr, "usage: teledump [--csv] [--type frame|input|state|hitch] telemetry.bin\n");
+        return 1;
+    }
+
+    FILE* file = fopen(path, "rb");
+    if (file == nullptr) {
+        fprintf(stderr, "teledump: cannot open %s\n", path);
+        return 1;
+    }
+
+    TelemetryFileHeader header;
+    if (fread(&header, sizeof(header), 1, file) != 1 || header.magic != telemetryMagic) {
+        fprintf(stderr, "teledump: %s is not a telemetry file\n", path);
+        fclose(file);
+        return 1;
+    }
+    if (header.version != telemetryVersion || header.recordSize != sizeof(TelemetryRecord)) {
+        fprintf(stderr, "teledump: unsupported version %u (record size %u)\n", header.version, header.recordSize);
+        fclose(file);
+        return 1;
+    }
+
+    if (csv) {
+        printf("time_ns,frame,type,code,value0,value1\n");
+    }
+
+    std::vector<TelemetryRecord> block(4096);
+    size_t got;
+    while ((got = fread(block.data(), sizeof(TelemetryRecord), block.size(), file)) > 0) {
+        for (size_t i = 0; i < got; i++) {
+            const TelemetryRecord& r = block[i];
+            if (typeFilter != 0 && r.type != typeFilter) {
+                continue;
+            }
+            const char* code = r.type == TELEMETRY_HITCH ? PhaseName(r.code) : CodeName(r.type, r.code);
+            if (csv) {
+                printf("%llu,%u,%s,%s,%g,%g\n", (unsigned long long)r.timeNs, r.frame,
+                    TypeName(r.type), code, r.value0, r.value1);
+            } else if (r.type == TELEMETRY_FRAME) {
+                printf("%12.6f  #%-8u frame  %.3f ms (cpu %.3f ms)\n", r.timeNs / 1e9, r.frame,
+                    r.value0 * 1000.0f, r.value1 * 1000.0f);
+            } else if (r.type == TELEMETRY_HITCH) {
+                printf("%12.6f  #%-8u HITCH  %.3f ms over a %.3f ms budget, caused by %s\n", r.timeNs / 1e9, r.frame,
+                    r.value0 * 1000.0f, r.value1 * 1000.0f, code);
+            } else if (r.type == TELEMETRY_STATE) {
+                printf("%12.6f  #%-8u state  %s (score %g, speed %g)\n", r.timeNs / 1e9, r.frame,
+                    code, r.value0, r.value1);
+            } else {
+                printf("%12.6f  #%-8u %-6s %s\n", r.timeNs / 1e9, r.frame,
+                    TypeName(r.type), code);
+            }
+        }
+    }
+    fclose(file);
+    return 0;
+}
@@ -0,0 +1,261 @@
+// tickstep: headless tick-by-tick debugger for replays.
+//
+// Usage: tickstep [--tick N] [--until flap|score|spawn|death] [--data dir]
+//                 [--profile out.folded[:hz]] replay.hkrp
+//
+// With --tick or --until the tool runs to that point, prints the tick and exits.
+// Otherwise it reads commands from stdin:
+//   n [count]      step forward (default 1)
+//   b [count]      step back through the stored snapshots
+//   g <tick>       go to a tick, from the nearest keyframe when the replay has them
+//   u <event>      run until the next flap, score, spawn or death
+//   p              print the current tick again
+//   q              quit
+// Every printed tick shows the full simulation state and what each section of
+// Simulation::Step and the scene recording cost on that tick. Replays recorded with
+// pixel collision need the game's Data/ directory for the player masks (default ./Data).
+// --profile samples the stepping with the sampling profiler (Linux); time spent
+// waiting for commands costs no CPU and gets no samples.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include "../src/drawlist.h"
+#include "../src/framestepper.h"
+#include "../src/replay.h"
+#include "../src/sampler.h"
+#include "../src/scenery.h"
+#include "../src/simulation.h"
+#include "spritemasks.h"
+
+namespace {
+
+struct Session {
+    const Replay* replay;
+    Simulation simulation;
+    FrameStepper stepper;
+    DrawList list;
+    SceneTextureSizes sizes;
+
+    Session(const Replay& replay, const PlayerMasks& masks)
+        : replay(&replay)
+    {
+        simulation.SetPlayerMasks(&masks.eyesOpen, &masks.eyesClosed);
+        // Sizes of the shipped Data/ textures
+        const int widths[DRAW_TEXTURE_COUNT] = { 1, 52, 640, 640 };
+        const int heights[DRAW_TEXTURE_COUNT] = { skyHeight, 320, 640, 640 };
+        for (int i = 0; i < DRAW_TEXTURE_COUNT; i++) {
+            sizes.width[i] = widths[i];
+            sizes.height[i] = heights[i];
+        }
+        simulation.Reset(replay.seed, replay.resetFlags);
+        stepper.Reset(simulation);
+        stepper.SetMeasuring(true);
+    }
+
+    void MeasureDraw()
+    {
+        auto start = std::chrono::steady_clock::now();
+        SceneryResidency scenery;
+        scenery.FillNeeded(0.0f, simulation.Config().width);
+        RecordScene(list, simulation.State(), simulation.Config(), sizes, scenery, 0.0f,
+            simulation.Config().width, simulation.Config().height);
+        stepper.SetDrawCost((uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start).count());
+    }
+
+    // Returns the events of the tick, or 0 with ok=false at the end of the replay
+    uint32_t Forward(bool& ok)
+    {
+        ok = true;
+        if (stepper.StepForward(simulation)) {
+            MeasureDraw();
+            return stepper.Current().events;
+        }
+        const SimState& state = simulation.State();
+        if (state.gameOver || state.tick >= replay->tickCount) {
+            ok = false;
+            return 0;
+        }
+        uint32_t events = stepper.Advance(simulation, replay->FlapsOn(state.tick + 1));
+        MeasureDraw();
+        return events;
+    }
+
+    bool Back()
+    {
+        return stepper.StepBack(simulation);
+    }
+
+    // Starts a new history at the last keyframe at or before tick, or at the start of
+    // the run without one
+    void Restore(uint32_t tick)
+    {
+        int keyframe = replay->KeyframeAt(tick);
+        while (keyframe >= 0 && !replay->RestoreKeyframe((size_t)keyframe, simulation)) {
+            printf("keyframe at tick %u fails its hash check\n", replay->keyframes[keyframe].tick);
+            keyframe--;
+        }
+        if (keyframe < 0) {
+            simulation.Reset(replay->seed, replay->resetFlags);
+        }
+        stepper.Reset(simulation);
+    }
+
+    void Print() const
+    {
+        printf("%s", DescribeTick(stepper.Current(), simulation.Config()).c_str());
+        if (stepper.Diverged()) {
+            printf("DIVERGED: a re-run tick differs from its snapshot\n");
+        }
+        if (simulation.State().tick == replay->tickCount) {
+            printf("end of replay, hash %s\n", simulation.Hash() == replay->finalHash ? "matches" : "MISMATCH");
+        }
+    }
+};
+
+uint32_t EventMask(const char* name)
+{
+    if (strcmp(name, "flap") == 0) return SIM_EVENT_FLAP;
+    if (strcmp(name, "score") == 0) return SIM_EVENT_SCORE;
+    if (strcmp(name, "spawn") == 0) return SIM_EVENT_PIPE_SPAWNED;
+    if (strcmp(name, "death") == 0) return SIM_EVENT_DEATH;
+    return 0;
+}
+
+bool RunUntil(Session& session, uint32_t mask)
+{
+    bool ok = true;
+    while (ok) {
+        if (session.Forward(ok) & mask) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void GoTo(Session& session, uint32_t tick)
+{
+    // The snapshots cover the last few seconds; past them, and past a keyframe ahead,
+    // start from the keyframe instead of re-running every tick in between
+    const Replay& replay = *session.replay;
+    uint32_t current = session.simulation.State().tick;
+    int keyframe = replay.KeyframeAt(std::min(tick, replay.tickCount));
+    bool keyframeAhead = keyframe >= 0 && replay.keyframes[keyframe].tick > current;
+    if (tick + session.stepper.Depth() < current || keyframeAhead) {
+        session.Restore(tick);
+    }
+    bool ok = true;
+    while (session.simulation.State().tick > tick && session.Back()) {
+    }
+    while (ok && session.simulation.State().tick < tick) {
+        session.Forward(ok);
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    const char* path = nullptr;
+    long gotoTick = -1;
+    uint32_t untilMask = 0;
+    std::string dataDir = "Data";
+    const char* profile = nullptr;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--tick") == 0 && i + 1 < argc) {
+            gotoTick = atol(argv[++i]);
+        } else if (strcmp(argv[i], "--until") == 0 && i + 1 < argc) {
+            untilMask = EventMask(argv[++i]);
+            if (untilMask == 0) {
+                fprintf(stderr, "unknown event %s\n", argv[i]);
+                return 2;
+            }
+        } else if (strcmp(argv[i], "--data") == 0 && i + 1 < argc) {
+            dataDir = argv[++i];
+        } else if (strcmp(argv[i], "--profile") == 0 && i + 1 < argc) {
+            profile = argv[++i];
+        } else {
+            path = argv[i];
+        }
+    }
+    if (path == nullptr) {
+        fprintf(stderr, "Usage: tickstep [--tick N] [--until flap|score|spawn|death] [--data dir]\n"
+                        "                [--profile out.folded[:hz]] replay.hkrp\n");
+        return 2;
+    }
+
+    Replay replay;
+    if (!replay.Load(path)) {
+        fprintf(stderr, "cannot load replay %s\n", path);
+        return 1;
+    }
+    printf("replay seed %u, %u ticks, %zu flaps, %zu keyframes, final score %d\n",
+        replay.seed, replay.tickCount, replay.flapTicks.size(), replay.keyframes.size(), replay.finalScore);
+
+    PlayerMasks masks;
+    if ((replay.resetFlags & SIM_RESET_PIXEL_COLLISION) && !LoadPlayerMasks(dataDir, (int)SimConfig().playerSize, masks)) {
+        fprintf(stderr, "replay uses pixel collision, cannot build player masks from %s (use --data)\n", dataDir.c_str());
+        return 1;
+    }
+
+    if (profile != nullptr && !SamplingProfiler::StartFromSetting(profile)) {
+        fprintf(stderr, "cannot start the sampling profiler with %s\n", profile);
+        return 2;
+    }
+    SamplingProfiler::SetGameplayActive(true);
+
+    Session session(replay, masks);
+    if (gotoTick >= 0 || untilMask != 0) {
+        if (gotoTick >= 0) {
+            GoTo(session, (uint32_t)gotoTick);
+        }
+        if (untilMask != 0 && !RunUntil(session, untilMask)) {
+            printf("event not reached\n");
+        }
+        session.Print();
+        SamplingProfiler::Stop();
+        return 0;
+    }
+
+    session.Print();
+    char line[128];
+    while (printf("> "), fflush(stdout), fgets(line, sizeof(line), stdin) != nullptr) {
+        char command[16] = "";
+        char argument[32] = "";
+        int parsed = sscanf(line, "%15s %31s", command, argument);
+        if (parsed <= 0) {
+            continue;
+        }
+        long count = parsed > 1 ? atol(argument) : 1;
+        bool ok = true;
+
+        if (strcmp(command, "q") == 0) {
+            break;
+        } else if (strcmp(command, "n") == 0) {
+            for (long i = 0; i < count && ok; i++) {
+                session.Forward(ok);
+            }
+        } else if (strcmp(command, "b") == 0) {
+            for (long i = 0; i < count && session.Back(); i++) {
+            }
+        } else if (strcmp(command, "g") == 0 && parsed > 1) {
+            GoTo(session, (uint32_t)count);
+        } else if (strcmp(command, "u") == 0 && parsed > 1 && EventMask(argument) != 0) {
+            if (!RunUntil(session, EventMask(argument))) {
+                printf("event not reached\n");
+            }
+        } else if (strcmp(command, "p") != 0) {
+            printf("commands: n [count], b [count], g <tick>, u flap|score|spawn|death, p, q\n");
+            continue;
+        }
+        session.Print();
+    }
+    SamplingProfiler::Stop();
+    return 0;
+}